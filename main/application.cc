@@ -59,6 +59,8 @@ bool Application::SetDeviceState(DeviceState state) {
 }
 
 void Application::Initialize() {
+    // Initialize() and Run() both run on the main task
+    main_task_handle_ = xTaskGetCurrentTaskHandle();
     auto& board = Board::GetInstance();
     SetDeviceState(kDeviceStateStarting);
 
@@ -72,6 +74,12 @@ void Application::Initialize() {
     auto codec = board.GetAudioCodec();
     audio_service_.Initialize(codec);
     audio_service_.Start();
+#if CONFIG_USE_SOUND_PCM_CACHE
+    // Sounds that must play right away, even while a TTS reply is queued
+    for (const auto& sound : { Lang::Sounds::OGG_POPUP, Lang::Sounds::OGG_EXCLAMATION, Lang::Sounds::OGG_VIBRATION }) {
+        audio_service_.PreloadSound(sound);
+    }
+#endif
 
     AudioServiceCallbacks callbacks;
     callbacks.on_send_queue_available = [this]() {
@@ -83,6 +91,17 @@ void Application::Initialize() {
     callbacks.on_vad_change = [this](bool speaking) {
         xEventGroupSetBits(event_group_, MAIN_EVENT_VAD_CHANGE);
     };
+    callbacks.on_end_of_utterance = [this]() {
+        xEventGroupSetBits(event_group_, MAIN_EVENT_END_OF_UTTERANCE);
+    };
+    callbacks.on_audio_testing_queue_full = [this]() {
+        Schedule([this]() {
+            if (GetDeviceState() == kDeviceStateAudioTesting) {
+                audio_service_.EnableAudioTesting(false);
+                SetDeviceState(kDeviceStateWifiConfiguring);
+            }
+        });
+    };
     audio_service_.SetCallbacks(callbacks);
 
     // Add state change listeners
@@ -177,7 +196,8 @@ void Application::Run() {
         MAIN_EVENT_START_LISTENING |
         MAIN_EVENT_STOP_LISTENING |
         MAIN_EVENT_ACTIVATION_DONE |
-        MAIN_EVENT_STATE_CHANGED;
+        MAIN_EVENT_STATE_CHANGED |
+        MAIN_EVENT_END_OF_UTTERANCE;
 
     while (true) {
         auto bits = xEventGroupWaitBits(event_group_, ALL_EVENTS, pdTRUE, pdFALSE, portMAX_DELAY);
@@ -217,7 +237,10 @@ void Application::Run() {
 
         if (bits & MAIN_EVENT_SEND_AUDIO) {
             while (auto packet = audio_service_.PopPacketFromSendQueue()) {
-                if (protocol_ && !protocol_->SendAudio(std::move(packet))) {
+                bool sent = !protocol_ || protocol_->SendAudio(*packet);
+                audio_service_.RecyclePacket(std::move(packet));
+                if (!sent) {
+                    audio_service_.ReportSendFailure();
                     break;
                 }
             }
@@ -234,6 +257,13 @@ void Application::Run() {
             }
         }
 
+        if (bits & MAIN_EVENT_END_OF_UTTERANCE) {
+            // The device found the end of speech, the server does not have to wait for its own VAD
+            if (GetDeviceState() == kDeviceStateListening && protocol_) {
+                protocol_->SendStopListening();
+            }
+        }
+
         if (bits & MAIN_EVENT_SCHEDULE) {
             std::unique_lock<std::mutex> lock(mutex_);
             auto tasks = std::move(main_tasks_);
@@ -308,7 +338,7 @@ void Application::HandleActivationDoneEvent() {
     display->SetChatMessage("system", "");
 
     // Play the success sound to indicate the device is ready
-    audio_service_.PlaySound(Lang::Sounds::OGG_SUCCESS);
+    PlaySound(Lang::Sounds::OGG_SUCCESS);
 
     // Release OTA object after activation is complete
     ota_.reset();
@@ -492,9 +522,8 @@ void Application::InitializeProtocol() {
     });
     
     protocol_->OnIncomingAudio([this](std::unique_ptr<AudioStreamPacket> packet) {
-        if (GetDeviceState() == kDeviceStateSpeaking) {
-            audio_service_.PushPacketToDecodeQueue(std::move(packet));
-        }
+        // Held until the speaking state change has reset the decoder, which may not have run yet
+        audio_service_.PushIncomingPacket(std::move(packet), reply_id_);
     });
     
     protocol_->OnAudioChannelOpened([this, codec, &board]() {
@@ -503,10 +532,24 @@ void Application::InitializeProtocol() {
             ESP_LOGW(TAG, "Server sample rate %d does not match device output sample rate %d, resampling may cause distortion",
                 protocol_->server_sample_rate(), codec->output_sample_rate());
         }
+        // The frame duration in the server hello confirms (or overrides) the one we asked for
+        if (protocol_->server_frame_duration() != audio_service_.configured_frame_duration_ms()) {
+            ESP_LOGW(TAG, "Server confirmed frame duration %d ms instead of %d ms",
+                protocol_->server_frame_duration(), audio_service_.configured_frame_duration_ms());
+        }
+        audio_service_.SetFrameDuration(protocol_->server_frame_duration());
+        audio_service_.ResetUplinkDtxStats();
     });
     
     protocol_->OnAudioChannelClosed([this, &board]() {
         board.SetPowerSaveLevel(PowerSaveLevel::LOW_POWER);
+        auto& dtx = audio_service_.GetUplinkDtxStats();
+        if (dtx.suppressed_packets > 0) {
+            ESP_LOGI(TAG, "Uplink DTX saved %lu packets / %lu bytes, sent %lu packets (%lu keepalive)",
+                (unsigned long)dtx.suppressed_packets, (unsigned long)dtx.suppressed_bytes,
+                (unsigned long)dtx.sent_packets, (unsigned long)dtx.keepalive_packets);
+        }
+        audio_service_.ClearEarlyPackets();
         Schedule([this]() {
             auto display = Board::GetInstance().GetDisplay();
             display->SetChatMessage("system", "");
@@ -520,11 +563,24 @@ void Application::InitializeProtocol() {
         if (strcmp(type->valuestring, "tts") == 0) {
             auto state = cJSON_GetObjectItem(root, "state");
             if (strcmp(state->valuestring, "start") == 0) {
-                Schedule([this]() {
+                // A repeated start before "tts stop" continues the reply that is playing
+                bool new_reply = !reply_streaming_.exchange(true);
+                uint32_t reply_id = new_reply ? ++reply_id_ : reply_id_.load();
+                Schedule([this, new_reply, reply_id]() {
                     aborted_ = false;
-                    SetDeviceState(kDeviceStateSpeaking);
+                    if (GetDeviceState() == kDeviceStateSpeaking) {
+                        if (new_reply) {
+                            // A new reply replaces the one still playing
+                            audio_service_.StartReply(reply_id);
+                        }
+                    } else {
+                        SetDeviceState(kDeviceStateSpeaking);
+                    }
                 });
             } else if (strcmp(state->valuestring, "stop") == 0) {
+                // Right away, so the last frames are not stretched as if the stream had stalled
+                reply_streaming_ = false;
+                audio_service_.FinishReply(reply_id_);
                 Schedule([this]() {
                     if (GetDeviceState() == kDeviceStateSpeaking) {
                         if (listening_mode_ == kListeningModeManualStop) {
@@ -630,7 +686,7 @@ void Application::ShowActivationCode(const std::string& code, const std::string&
         auto it = std::find_if(digit_sounds.begin(), digit_sounds.end(),
             [digit](const digit_sound& ds) { return ds.digit == digit; });
         if (it != digit_sounds.end()) {
-            audio_service_.PlaySound(it->sound);
+            PlaySound(it->sound);
         }
     }
 }
@@ -642,7 +698,7 @@ void Application::Alert(const char* status, const char* message, const char* emo
     display->SetEmotion(emotion);
     display->SetChatMessage("system", message);
     if (!sound.empty()) {
-        audio_service_.PlaySound(sound);
+        PlaySound(sound);
     }
 }
 
@@ -774,7 +830,8 @@ void Application::HandleWakeWordDetectedEvent() {
 #if CONFIG_SEND_WAKE_WORD_DATA
         // Encode and send the wake word data to the server
         while (auto packet = audio_service_.PopWakeWordPacket()) {
-            protocol_->SendAudio(std::move(packet));
+            protocol_->SendAudio(*packet);
+            audio_service_.RecyclePacket(std::move(packet));
         }
         // Set the chat state to wake word detected
         protocol_->SendWakeWordDetected(wake_word);
@@ -782,7 +839,7 @@ void Application::HandleWakeWordDetectedEvent() {
 #else
         SetListeningMode(aec_mode_ == kAecOff ? kListeningModeAutoStop : kListeningModeRealtime);
         // Play the pop up sound to indicate the wake word is detected
-        audio_service_.PlaySound(Lang::Sounds::OGG_POPUP);
+        PlaySound(Lang::Sounds::OGG_POPUP);
 #endif
     } else if (state == kDeviceStateSpeaking) {
         AbortSpeaking(kAbortReasonWakeWordDetected);
@@ -800,6 +857,10 @@ void Application::HandleStateChangedEvent() {
     auto display = board.GetDisplay();
     auto led = board.GetLed();
     led->OnStateChanged();
+    if (new_state != kDeviceStateSpeaking) {
+        // Whatever is still arriving of the reply is held, and dropped when the next one starts
+        audio_service_.EndReply();
+    }
     
     switch (new_state) {
         case kDeviceStateUnknown:
@@ -808,6 +869,7 @@ void Application::HandleStateChangedEvent() {
             display->SetEmotion("neutral");
             audio_service_.EnableVoiceProcessing(false);
             audio_service_.EnableWakeWordDetection(true);
+            audio_service_.EnableLowLatency(false);
             break;
         case kDeviceStateConnecting:
             display->SetStatus(Lang::Strings::CONNECTING);
@@ -822,6 +884,10 @@ void Application::HandleStateChangedEvent() {
             if (!audio_service_.IsAudioProcessorRunning()) {
                 // Send the start listening command
                 protocol_->SendStartListening(listening_mode_);
+                // In auto stop mode the server needs the silence to find the end of speech
+                audio_service_.EnableUplinkDtx(protocol_->server_dtx() && listening_mode_ != kListeningModeAutoStop);
+                audio_service_.EnableEndpointer(protocol_->server_endpoint() && listening_mode_ == kListeningModeAutoStop);
+                audio_service_.EnableLowLatency(listening_mode_ == kListeningModeRealtime);
                 audio_service_.EnableVoiceProcessing(true);
                 audio_service_.EnableWakeWordDetection(false);
             }
@@ -834,7 +900,7 @@ void Application::HandleStateChangedEvent() {
                 // Only AFE wake word can be detected in speaking mode
                 audio_service_.EnableWakeWordDetection(audio_service_.IsAfeWakeWord());
             }
-            audio_service_.ResetDecoder();
+            audio_service_.StartReply(reply_id_);
             break;
         case kDeviceStateWifiConfiguring:
             audio_service_.EnableVoiceProcessing(false);
@@ -954,7 +1020,8 @@ void Application::WakeWordInvoke(const std::string& wake_word) {
 #if CONFIG_USE_AFE_WAKE_WORD || CONFIG_USE_CUSTOM_WAKE_WORD
         // Encode and send the wake word data to the server
         while (auto packet = audio_service_.PopWakeWordPacket()) {
-            protocol_->SendAudio(std::move(packet));
+            protocol_->SendAudio(*packet);
+            audio_service_.RecyclePacket(std::move(packet));
         }
         // Set the chat state to wake word detected
         protocol_->SendWakeWordDetected(wake_word);
@@ -962,7 +1029,7 @@ void Application::WakeWordInvoke(const std::string& wake_word) {
 #else
         SetListeningMode(aec_mode_ == kAecOff ? kListeningModeAutoStop : kListeningModeRealtime);
         // Play the pop up sound to indicate the wake word is detected
-        audio_service_.PlaySound(Lang::Sounds::OGG_POPUP);
+        PlaySound(Lang::Sounds::OGG_POPUP);
 #endif
     } else if (state == kDeviceStateSpeaking) {
         Schedule([this]() {
@@ -1031,7 +1098,15 @@ void Application::SetAecMode(AecMode mode) {
 }
 
 void Application::PlaySound(const std::string_view& sound) {
-    audio_service_.PlaySound(sound);
+    // The decode queue has a single producer, the main task. It plays the sound right away, so a
+    // caller that blocks afterwards (e.g. before a reboot) still hears it; other tasks hand it over.
+    if (xTaskGetCurrentTaskHandle() == main_task_handle_) {
+        audio_service_.PlaySound(sound);
+        return;
+    }
+    Schedule([this, sound]() {
+        audio_service_.PlaySound(sound);
+    });
 }
 
 void Application::ResetProtocol() {
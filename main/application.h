@@ -10,6 +10,7 @@
 #include <mutex>
 #include <deque>
 #include <memory>
+#include <atomic>
 
 #include "protocol.h"
 #include "ota.h"
@@ -31,6 +32,7 @@
 #define MAIN_EVENT_START_LISTENING      (1 << 10)
 #define MAIN_EVENT_STOP_LISTENING       (1 << 11)
 #define MAIN_EVENT_STATE_CHANGED        (1 << 12)
+#define MAIN_EVENT_END_OF_UTTERANCE     (1 << 13)
 
 
 enum AecMode {
@@ -138,9 +140,14 @@ private:
 
     bool has_server_time_ = false;
     bool aborted_ = false;
+    // Counts the replies ("tts start" after a "tts stop"), the downlink audio is tagged with
+    // the reply it arrived in
+    std::atomic<uint32_t> reply_id_{0};
+    std::atomic<bool> reply_streaming_{false};
     bool assets_version_checked_ = false;
     int clock_ticks_ = 0;
     TaskHandle_t activation_task_handle_ = nullptr;
+    TaskHandle_t main_task_handle_ = nullptr;
 
 
     // Event handlers
@@ -1,8 +1,12 @@
 #include "audio_codec.h"
 #include "board.h"
 #include "settings.h"
+#include "audio_gain.h"
 
 #include <esp_log.h>
+#include <esp_attr.h>
+#include <esp_timer.h>
+#include <freertos/task.h>
 #include <cstring>
 #include <driver/i2s_common.h>
 
@@ -15,10 +19,23 @@ AudioCodec::~AudioCodec() {
 }
 
 void AudioCodec::OutputData(std::vector<int16_t>& data) {
+#if CONFIG_USE_LOW_LATENCY_I2S
+    DriverAccess access(*this, output_busy_);
+#endif
     Write(data.data(), data.size());
 }
 
+void AudioCodec::OutputNativeData(std::vector<int32_t>& data) {
+#if CONFIG_USE_LOW_LATENCY_I2S
+    DriverAccess access(*this, output_busy_);
+#endif
+    WriteNative(data.data(), data.size());
+}
+
 bool AudioCodec::InputData(std::vector<int16_t>& data) {
+#if CONFIG_USE_LOW_LATENCY_I2S
+    DriverAccess access(*this, input_busy_);
+#endif
     int samples = Read(data.data(), data.size());
     if (samples > 0) {
         return true;
@@ -34,17 +51,119 @@ void AudioCodec::Start() {
         output_volume_ = 10;
     }
 
+    StartChannels();
+
+    EnableInput(true);
+    EnableOutput(true);
+    ESP_LOGI(TAG, "Audio codec started");
+}
+
+void AudioCodec::StartChannels() {
+    // The callbacks can only be registered before the channels are enabled
     if (tx_handle_ != nullptr) {
+        i2s_event_callbacks_t callbacks = {};
+        callbacks.on_send_q_ovf = OnSendQueueOverflow;
+        ESP_ERROR_CHECK_WITHOUT_ABORT(i2s_channel_register_event_callback(tx_handle_, &callbacks, this));
         ESP_ERROR_CHECK(i2s_channel_enable(tx_handle_));
     }
 
     if (rx_handle_ != nullptr) {
+        i2s_event_callbacks_t callbacks = {};
+        callbacks.on_recv_q_ovf = OnRecvQueueOverflow;
+        ESP_ERROR_CHECK_WITHOUT_ABORT(i2s_channel_register_event_callback(rx_handle_, &callbacks, this));
         ESP_ERROR_CHECK(i2s_channel_enable(rx_handle_));
     }
+}
 
-    EnableInput(true);
-    EnableOutput(true);
-    ESP_LOGI(TAG, "Audio codec started");
+void AudioCodec::DeleteChannels() {
+    if (tx_handle_ != nullptr) {
+        i2s_channel_disable(tx_handle_);
+        ESP_ERROR_CHECK(i2s_del_channel(tx_handle_));
+        tx_handle_ = nullptr;
+    }
+    if (rx_handle_ != nullptr) {
+        i2s_channel_disable(rx_handle_);
+        ESP_ERROR_CHECK(i2s_del_channel(rx_handle_));
+        rx_handle_ = nullptr;
+    }
+}
+
+#if CONFIG_USE_LOW_LATENCY_I2S
+void AudioCodec::SetDmaProfile(AudioCodecDmaProfile profile) {
+    dma_profile_request_ = profile;
+    dma_profile_pending_ = true;
+}
+
+AudioCodec::DriverAccess::DriverAccess(AudioCodec& codec, std::atomic<bool>& busy) : busy_(busy) {
+    // Only a pending profile change takes the lock, a plain read or write is two atomic stores
+    if (codec.dma_profile_pending_) {
+        codec.ApplyDmaProfile();
+    }
+    busy_ = true;
+    if (codec.dma_reconfiguring_) {
+        // The other direction is recreating the channels, wait for it outside the driver
+        busy_ = false;
+        std::lock_guard<std::mutex> lock(codec.dma_mutex_);
+        busy_ = true;
+    }
+}
+
+void AudioCodec::ApplyDmaProfile() {
+    std::lock_guard<std::mutex> lock(dma_mutex_);
+    if (!dma_profile_pending_.exchange(false)) {
+        return;
+    }
+    auto profile = (AudioCodecDmaProfile)dma_profile_request_.load();
+    if (profile == dma_profile_) {
+        return;
+    }
+
+    // Duplex channels share one I2S port, so the other direction has to be out of its read / write.
+    // It checks dma_reconfiguring_ after marking itself busy, so one of the two always sees the other.
+    dma_reconfiguring_ = true;
+    int64_t wait_start_time = esp_timer_get_time();
+    while (input_busy_ || output_busy_) {
+        if (esp_timer_get_time() - wait_start_time >= AUDIO_CODEC_DMA_DRAIN_TIMEOUT_MS * 1000) {
+            ESP_LOGW(TAG, "DMA profile %d not applied, the %s is still in the driver", profile,
+                input_busy_ ? "input" : "output");
+            dma_reconfiguring_ = false;
+            return;
+        }
+        vTaskDelay(1);
+    }
+
+    int old_desc_num = dma_desc_num_;
+    int old_frame_num = dma_frame_num_;
+    if (profile == kAudioCodecDmaProfileLowLatency) {
+        dma_desc_num_ = AUDIO_CODEC_LOW_LATENCY_DMA_DESC_NUM;
+        dma_frame_num_ = AUDIO_CODEC_LOW_LATENCY_DMA_FRAME_NUM;
+    } else {
+        dma_desc_num_ = AUDIO_CODEC_DMA_DESC_NUM;
+        dma_frame_num_ = AUDIO_CODEC_DMA_FRAME_NUM;
+    }
+
+    int64_t start_time = esp_timer_get_time();
+    if (ReconfigureDma()) {
+        dma_profile_ = profile;
+        ESP_LOGI(TAG, "DMA set to %d x %d frames in %ld ms", dma_desc_num_, dma_frame_num_,
+            (long)((esp_timer_get_time() - start_time) / 1000));
+    } else {
+        ESP_LOGW(TAG, "DMA profile %d is not supported by this codec", profile);
+        dma_desc_num_ = old_desc_num;
+        dma_frame_num_ = old_frame_num;
+    }
+    dma_reconfiguring_ = false;
+}
+#endif
+
+bool IRAM_ATTR AudioCodec::OnSendQueueOverflow(i2s_chan_handle_t handle, i2s_event_data_t* event, void* user_ctx) {
+    ((AudioCodec*)user_ctx)->output_dma_underruns_++;
+    return false;
+}
+
+bool IRAM_ATTR AudioCodec::OnRecvQueueOverflow(i2s_chan_handle_t handle, i2s_event_data_t* event, void* user_ctx) {
+    ((AudioCodec*)user_ctx)->input_dma_overruns_++;
+    return false;
 }
 
 void AudioCodec::SetOutputVolume(int volume) {
@@ -55,6 +174,14 @@ void AudioCodec::SetOutputVolume(int volume) {
     settings.SetInt("output_volume", output_volume_);
 }
 
+int32_t AudioCodec::output_volume_factor() {
+    if (volume_factor_volume_ != output_volume_) {
+        volume_factor_volume_ = output_volume_;
+        volume_factor_ = VolumeToFactor(output_volume_);
+    }
+    return volume_factor_;
+}
+
 void AudioCodec::SetInputGain(float gain) {
     input_gain_ = gain;
     ESP_LOGI(TAG, "Set input gain to %.1f", input_gain_);
@@ -8,11 +8,28 @@
 #include <vector>
 #include <string>
 #include <functional>
+#include <atomic>
+#include <mutex>
 
 #include "board.h"
 
 #define AUDIO_CODEC_DMA_DESC_NUM 6
 #define AUDIO_CODEC_DMA_FRAME_NUM 240
+#if CONFIG_USE_LOW_LATENCY_I2S
+#define AUDIO_CODEC_LOW_LATENCY_DMA_DESC_NUM CONFIG_LOW_LATENCY_I2S_DMA_DESC_NUM
+#define AUDIO_CODEC_LOW_LATENCY_DMA_FRAME_NUM CONFIG_LOW_LATENCY_I2S_DMA_FRAME_NUM
+// A read or write returns within one frame of audio, a profile change waits this long for it
+#define AUDIO_CODEC_DMA_DRAIN_TIMEOUT_MS 200
+#else
+#define AUDIO_CODEC_LOW_LATENCY_DMA_DESC_NUM 4
+#define AUDIO_CODEC_LOW_LATENCY_DMA_FRAME_NUM 120
+#endif
+
+enum AudioCodecDmaProfile {
+    kAudioCodecDmaProfileDefault,
+    kAudioCodecDmaProfileLowLatency,
+    kAudioCodecDmaProfileCount,
+};
 
 class AudioCodec {
 public:
@@ -25,6 +42,8 @@ public:
     virtual void EnableOutput(bool enable);
 
     virtual void OutputData(std::vector<int16_t>& data);
+    // 32-bit I2S words scaled by output_volume_factor(), output_native_slots() words per sample
+    virtual void OutputNativeData(std::vector<int32_t>& data);
     virtual bool InputData(std::vector<int16_t>& data);
     virtual void Start();
 
@@ -38,6 +57,24 @@ public:
     inline float input_gain() const { return input_gain_; }
     inline bool input_enabled() const { return input_enabled_; }
     inline bool output_enabled() const { return output_enabled_; }
+    // Codecs that write 32-bit words to I2S take frames already in that format, so the mixer
+    // produces them in its last pass. 0 if the codec takes 16-bit samples.
+    inline int output_native_slots() const { return output_native_slots_; }
+
+    // Q16 factor for output_volume_, recomputed only when the volume changes
+    int32_t output_volume_factor();
+
+#if CONFIG_USE_LOW_LATENCY_I2S
+    // The I2S channels are recreated with the profile's DMA sizes by the next InputData / OutputData,
+    // once neither direction is inside a read or write. Codecs that can't do it keep the default.
+    void SetDmaProfile(AudioCodecDmaProfile profile);
+#endif
+    inline AudioCodecDmaProfile dma_profile() const { return dma_profile_; }
+    inline int dma_desc_num() const { return dma_desc_num_; }
+    inline int dma_frame_num() const { return dma_frame_num_; }
+    // DMA queue overflows counted by the I2S ISR. The output one also counts while nothing is written.
+    inline uint32_t output_dma_underruns() const { return output_dma_underruns_; }
+    inline uint32_t input_dma_overruns() const { return input_dma_overruns_; }
 
 protected:
     i2s_chan_handle_t tx_handle_ = nullptr;
@@ -53,9 +90,51 @@ protected:
     int output_channels_ = 1;
     int output_volume_ = 70;
     float input_gain_ = 0.0;
+    int output_native_slots_ = 0;
+    int dma_desc_num_ = AUDIO_CODEC_DMA_DESC_NUM;
+    int dma_frame_num_ = AUDIO_CODEC_DMA_FRAME_NUM;
 
     virtual int Read(int16_t* dest, int samples) = 0;
     virtual int Write(const int16_t* data, int samples) = 0;
+    virtual int WriteNative(const int32_t* data, int words) { return 0; }
+    // Recreates tx_handle_ / rx_handle_ with dma_desc_num_ / dma_frame_num_, false if not supported
+    virtual bool ReconfigureDma() { return false; }
+
+    // Registers the overflow counters and enables the channels
+    void StartChannels();
+    void DeleteChannels();
+
+private:
+    int volume_factor_volume_ = -1;
+    int32_t volume_factor_ = 0;
+    AudioCodecDmaProfile dma_profile_ = kAudioCodecDmaProfileDefault;
+    std::atomic<uint32_t> output_dma_underruns_{0};
+    std::atomic<uint32_t> input_dma_overruns_{0};
+#if CONFIG_USE_LOW_LATENCY_I2S
+    std::atomic<int> dma_profile_request_{kAudioCodecDmaProfileDefault};
+    std::atomic<bool> dma_profile_pending_{false};
+    std::atomic<bool> dma_reconfiguring_{false};
+    // Set while InputData / OutputData are inside the driver
+    std::atomic<bool> input_busy_{false};
+    std::atomic<bool> output_busy_{false};
+    // Only taken to apply a profile, and by a direction that has to wait for it
+    std::mutex dma_mutex_;
+
+    // Marks one direction as inside the driver for its lifetime, after applying a pending profile
+    // or waiting for the other direction to finish applying one
+    class DriverAccess {
+    public:
+        DriverAccess(AudioCodec& codec, std::atomic<bool>& busy);
+        ~DriverAccess() { busy_ = false; }
+
+    private:
+        std::atomic<bool>& busy_;
+    };
+
+    void ApplyDmaProfile();
+#endif
+    static bool OnSendQueueOverflow(i2s_chan_handle_t handle, i2s_event_data_t* event, void* user_ctx);
+    static bool OnRecvQueueOverflow(i2s_chan_handle_t handle, i2s_event_data_t* event, void* user_ctx);
 };
 
 #endif // _AUDIO_CODEC_H
@@ -0,0 +1,34 @@
+#include "audio_gain.h"
+
+#include <algorithm>
+#include <cmath>
+
+int32_t VolumeToFactor(int volume) {
+    // Same expression the codecs used to evaluate on every write
+    return pow(double(volume) / 100.0, 2) * 65536;
+}
+
+void ScaleToInt32(const int16_t* input, int32_t* output, size_t samples, int32_t factor) {
+    if (factor > 65536) {
+        // Volume above 100, the product can overflow
+        for (size_t i = 0; i < samples; i++) {
+            output[i] = (int32_t)std::clamp<int64_t>(int64_t(input[i]) * factor, INT32_MIN, INT32_MAX);
+        }
+        return;
+    }
+    for (size_t i = 0; i < samples; i++) {
+        output[i] = input[i] * factor;
+    }
+}
+
+void ShiftToInt16(const int32_t* input, int16_t* output, size_t samples, int shift) {
+    for (size_t i = 0; i < samples; i++) {
+        output[i] = (int16_t)std::clamp<int32_t>(input[i] >> shift, -INT16_MAX, INT16_MAX);
+    }
+}
+
+void AmplifyInt16(int16_t* data, size_t samples, int32_t gain) {
+    for (size_t i = 0; i < samples; i++) {
+        data[i] = (int16_t)std::clamp<int32_t>(data[i] * gain, -INT16_MAX, INT16_MAX);
+    }
+}
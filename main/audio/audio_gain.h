@@ -0,0 +1,26 @@
+#ifndef AUDIO_GAIN_H
+#define AUDIO_GAIN_H
+
+#include <cstdint>
+#include <cstddef>
+
+/*
+ * Sample gain kernels shared by the I2S codecs.
+ *
+ * The loops are written without branches so the compiler can unroll / vectorize them,
+ * and they produce exactly the values of the per-sample code they replace.
+ */
+
+// Q16 factor (0 - 65536) for a 0 - 100 output volume, squared as a rough loudness curve
+int32_t VolumeToFactor(int volume);
+
+// 16-bit samples to 32-bit I2S words. A factor up to 65536 cannot overflow 32 bits, larger ones are clamped.
+void ScaleToInt32(const int16_t* input, int32_t* output, size_t samples, int32_t factor);
+
+// 32-bit I2S words to 16-bit samples, shifted right and saturated to +/-INT16_MAX
+void ShiftToInt16(const int32_t* input, int16_t* output, size_t samples, int shift);
+
+// In-place integer gain, saturated to +/-INT16_MAX
+void AmplifyInt16(int16_t* data, size_t samples, int32_t gain);
+
+#endif // AUDIO_GAIN_H
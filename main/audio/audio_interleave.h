@@ -0,0 +1,46 @@
+#ifndef AUDIO_INTERLEAVE_H
+#define AUDIO_INTERLEAVE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+/*
+ * Stereo <-> planar conversion, two frames per iteration through 32-bit words (little endian),
+ * with a scalar loop for the odd frame at the end.
+ */
+inline void DeinterleaveStereo(const int16_t* src, int16_t* left, int16_t* right, size_t frames) {
+    size_t i = 0;
+    for (; i + 2 <= frames; i += 2) {
+        uint32_t w0, w1;
+        memcpy(&w0, src + i * 2, sizeof(w0));
+        memcpy(&w1, src + i * 2 + 2, sizeof(w1));
+        uint32_t l = (w0 & 0xFFFF) | (w1 << 16);
+        uint32_t r = (w0 >> 16) | (w1 & 0xFFFF0000);
+        memcpy(left + i, &l, sizeof(l));
+        memcpy(right + i, &r, sizeof(r));
+    }
+    for (; i < frames; i++) {
+        left[i] = src[i * 2];
+        right[i] = src[i * 2 + 1];
+    }
+}
+
+inline void InterleaveStereo(const int16_t* left, const int16_t* right, int16_t* dest, size_t frames) {
+    size_t i = 0;
+    for (; i + 2 <= frames; i += 2) {
+        uint32_t l, r;
+        memcpy(&l, left + i, sizeof(l));
+        memcpy(&r, right + i, sizeof(r));
+        uint32_t w0 = (l & 0xFFFF) | (r << 16);
+        uint32_t w1 = (l >> 16) | (r & 0xFFFF0000);
+        memcpy(dest + i * 2, &w0, sizeof(w0));
+        memcpy(dest + i * 2 + 2, &w1, sizeof(w1));
+    }
+    for (; i < frames; i++) {
+        dest[i * 2] = left[i];
+        dest[i * 2 + 1] = right[i];
+    }
+}
+
+#endif // AUDIO_INTERLEAVE_H
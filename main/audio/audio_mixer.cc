@@ -0,0 +1,141 @@
+#include "audio_mixer.h"
+#include "audio_gain.h"
+
+#include <algorithm>
+
+AudioMixer::AudioMixer() {
+    for (int i = 0; i < kAudioMixerSourceCount; i++) {
+        gain_[i] = AUDIO_MIXER_UNITY_GAIN;
+        target_gain_[i] = AUDIO_MIXER_UNITY_GAIN;
+    }
+}
+
+void AudioMixer::SetGain(AudioMixerSource source, int32_t gain) {
+    target_gain_[source] = std::clamp<int32_t>(gain, 0, AUDIO_MIXER_UNITY_GAIN);
+}
+
+const int16_t* AudioMixer::SingleUnitySource(const int16_t* const inputs[kAudioMixerSourceCount]) const {
+    const int16_t* single = nullptr;
+    for (int s = 0; s < kAudioMixerSourceCount; s++) {
+        if (inputs[s] == nullptr) {
+            continue;
+        }
+        if (single != nullptr || gain_[s] != AUDIO_MIXER_UNITY_GAIN || target_gain_[s] != AUDIO_MIXER_UNITY_GAIN) {
+            return nullptr;
+        }
+        single = inputs[s];
+    }
+    return single;
+}
+
+void AudioMixer::Mix(const int16_t* const inputs[kAudioMixerSourceCount], size_t samples, int16_t* output) {
+    if (samples == 0) {
+        return;
+    }
+    const int16_t* single = SingleUnitySource(inputs);
+    if (single != nullptr) {
+        for (int s = 0; s < kAudioMixerSourceCount; s++) {
+            gain_[s] = target_gain_[s];
+        }
+        if (single != output) {
+            std::copy(single, single + samples, output);
+        }
+        return;
+    }
+
+    Accumulate(inputs, samples);
+    const int32_t* acc = accumulator_.data();
+    for (size_t i = 0; i < samples; i++) {
+        output[i] = (int16_t)std::clamp<int32_t>(acc[i], INT16_MIN, INT16_MAX);
+    }
+}
+
+void AudioMixer::MixToInt32(const int16_t* const inputs[kAudioMixerSourceCount], size_t samples, int32_t* output,
+    int32_t volume_factor, int slots) {
+    if (samples == 0) {
+        return;
+    }
+    const int16_t* single = SingleUnitySource(inputs);
+    if (single != nullptr && slots == 1) {
+        for (int s = 0; s < kAudioMixerSourceCount; s++) {
+            gain_[s] = target_gain_[s];
+        }
+        ScaleToInt32(single, output, samples, volume_factor);
+        return;
+    }
+
+    // Separate loops per layout so the compiler can vectorize the common ones. A factor up to
+    // 65536 cannot overflow a saturated 16-bit sample, see ScaleToInt32().
+    auto write_words = [&](const auto* source) {
+        if (volume_factor > 65536) {
+            for (size_t i = 0; i < samples; i++) {
+                int32_t sample = std::clamp<int32_t>(source[i], INT16_MIN, INT16_MAX);
+                int32_t word = (int32_t)std::clamp<int64_t>(int64_t(sample) * volume_factor, INT32_MIN, INT32_MAX);
+                for (int c = 0; c < slots; c++) {
+                    output[i * slots + c] = word;
+                }
+            }
+        } else if (slots == 1) {
+            for (size_t i = 0; i < samples; i++) {
+                output[i] = std::clamp<int32_t>(source[i], INT16_MIN, INT16_MAX) * volume_factor;
+            }
+        } else if (slots == 2) {
+            for (size_t i = 0; i < samples; i++) {
+                int32_t word = std::clamp<int32_t>(source[i], INT16_MIN, INT16_MAX) * volume_factor;
+                output[i * 2] = word;
+                output[i * 2 + 1] = word;
+            }
+        } else {
+            for (size_t i = 0; i < samples; i++) {
+                int32_t word = std::clamp<int32_t>(source[i], INT16_MIN, INT16_MAX) * volume_factor;
+                for (int c = 0; c < slots; c++) {
+                    output[i * slots + c] = word;
+                }
+            }
+        }
+    };
+    if (single != nullptr) {
+        for (int s = 0; s < kAudioMixerSourceCount; s++) {
+            gain_[s] = target_gain_[s];
+        }
+        write_words(single);
+    } else {
+        Accumulate(inputs, samples);
+        write_words(accumulator_.data());
+    }
+}
+
+void AudioMixer::Accumulate(const int16_t* const inputs[kAudioMixerSourceCount], size_t samples) {
+    accumulator_.assign(samples, 0);
+    int32_t* acc = accumulator_.data();
+
+    for (int s = 0; s < kAudioMixerSourceCount; s++) {
+        const int16_t* input = inputs[s];
+        int32_t gain = gain_[s];
+        int32_t target = target_gain_[s];
+        gain_[s] = target;
+        if (input == nullptr) {
+            continue;
+        }
+
+        if (gain == target) {
+            if (gain == AUDIO_MIXER_UNITY_GAIN) {
+                for (size_t i = 0; i < samples; i++) {
+                    acc[i] += input[i];
+                }
+            } else {
+                for (size_t i = 0; i < samples; i++) {
+                    acc[i] += (input[i] * gain) >> 15;
+                }
+            }
+            continue;
+        }
+
+        // Linear ramp to the new gain over this frame
+        int32_t step = (target - gain) / (int32_t)samples;
+        for (size_t i = 0; i < samples; i++) {
+            acc[i] += (input[i] * gain) >> 15;
+            gain += step;
+        }
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef AUDIO_MIXER_H
+#define AUDIO_MIXER_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Gains are Q15, 32768 is unity
+#define AUDIO_MIXER_UNITY_GAIN 32768
+// Speech is ducked by 12 dB while a notification plays over it
+#define AUDIO_MIXER_DUCK_GAIN (AUDIO_MIXER_UNITY_GAIN / 4)
+
+enum AudioMixerSource {
+    kAudioMixerSourceSpeech,
+    kAudioMixerSourceNotification,
+    kAudioMixerSourceCount,
+};
+
+/*
+ * Sums the output sources into one frame right before the codec.
+ *
+ * Each source has its own gain; a gain change ramps linearly over the next mixed frame so
+ * ducking does not click. Sources are accumulated in 32 bits one at a time (a loop the
+ * compiler can vectorize) and saturated to 16 bits in a final pass. A lone source at unity
+ * gain, the usual case, is not accumulated at all.
+ *
+ * MixToInt32() writes the codec's native I2S words instead: the final pass also applies the
+ * output volume and repeats each sample for every slot, with the same values as Mix()
+ * followed by ScaleToInt32(), so the frame goes from the mixer to the I2S driver in one pass.
+ */
+class AudioMixer {
+public:
+    AudioMixer();
+
+    void SetGain(AudioMixerSource source, int32_t gain);
+    int32_t gain(AudioMixerSource source) const { return target_gain_[source]; }
+
+    // inputs[source] may be nullptr for a silent source; output may alias any input
+    void Mix(const int16_t* const inputs[kAudioMixerSourceCount], size_t samples, int16_t* output);
+    // output holds samples * slots words, volume_factor is the codec's Q16 output volume factor
+    void MixToInt32(const int16_t* const inputs[kAudioMixerSourceCount], size_t samples, int32_t* output,
+        int32_t volume_factor, int slots);
+
+private:
+    int32_t gain_[kAudioMixerSourceCount];
+    int32_t target_gain_[kAudioMixerSourceCount];
+    std::vector<int32_t> accumulator_;
+
+    // Returns the only source if it plays at unity gain with no ramp, nullptr otherwise
+    const int16_t* SingleUnitySource(const int16_t* const inputs[kAudioMixerSourceCount]) const;
+    // Sums the sources into accumulator_ and moves the gains to their targets
+    void Accumulate(const int16_t* const inputs[kAudioMixerSourceCount], size_t samples);
+};
+
+#endif // AUDIO_MIXER_H
@@ -0,0 +1,62 @@
+#ifndef AUDIO_POOL_H
+#define AUDIO_POOL_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+
+/*
+ * Fixed-size free list of audio objects (AudioTask / AudioStreamPacket).
+ *
+ * Objects are recycled with their buffers still allocated, so once every buffer in the
+ * pool has grown to the frame size the pipeline runs without touching the heap.
+ * Acquire() falls back to the heap when the pool is empty and counts that as an
+ * exhaustion event; Release() frees the object if the pool is already full.
+ */
+template <typename T>
+class AudioPool {
+public:
+    explicit AudioPool(size_t capacity) : capacity_(capacity) {
+        free_.reserve(capacity);
+        for (size_t i = 0; i < capacity; i++) {
+            free_.push_back(std::make_unique<T>());
+        }
+    }
+    AudioPool(const AudioPool&) = delete;
+    AudioPool& operator=(const AudioPool&) = delete;
+
+    std::unique_ptr<T> Acquire() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!free_.empty()) {
+                auto item = std::move(free_.back());
+                free_.pop_back();
+                return item;
+            }
+            exhausted_count_++;
+        }
+        return std::make_unique<T>();
+    }
+
+    void Release(std::unique_ptr<T>&& item) {
+        if (!item) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (free_.size() < capacity_) {
+            free_.push_back(std::move(item));
+        }
+    }
+
+    uint32_t exhausted_count() const { return exhausted_count_.load(std::memory_order_relaxed); }
+
+private:
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<T>> free_;
+    const size_t capacity_;
+    std::atomic<uint32_t> exhausted_count_{0};
+};
+
+#endif // AUDIO_POOL_H
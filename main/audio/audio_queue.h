@@ -0,0 +1,97 @@
+#ifndef AUDIO_QUEUE_H
+#define AUDIO_QUEUE_H
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+
+/*
+ * Bounded single-producer / single-consumer ring queue used between the audio tasks.
+ *
+ * The producer only writes tail_ and the consumer only writes head_, published with
+ * release / acquire ordering, so neither end ever takes a lock. Each queue must have
+ * exactly one producer task and one consumer task; other tasks hand their work to the
+ * owning task instead (see AudioService::PlaySound and ResetDecoder).
+ *
+ * Any task may call RequestClear(), the consumer then hands back everything that was
+ * queued at that point through PopCleared() before it pops anything new, so pooled items
+ * can be recycled instead of destroyed.
+ *
+ * The slot count is rounded up to a power of two so the free-running indices stay
+ * consistent when they wrap around.
+ *
+ * The queue does not wake anyone up by itself; AudioService signals the waiting task
+ * through its own event group bit for each queue.
+ */
+template <typename T>
+class AudioQueue {
+public:
+    explicit AudioQueue(size_t capacity) : slots_(RoundUpToPowerOfTwo(capacity)), mask_(slots_.size() - 1), capacity_(capacity) {}
+    AudioQueue(const AudioQueue&) = delete;
+    AudioQueue& operator=(const AudioQueue&) = delete;
+
+    // Producer only. Returns false if the queue is full, the item is left untouched
+    bool Push(T&& item) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) >= capacity_) {
+            return false;
+        }
+        slots_[tail & mask_] = std::move(item);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only. Returns false if the queue is empty
+    bool Pop(T& item) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = std::move(slots_[head & mask_]);
+        slots_[head & mask_] = T();
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Any task. Everything queued so far is handed back by PopCleared() instead of Pop()
+    void RequestClear() {
+        clear_mark_.store(tail_.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+    // Consumer only. Returns false once nothing queued before the last RequestClear() is left
+    bool PopCleared(T& item) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        size_t pending = clear_mark_.load(std::memory_order_acquire) - head;
+        // A mark behind head has already been drained and wraps to a huge count here
+        if (pending == 0 || pending > tail_.load(std::memory_order_acquire) - head) {
+            return false;
+        }
+        return Pop(item);
+    }
+
+    size_t size() const {
+        // Load head before tail so a concurrent pop can never make the result wrap below zero
+        size_t head = head_.load(std::memory_order_acquire);
+        return tail_.load(std::memory_order_acquire) - head;
+    }
+    bool empty() const { return size() == 0; }
+    size_t capacity() const { return capacity_; }
+
+private:
+    std::vector<T> slots_;
+    const size_t mask_;
+    const size_t capacity_;
+    std::atomic<size_t> head_{0};
+    std::atomic<size_t> tail_{0};
+    std::atomic<size_t> clear_mark_{0};
+
+    static size_t RoundUpToPowerOfTwo(size_t n) {
+        size_t size = 1;
+        while (size < n) {
+            size <<= 1;
+        }
+        return size;
+    }
+};
+
+#endif // AUDIO_QUEUE_H
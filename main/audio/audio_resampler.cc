@@ -0,0 +1,44 @@
+#include "audio_resampler.h"
+
+#include <esp_log.h>
+
+#define TAG "AudioResampler"
+
+void AudioResampler::Configure(int input_sample_rate, int output_sample_rate) {
+    if (input_sample_rate == input_sample_rate_ && output_sample_rate == output_sample_rate_) {
+        return;
+    }
+    input_sample_rate_ = input_sample_rate;
+    output_sample_rate_ = output_sample_rate;
+
+    use_polyphase_ = allow_polyphase_ && polyphase_.Configure(input_sample_rate, output_sample_rate);
+    if (!use_polyphase_) {
+        opus_.Configure(input_sample_rate, output_sample_rate);
+    }
+    ESP_LOGI(TAG, "Resampler %d -> %d: %s", input_sample_rate, output_sample_rate,
+        use_polyphase_ ? "polyphase" : "opus");
+}
+
+int AudioResampler::GetOutputSamples(int input_samples) const {
+    if (use_polyphase_) {
+        return polyphase_.GetOutputSamples(input_samples);
+    }
+    return opus_.GetOutputSamples(input_samples);
+}
+
+void AudioResampler::Process(const int16_t* input, int input_samples, int16_t* output) {
+    if (use_polyphase_) {
+        polyphase_.Process(input, input_samples, output);
+    } else {
+        opus_.Process(input, input_samples, output);
+    }
+}
+
+void AudioResampler::Reset() {
+    if (use_polyphase_) {
+        polyphase_.Reset();
+    } else if (input_sample_rate_ != 0) {
+        // The SILK resampler has no reset of its own, configuring it again clears its state
+        opus_.Configure(input_sample_rate_, output_sample_rate_);
+    }
+}
@@ -0,0 +1,39 @@
+#ifndef AUDIO_RESAMPLER_H
+#define AUDIO_RESAMPLER_H
+
+#include <opus_resampler.h>
+
+#include "polyphase_resampler.h"
+
+/*
+ * Resampler used by one direction of the pipeline.
+ *
+ * When that direction allows it and the ratio has a compiled filter bank, the fixed-point
+ * PolyphaseResampler is used; anything else falls back to OpusResampler. Configuring the
+ * ratio that is already set keeps the filter state.
+ */
+class AudioResampler {
+public:
+    explicit AudioResampler(bool allow_polyphase) : allow_polyphase_(allow_polyphase) {}
+
+    void Configure(int input_sample_rate, int output_sample_rate);
+    int GetOutputSamples(int input_samples) const;
+    // output may alias input when it is not longer, which is only guaranteed by the polyphase engine
+    void Process(const int16_t* input, int input_samples, int16_t* output);
+    // Clears the filter history, the next block starts from silence
+    void Reset();
+
+    bool polyphase() const { return use_polyphase_; }
+    int input_sample_rate() const { return input_sample_rate_; }
+    int output_sample_rate() const { return output_sample_rate_; }
+
+private:
+    bool allow_polyphase_;
+    bool use_polyphase_ = false;
+    int input_sample_rate_ = 0;
+    int output_sample_rate_ = 0;
+    PolyphaseResampler polyphase_;
+    OpusResampler opus_;
+};
+
+#endif // AUDIO_RESAMPLER_H
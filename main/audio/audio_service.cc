@@ -1,7 +1,14 @@
 #include "audio_service.h"
+#include "audio_interleave.h"
+#include "settings.h"
 #include <esp_log.h>
+#include <esp_heap_caps.h>
 #include <cstring>
 
+#if CONFIG_USE_SHARED_AFE
+#include "processors/shared_afe_audio_processor.h"
+#include "wake_words/shared_afe_wake_word.h"
+#endif
 #if CONFIG_USE_AUDIO_PROCESSOR
 #include "processors/afe_audio_processor.h"
 #else
@@ -17,15 +24,49 @@
 
 #define TAG "AudioService"
 
+static inline void UpdateHighWater(uint32_t& mark, size_t depth) {
+    if (depth > mark) {
+        mark = depth;
+    }
+}
+
+// Upper bound of the decoded length, every packet decodes to at most one frame
+static size_t MaxSoundSamples(const OggSound& sound, int output_sample_rate) {
+    return sound.packets.size() * (output_sample_rate * SOUND_FRAME_DURATION_MS / 1000 + 1);
+}
+
+void LatencyHistogram::Record(int64_t latency_us) {
+    static const uint32_t bounds_ms[] = LATENCY_HISTOGRAM_BOUNDS_MS;
+    static_assert(sizeof(bounds_ms) / sizeof(bounds_ms[0]) == LATENCY_HISTOGRAM_BUCKETS - 1);
+    if (latency_us < 0) {
+        latency_us = 0;
+    }
+    uint32_t latency_ms = latency_us / 1000;
+    size_t i = 0;
+    while (i < LATENCY_HISTOGRAM_BUCKETS - 1 && latency_ms >= bounds_ms[i]) {
+        i++;
+    }
+    buckets[i]++;
+    count++;
+    total_us += latency_us;
+    if (latency_us > max_us) {
+        max_us = latency_us;
+    }
+}
+
 
 AudioService::AudioService() {
     event_group_ = xEventGroupCreate();
+    queue_event_group_ = xEventGroupCreate();
 }
 
 AudioService::~AudioService() {
     if (event_group_ != nullptr) {
         vEventGroupDelete(event_group_);
     }
+    if (queue_event_group_ != nullptr) {
+        vEventGroupDelete(queue_event_group_);
+    }
 }
 
 
@@ -34,27 +75,52 @@ void AudioService::Initialize(AudioCodec* codec) {
     codec_->Start();
 
     /* Setup the audio codec */
-    opus_decoder_ = std::make_unique<OpusDecoderWrapper>(codec->output_sample_rate(), 1, OPUS_FRAME_DURATION_MS);
-    opus_encoder_ = std::make_unique<OpusEncoderWrapper>(16000, 1, OPUS_FRAME_DURATION_MS);
-    opus_encoder_->SetComplexity(0);
+    Settings settings("audio", false);
+    int frame_duration = settings.GetInt("frame_duration", OPUS_FRAME_DURATION_MS);
+    if (frame_duration != 20 && frame_duration != 40 && frame_duration != 60) {
+        ESP_LOGW(TAG, "Invalid frame duration %d ms, using %d ms", frame_duration, OPUS_FRAME_DURATION_MS);
+        frame_duration = OPUS_FRAME_DURATION_MS;
+    }
+    configured_frame_duration_ms_ = frame_duration;
+    frame_duration_ms_ = frame_duration;
+
+    decoder_cache_.SetOutputSampleRate(codec->output_sample_rate());
+    decoder_ = &decoder_cache_.Get(codec->output_sample_rate(), frame_duration_ms_);
+#if CONFIG_USE_SOUND_PCM_CACHE
+    sound_cache_.SetPcmBudget(CONFIG_SOUND_PCM_CACHE_SIZE_KB * 1024);
+#endif
+    SetEncodeFrameDuration(frame_duration_ms_);
 
     if (codec->input_sample_rate() != 16000) {
         input_resampler_.Configure(codec->input_sample_rate(), 16000);
         reference_resampler_.Configure(codec->input_sample_rate(), 16000);
     }
 
-#if CONFIG_USE_AUDIO_PROCESSOR
+#if CONFIG_USE_SHARED_AFE
+    shared_afe_ = std::make_shared<SharedAfe>();
+    audio_processor_ = std::make_unique<SharedAfeAudioProcessor>(shared_afe_);
+#elif CONFIG_USE_AUDIO_PROCESSOR
     audio_processor_ = std::make_unique<AfeAudioProcessor>();
 #else
     audio_processor_ = std::make_unique<NoAudioProcessor>();
 #endif
 
     audio_processor_->OnOutput([this](std::vector<int16_t>&& data) {
+        auto enabled_us = voice_processing_enabled_us_.exchange(0);
+        if (enabled_us != 0) {
+            auto latency_us = esp_timer_get_time() - enabled_us;
+            debug_statistics_.voice_processing_start.Record(latency_us);
+            ESP_LOGI(TAG, "Voice processing enabled to first frame: %ld ms", (long)(latency_us / 1000));
+        }
+        if (endpointer_enabled_ && !ProcessEndpointer(data.size())) {
+            return;
+        }
         PushTaskToEncodeQueue(kAudioTaskTypeEncodeToSendQueue, std::move(data));
     });
 
     audio_processor_->OnVadStateChange([this](bool speaking) {
         voice_detected_ = speaking;
+        end_of_speech_us_ = speaking ? 0 : esp_timer_get_time();
         if (callbacks_.on_vad_change) {
             callbacks_.on_vad_change(speaking);
         }
@@ -109,12 +175,20 @@ void AudioService::Start() {
     }, "audio_output", 2048, this, 4, &audio_output_task_handle_);
 #endif
 
-    /* Start the opus codec task */
-    xTaskCreate([](void* arg) {
+    /* Start the opus encode and decode tasks, they share OPUS_CODEC_STACK_BUDGET, the stack of the former codec task */
+    xTaskCreatePinnedToCore([](void* arg) {
         AudioService* audio_service = (AudioService*)arg;
-        audio_service->OpusCodecTask();
+        audio_service->OpusEncodeTask();
         vTaskDelete(NULL);
-    }, "opus_codec", 2048 * 13, this, 2, &opus_codec_task_handle_);
+    }, "opus_encode", OPUS_ENCODE_TASK_STACK_SIZE, this, CONFIG_OPUS_ENCODE_TASK_PRIORITY,
+        &opus_encode_task_handle_, OPUS_TASK_CORE_ID(CONFIG_OPUS_ENCODE_TASK_CORE));
+
+    xTaskCreatePinnedToCore([](void* arg) {
+        AudioService* audio_service = (AudioService*)arg;
+        audio_service->OpusDecodeTask();
+        vTaskDelete(NULL);
+    }, "opus_decode", OPUS_DECODE_TASK_STACK_SIZE, this, CONFIG_OPUS_DECODE_TASK_PRIORITY,
+        &opus_decode_task_handle_, OPUS_TASK_CORE_ID(CONFIG_OPUS_DECODE_TASK_CORE));
 }
 
 void AudioService::Stop() {
@@ -124,12 +198,22 @@ void AudioService::Stop() {
         AS_EVENT_WAKE_WORD_RUNNING |
         AS_EVENT_AUDIO_PROCESSOR_RUNNING);
 
-    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-    audio_encode_queue_.clear();
-    audio_decode_queue_.clear();
-    audio_playback_queue_.clear();
-    audio_testing_queue_.clear();
-    audio_queue_cv_.notify_all();
+    // The owning tasks recycle what is left when they run again
+    audio_encode_queue_.RequestClear();
+    audio_decode_queue_.RequestClear();
+    jitter_buffer_.Reset();
+    early_packet_buffer_.Clear();
+    audio_playback_queue_.RequestClear();
+    ClearPacketQueue(audio_testing_queue_);
+    NotifyQueueEvent(AS_QUEUE_ALL_BITS);
+}
+
+void AudioService::WaitQueueEvent(EventBits_t bits, TickType_t timeout) {
+    xEventGroupWaitBits(queue_event_group_, bits, pdTRUE, pdFALSE, timeout);
+}
+
+void AudioService::NotifyQueueEvent(EventBits_t bits) {
+    xEventGroupSetBits(queue_event_group_, bits);
 }
 
 bool AudioService::ReadAudioData(std::vector<int16_t>& data, int sample_rate, int samples) {
@@ -137,7 +221,15 @@ bool AudioService::ReadAudioData(std::vector<int16_t>& data, int sample_rate, in
         esp_timer_stop(audio_power_timer_);
         esp_timer_start_periodic(audio_power_timer_, AUDIO_POWER_CHECK_INTERVAL_MS * 1000);
         codec_->EnableInput(true);
+        input_streaming_ = false;
+    }
+
+    uint32_t overruns = codec_->input_dma_overruns();
+    if (input_streaming_) {
+        debug_statistics_.input_dma_overruns[codec_->dma_profile()] += overruns - input_dma_overrun_mark_;
     }
+    input_dma_overrun_mark_ = overruns;
+    input_streaming_ = true;
 
     if (codec_->input_sample_rate() != sample_rate) {
         data.resize(samples * codec_->input_sample_rate() / sample_rate * codec_->input_channels());
@@ -145,25 +237,34 @@ bool AudioService::ReadAudioData(std::vector<int16_t>& data, int sample_rate, in
             return false;
         }
         if (codec_->input_channels() == 2) {
-            auto mic_channel = std::vector<int16_t>(data.size() / 2);
-            auto reference_channel = std::vector<int16_t>(data.size() / 2);
-            for (size_t i = 0, j = 0; i < mic_channel.size(); ++i, j += 2) {
-                mic_channel[i] = data[j];
-                reference_channel[i] = data[j + 1];
-            }
-            auto resampled_mic = std::vector<int16_t>(input_resampler_.GetOutputSamples(mic_channel.size()));
-            auto resampled_reference = std::vector<int16_t>(reference_resampler_.GetOutputSamples(reference_channel.size()));
-            input_resampler_.Process(mic_channel.data(), mic_channel.size(), resampled_mic.data());
-            reference_resampler_.Process(reference_channel.data(), reference_channel.size(), resampled_reference.data());
-            data.resize(resampled_mic.size() + resampled_reference.size());
-            for (size_t i = 0, j = 0; i < resampled_mic.size(); ++i, j += 2) {
-                data[j] = resampled_mic[i];
-                data[j + 1] = resampled_reference[i];
+            // Split mic / reference into the two halves of the scratch buffer, resample each half,
+            // then interleave the results straight back into data
+            size_t frames = data.size() / 2;
+            size_t resampled_frames = input_resampler_.GetOutputSamples(frames);
+            deinterleave_buffer_.resize(frames * 2);
+            int16_t* mic = deinterleave_buffer_.data();
+            int16_t* reference = mic + frames;
+            int16_t* resampled_mic = mic;
+            int16_t* resampled_reference = reference;
+            if (!input_resampler_.polyphase()) {
+                resample_buffer_.resize(resampled_frames * 2);
+                resampled_mic = resample_buffer_.data();
+                resampled_reference = resampled_mic + resampled_frames;
             }
+            DeinterleaveStereo(data.data(), mic, reference, frames);
+            input_resampler_.Process(mic, frames, resampled_mic);
+            reference_resampler_.Process(reference, frames, resampled_reference);
+            data.resize(resampled_frames * 2);
+            InterleaveStereo(resampled_mic, resampled_reference, data.data(), resampled_frames);
+        } else if (input_resampler_.polyphase()) {
+            // Input is always downsampled, so the polyphase engine can work in place
+            size_t resampled_samples = input_resampler_.GetOutputSamples(data.size());
+            input_resampler_.Process(data.data(), data.size(), data.data());
+            data.resize(resampled_samples);
         } else {
-            auto resampled = std::vector<int16_t>(input_resampler_.GetOutputSamples(data.size()));
-            input_resampler_.Process(data.data(), data.size(), resampled.data());
-            data = std::move(resampled);
+            resample_buffer_.resize(input_resampler_.GetOutputSamples(data.size()));
+            input_resampler_.Process(data.data(), data.size(), resample_buffer_.data());
+            data.swap(resample_buffer_);
         }
     } else {
         data.resize(samples * codec_->input_channels());
@@ -189,6 +290,10 @@ bool AudioService::ReadAudioData(std::vector<int16_t>& data, int sample_rate, in
 
 void AudioService::AudioInputTask() {
     while (true) {
+        if (!(xEventGroupGetBits(event_group_) & (AS_EVENT_AUDIO_TESTING_RUNNING |
+            AS_EVENT_WAKE_WORD_RUNNING | AS_EVENT_AUDIO_PROCESSOR_RUNNING))) {
+            input_streaming_ = false;
+        }
         EventBits_t bits = xEventGroupWaitBits(event_group_, AS_EVENT_AUDIO_TESTING_RUNNING |
             AS_EVENT_WAKE_WORD_RUNNING | AS_EVENT_AUDIO_PROCESSOR_RUNNING,
             pdFALSE, pdFALSE, portMAX_DELAY);
@@ -198,36 +303,41 @@ void AudioService::AudioInputTask() {
         }
         if (audio_input_need_warmup_) {
             audio_input_need_warmup_ = false;
+            input_streaming_ = false;
             vTaskDelay(pdMS_TO_TICKS(120));
             continue;
         }
 
         /* Used for audio testing in NetworkConfiguring mode by clicking the BOOT button */
         if (bits & AS_EVENT_AUDIO_TESTING_RUNNING) {
-            if (audio_testing_queue_.size() >= AUDIO_TESTING_MAX_DURATION_MS / OPUS_FRAME_DURATION_MS) {
+            if (audio_testing_queue_.size() >= (size_t)(AUDIO_TESTING_MAX_DURATION_MS / frame_duration_ms_)) {
+                // The testing queue is drained by the main task, it stops the test from there
                 ESP_LOGW(TAG, "Audio testing queue is full, stopping audio testing");
-                EnableAudioTesting(false);
+                xEventGroupClearBits(event_group_, AS_EVENT_AUDIO_TESTING_RUNNING);
+                if (callbacks_.on_audio_testing_queue_full) {
+                    callbacks_.on_audio_testing_queue_full();
+                }
                 continue;
             }
-            std::vector<int16_t> data;
-            int samples = OPUS_FRAME_DURATION_MS * 16000 / 1000;
+            auto& data = input_buffer_;
+            int samples = frame_duration_ms_ * 16000 / 1000;
             if (ReadAudioData(data, 16000, samples)) {
-                // If input channels is 2, we need to fetch the left channel data
+                // If input channels is 2, we need to fetch the left channel data (in place)
                 if (codec_->input_channels() == 2) {
-                    auto mono_data = std::vector<int16_t>(data.size() / 2);
-                    for (size_t i = 0, j = 0; i < mono_data.size(); ++i, j += 2) {
-                        mono_data[i] = data[j];
+                    size_t mono_samples = data.size() / 2;
+                    for (size_t i = 0, j = 0; i < mono_samples; ++i, j += 2) {
+                        data[i] = data[j];
                     }
-                    data = std::move(mono_data);
+                    data.resize(mono_samples);
                 }
-                PushTaskToEncodeQueue(kAudioTaskTypeEncodeToTestingQueue, std::move(data));
+                PushTaskToEncodeQueue(kAudioTaskTypeEncodeToTestingQueue, data);
                 continue;
             }
         }
 
         /* Feed the wake word */
         if (bits & AS_EVENT_WAKE_WORD_RUNNING) {
-            std::vector<int16_t> data;
+            auto& data = input_buffer_;
             int samples = wake_word_->GetFeedSize();
             if (samples > 0) {
                 if (ReadAudioData(data, 16000, samples)) {
@@ -239,7 +349,7 @@ void AudioService::AudioInputTask() {
 
         /* Feed the audio processor */
         if (bits & AS_EVENT_AUDIO_PROCESSOR_RUNNING) {
-            std::vector<int16_t> data;
+            auto& data = input_buffer_;
             int samples = audio_processor_->GetFeedSize();
             if (samples > 0) {
                 if (ReadAudioData(data, 16000, samples)) {
@@ -258,23 +368,54 @@ void AudioService::AudioInputTask() {
 
 void AudioService::AudioOutputTask() {
     while (true) {
-        std::unique_lock<std::mutex> lock(audio_queue_mutex_);
-        audio_queue_cv_.wait(lock, [this]() { return !audio_playback_queue_.empty() || service_stopped_; });
         if (service_stopped_) {
             break;
         }
+        if (RecycleClearedTasks(audio_playback_queue_, playback_task_pool_)) {
+            NotifyQueueEvent(AS_QUEUE_PLAYBACK_POPPED);
+        }
 
-        auto task = std::move(audio_playback_queue_.front());
-        audio_playback_queue_.pop_front();
-        audio_queue_cv_.notify_all();
-        lock.unlock();
+        // A notification sound keeps the output running even with nothing in the playback queue
+        std::unique_ptr<AudioTask> task;
+        bool notification = HasNotification();
+        if (audio_playback_queue_.Pop(task)) {
+            NotifyQueueEvent(AS_QUEUE_PLAYBACK_POPPED);
+        } else if (!notification) {
+            output_streaming_ = false;
+            WaitQueueEvent(AS_QUEUE_PLAYBACK_PUSHED);
+            continue;
+        }
 
         if (!codec_->output_enabled()) {
             esp_timer_stop(audio_power_timer_);
             esp_timer_start_periodic(audio_power_timer_, AUDIO_POWER_CHECK_INTERVAL_MS * 1000);
             codec_->EnableOutput(true);
+            output_streaming_ = false;
+        }
+        int64_t now = esp_timer_get_time();
+        int64_t sound_request_us = sound_request_us_.exchange(0);
+        if (sound_request_us != 0) {
+            debug_statistics_.sound_to_output.Record(now - sound_request_us);
         }
-        codec_->OutputData(task->pcm);
+        if (!task) {
+            size_t frame_samples = codec_->output_sample_rate() * SOUND_PCM_FRAME_MS / 1000;
+            size_t samples = ReadNotification(notification_buffer_, frame_samples);
+            if (samples > 0) {
+                const int16_t* inputs[kAudioMixerSourceCount] = { nullptr, notification_buffer_.data() };
+                MixToCodec(inputs, samples, notification_buffer_);
+                last_output_time_ = std::chrono::steady_clock::now();
+            }
+            continue;
+        }
+
+        // Duck the speech while a notification plays over it, the gain ramps back afterwards
+        mixer_.SetGain(kAudioMixerSourceSpeech, notification ? AUDIO_MIXER_DUCK_GAIN : AUDIO_MIXER_UNITY_GAIN);
+        const int16_t* inputs[kAudioMixerSourceCount] = { task->pcm.data(), nullptr };
+        if (notification && ReadNotification(notification_buffer_, task->pcm.size()) > 0) {
+            inputs[kAudioMixerSourceNotification] = notification_buffer_.data();
+        }
+        debug_statistics_.decode_to_output.Record(now - task->time_us);
+        MixToCodec(inputs, task->pcm.size(), task->pcm);
 
         /* Update the last output time */
         last_output_time_ = std::chrono::steady_clock::now();
@@ -283,160 +424,511 @@ void AudioService::AudioOutputTask() {
 #if CONFIG_USE_SERVER_AEC
         /* Record the timestamp for server AEC */
         if (task->timestamp > 0) {
-            lock.lock();
-            timestamp_queue_.push_back(task->timestamp);
+            timestamp_queue_.Push(std::move(task->timestamp));
         }
 #endif
+        playback_task_pool_.Release(std::move(task));
     }
 
     ESP_LOGW(TAG, "Audio output task stopped");
 }
 
-void AudioService::OpusCodecTask() {
+void AudioService::MixToCodec(const int16_t* const inputs[kAudioMixerSourceCount], size_t samples, std::vector<int16_t>& pcm) {
+    uint32_t underruns = codec_->output_dma_underruns();
+    if (output_streaming_) {
+        debug_statistics_.output_dma_underruns[codec_->dma_profile()] += underruns - output_dma_underrun_mark_;
+    }
+    output_dma_underrun_mark_ = underruns;
+    output_streaming_ = true;
+
+    int slots = codec_->output_native_slots();
+    int64_t mix_start = esp_timer_get_time();
+    if (slots > 0) {
+        // Volume and slot layout are applied by the mixer, the codec only hands the words to I2S
+        native_output_buffer_.resize(samples * slots);
+        mixer_.MixToInt32(inputs, samples, native_output_buffer_.data(), codec_->output_volume_factor(), slots);
+        debug_statistics_.mix_time_us += esp_timer_get_time() - mix_start;
+        codec_->OutputNativeData(native_output_buffer_);
+    } else {
+        mixer_.Mix(inputs, samples, pcm.data());
+        pcm.resize(samples);
+        debug_statistics_.mix_time_us += esp_timer_get_time() - mix_start;
+        codec_->OutputData(pcm);
+    }
+}
+
+void AudioService::OpusDecodeTask() {
+    /* Set when the jitter buffer holds packets but is not ready to release one yet */
+    bool jitter_waiting = false;
     while (true) {
-        std::unique_lock<std::mutex> lock(audio_queue_mutex_);
-        audio_queue_cv_.wait(lock, [this]() {
-            return service_stopped_ ||
-                (!audio_encode_queue_.empty() && audio_send_queue_.size() < MAX_SEND_PACKETS_IN_QUEUE) ||
-                (!audio_decode_queue_.empty() && audio_playback_queue_.size() < MAX_PLAYBACK_TASKS_IN_QUEUE);
-        });
         if (service_stopped_) {
             break;
         }
+        if (RecycleClearedPackets(audio_decode_queue_)) {
+            NotifyQueueEvent(AS_QUEUE_DECODE_POPPED);
+        }
+        if (sound_requested_.exchange(false)) {
+            DecodeRequestedSound();
+        }
 
-        /* Decode the audio from decode queue */
-        if (!audio_decode_queue_.empty() && audio_playback_queue_.size() < MAX_PLAYBACK_TASKS_IN_QUEUE) {
-            auto packet = std::move(audio_decode_queue_.front());
-            audio_decode_queue_.pop_front();
-            audio_queue_cv_.notify_all();
-            lock.unlock();
-
-            auto task = std::make_unique<AudioTask>();
-            task->type = kAudioTaskTypeDecodeToPlaybackQueue;
-            task->timestamp = packet->timestamp;
-
-            SetDecodeSampleRate(packet->sample_rate, packet->frame_duration);
-            if (opus_decoder_->Decode(std::move(packet->payload), task->pcm)) {
-                // Resample if the sample rate is different
-                if (opus_decoder_->sample_rate() != codec_->output_sample_rate()) {
-                    int target_size = output_resampler_.GetOutputSamples(task->pcm.size());
-                    std::vector<int16_t> resampled(target_size);
-                    output_resampler_.Process(task->pcm.data(), task->pcm.size(), resampled.data());
-                    task->pcm = std::move(resampled);
-                }
+        bool playback_has_room = audio_playback_queue_.size() < MAX_PLAYBACK_TASKS_IN_QUEUE;
+        bool can_decode = playback_has_room && (!audio_decode_queue_.empty() || (!jitter_waiting && !jitter_buffer_.empty()));
+        if (!can_decode) {
+            // Poll while the jitter buffer is waiting for its target depth or for a missing packet
+            TickType_t timeout = (playback_has_room && jitter_waiting) ? pdMS_TO_TICKS(JITTER_BUFFER_POLL_MS) : portMAX_DELAY;
+            WaitQueueEvent(AS_QUEUE_DECODE_PUSHED | AS_QUEUE_PLAYBACK_POPPED, timeout);
+            jitter_waiting = false;
+            continue;
+        }
 
-                lock.lock();
-                audio_playback_queue_.push_back(std::move(task));
-                audio_queue_cv_.notify_all();
-            } else {
-                ESP_LOGE(TAG, "Failed to decode audio");
-                lock.lock();
+        /* Decode local sounds from the decode queue first, then the server stream from the jitter buffer */
+        int64_t start_time = esp_timer_get_time();
+        std::unique_ptr<AudioStreamPacket> packet;
+        if (audio_decode_queue_.Pop(packet)) {
+            NotifyQueueEvent(AS_QUEUE_DECODE_POPPED);
+            DecodeToPlaybackQueue(std::move(packet));
+        } else {
+            switch (jitter_buffer_.Pop(packet, start_time / 1000)) {
+            case kJitterBufferPacket:
+                DecodeToPlaybackQueue(std::move(packet), true);
+                break;
+            case kJitterBufferConceal:
+                ConcealToPlaybackQueue();
+                break;
+            case kJitterBufferWait:
+                jitter_waiting = true;
+                break;
+            default:
+                break;
             }
-            debug_statistics_.decode_count++;
         }
-        
+        debug_statistics_.decode_time_us += esp_timer_get_time() - start_time;
+    }
+
+    ESP_LOGW(TAG, "Opus decode task stopped");
+}
+
+void AudioService::OpusEncodeTask() {
+    while (true) {
+        if (service_stopped_) {
+            break;
+        }
+        if (RecycleClearedTasks(audio_encode_queue_, encode_task_pool_)) {
+            NotifyQueueEvent(AS_QUEUE_ENCODE_POPPED);
+        }
+
+        bool can_encode = !audio_encode_queue_.empty() && audio_send_queue_.size() < (size_t)(AUDIO_SEND_MAX_DURATION_MS / frame_duration_ms_);
+        if (!can_encode) {
+            WaitQueueEvent(AS_QUEUE_ENCODE_PUSHED | AS_QUEUE_SEND_POPPED);
+            continue;
+        }
+
         /* Encode the audio to send queue */
-        if (!audio_encode_queue_.empty() && audio_send_queue_.size() < MAX_SEND_PACKETS_IN_QUEUE) {
-            auto task = std::move(audio_encode_queue_.front());
-            audio_encode_queue_.pop_front();
-            audio_queue_cv_.notify_all();
-            lock.unlock();
-
-            auto packet = std::make_unique<AudioStreamPacket>();
-            packet->frame_duration = OPUS_FRAME_DURATION_MS;
-            packet->sample_rate = 16000;
-            packet->timestamp = task->timestamp;
-            if (!opus_encoder_->Encode(std::move(task->pcm), packet->payload)) {
-                ESP_LOGE(TAG, "Failed to encode audio");
-                continue;
-            }
+        std::unique_ptr<AudioTask> task;
+        if (!audio_encode_queue_.Pop(task)) {
+            continue;
+        }
+        NotifyQueueEvent(AS_QUEUE_ENCODE_POPPED);
+
+        int64_t start_time = esp_timer_get_time();
+        // Frames queued before a duration change keep their own size, follow the frame rather than the setting
+        int frame_duration = task->pcm.size() * 1000 / 16000;
+        SetEncodeFrameDuration(frame_duration);
+        auto packet = packet_pool_.Acquire();
+        packet->frame_duration = frame_duration;
+        packet->sample_rate = 16000;
+        packet->timestamp = task->timestamp;
+        // The wrapper takes its input by rvalue reference, hand it a copy so the pooled PCM buffer keeps its capacity
+        encode_pcm_.assign(task->pcm.begin(), task->pcm.end());
+        bool encoded = opus_encoder_->Encode(std::move(encode_pcm_), packet->payload);
+        auto type = task->type;
+        packet->time_us = esp_timer_get_time();
+        debug_statistics_.encode_time_us += packet->time_us - start_time;
+        UpdateEncoderController(packet->time_us - start_time, frame_duration);
+        debug_statistics_.capture_to_encode.Record(packet->time_us - task->time_us);
+        encode_task_pool_.Release(std::move(task));
+        if (!encoded) {
+            ESP_LOGE(TAG, "Failed to encode audio");
+            packet_pool_.Release(std::move(packet));
+            continue;
+        }
 
-            if (task->type == kAudioTaskTypeEncodeToSendQueue) {
-                {
-                    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-                    audio_send_queue_.push_back(std::move(packet));
-                }
-                if (callbacks_.on_send_queue_available) {
-                    callbacks_.on_send_queue_available();
+        if (type == kAudioTaskTypeEncodeToSendQueue) {
+            PushPacketToSendQueue(std::move(packet));
+        } else if (type == kAudioTaskTypeEncodeToTestingQueue) {
+            audio_testing_queue_.Push(std::move(packet));
+        }
+        packet_pool_.Release(std::move(packet));
+        debug_statistics_.encode_count++;
+    }
+
+    ESP_LOGW(TAG, "Opus encode task stopped");
+}
+
+void AudioService::PushPacketToSendQueue(std::unique_ptr<AudioStreamPacket>&& packet) {
+    int64_t now = packet->time_us;
+    // Frames still held back when DTX was turned off are never sent
+    std::unique_ptr<AudioStreamPacket> held;
+    while (dtx_preroll_queue_.PopCleared(held)) {
+        uplink_dtx_stats_.suppressed_packets++;
+        uplink_dtx_stats_.suppressed_bytes += held->payload.size();
+        packet_pool_.Release(std::move(held));
+    }
+    // Device AEC turns the VAD off, then every frame is sent
+    if (uplink_dtx_enabled_ && !device_aec_enabled_) {
+        int64_t last_voice_us = dtx_last_voice_us_;
+        if (voice_detected_) {
+            last_voice_us = now;
+            dtx_last_voice_us_ = now;
+        }
+        if (now - last_voice_us >= UPLINK_DTX_HANGOVER_MS * 1000LL) {
+            if (now - dtx_last_sent_us_ < UPLINK_DTX_KEEPALIVE_MS * 1000LL) {
+                SuppressSilentPacket(std::move(packet));
+                return;
+            }
+            // Keepalive frame, the frames held back before it will never be sent
+            while (dtx_preroll_queue_.Pop(held)) {
+                uplink_dtx_stats_.suppressed_packets++;
+                uplink_dtx_stats_.suppressed_bytes += held->payload.size();
+                packet_pool_.Release(std::move(held));
+            }
+            uplink_dtx_stats_.keepalive_packets++;
+        } else if (!dtx_preroll_queue_.empty()) {
+            // Speech onset, send the held back frames first so the VAD delay does not clip it
+            while (dtx_preroll_queue_.Pop(held)) {
+                if (audio_send_queue_.Push(std::move(held))) {
+                    uplink_dtx_stats_.sent_packets++;
+                } else {
+                    packet_pool_.Release(std::move(held));
                 }
-            } else if (task->type == kAudioTaskTypeEncodeToTestingQueue) {
-                std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-                audio_testing_queue_.push_back(std::move(packet));
             }
-            debug_statistics_.encode_count++;
-            lock.lock();
         }
+        uplink_dtx_stats_.sent_packets++;
+        dtx_last_sent_us_ = now;
+    }
+
+    audio_send_queue_.Push(std::move(packet));
+    packet_pool_.Release(std::move(packet));
+    UpdateHighWater(debug_statistics_.send_queue_max, audio_send_queue_.size());
+    if (callbacks_.on_send_queue_available) {
+        callbacks_.on_send_queue_available();
+    }
+}
+
+void AudioService::SuppressSilentPacket(std::unique_ptr<AudioStreamPacket>&& packet) {
+    // Hold back only the last UPLINK_DTX_PREROLL_MS, the older frames are dropped for good
+    size_t max_packets = std::max(1, UPLINK_DTX_PREROLL_MS / packet->frame_duration);
+    std::unique_ptr<AudioStreamPacket> oldest;
+    while (dtx_preroll_queue_.size() >= max_packets && dtx_preroll_queue_.Pop(oldest)) {
+        uplink_dtx_stats_.suppressed_packets++;
+        uplink_dtx_stats_.suppressed_bytes += oldest->payload.size();
+        packet_pool_.Release(std::move(oldest));
+    }
+    if (!dtx_preroll_queue_.Push(std::move(packet))) {
+        uplink_dtx_stats_.suppressed_packets++;
+        uplink_dtx_stats_.suppressed_bytes += packet->payload.size();
+        packet_pool_.Release(std::move(packet));
+    }
+}
+
+void AudioService::DecodeToPlaybackQueue(std::unique_ptr<AudioStreamPacket>&& packet, bool stream) {
+    auto task = playback_task_pool_.Acquire();
+    task->type = kAudioTaskTypeDecodeToPlaybackQueue;
+    task->timestamp = packet->timestamp;
+
+    SetDecodeSampleRate(packet->sample_rate, packet->frame_duration);
+    if (stream) {
+        stream_sample_rate_ = packet->sample_rate;
+        stream_frame_duration_ = packet->frame_duration;
+    }
+    // Same for the payload, the pooled packet keeps its buffer whatever the wrapper does with its input
+    decode_payload_.assign(packet->payload.begin(), packet->payload.end());
+    if (decoder_->decoder->Decode(std::move(decode_payload_), task->pcm)) {
+        if (stream) {
+            StretchStreamFrame(task->pcm, decoder_->frame_duration);
+        }
+        // Resample if the sample rate is different
+        if (decoder_->resampler) {
+            int target_size = decoder_->resampler->GetOutputSamples(task->pcm.size());
+            output_resample_buffer_.resize(target_size);
+            decoder_->resampler->Process(task->pcm.data(), task->pcm.size(), output_resample_buffer_.data());
+            task->pcm.swap(output_resample_buffer_);
+        }
+        if (stream) {
+            CompensateDrift(task->pcm, decoder_->frame_duration);
+        }
+
+        task->time_us = esp_timer_get_time();
+        debug_statistics_.receive_to_decode.Record(task->time_us - packet->time_us);
+        if (audio_playback_queue_.Push(std::move(task))) {
+            NotifyQueueEvent(AS_QUEUE_PLAYBACK_PUSHED);
+            UpdateHighWater(debug_statistics_.playback_queue_max, audio_playback_queue_.size());
+        }
+    } else {
+        ESP_LOGE(TAG, "Failed to decode audio");
+    }
+    playback_task_pool_.Release(std::move(task));
+    packet_pool_.Release(std::move(packet));
+    debug_statistics_.decode_count++;
+}
+
+void AudioService::ConcealToPlaybackQueue() {
+    if (stream_sample_rate_ == 0) {
+        return;
+    }
+    // A local sound may have been decoded since the last stream frame, switch back to the stream's decoder
+    SetDecodeSampleRate(stream_sample_rate_, stream_frame_duration_);
+    auto task = playback_task_pool_.Acquire();
+    task->type = kAudioTaskTypeDecodeToPlaybackQueue;
+    task->timestamp = 0;
+
+    // An empty payload makes the Opus decoder run its packet loss concealment
+    if (!decoder_->decoder->Decode(std::vector<uint8_t>(), task->pcm)) {
+        ESP_LOGW(TAG, "Opus PLC failed, playing silence");
+        task->pcm.assign(decoder_->sample_rate * decoder_->frame_duration / 1000, 0);
+    }
+    if (decoder_->resampler) {
+        int target_size = decoder_->resampler->GetOutputSamples(task->pcm.size());
+        output_resample_buffer_.resize(target_size);
+        decoder_->resampler->Process(task->pcm.data(), task->pcm.size(), output_resample_buffer_.data());
+        task->pcm.swap(output_resample_buffer_);
+    }
+    CompensateDrift(task->pcm, decoder_->frame_duration);
+
+    task->time_us = esp_timer_get_time();
+    if (audio_playback_queue_.Push(std::move(task))) {
+        NotifyQueueEvent(AS_QUEUE_PLAYBACK_PUSHED);
+        UpdateHighWater(debug_statistics_.playback_queue_max, audio_playback_queue_.size());
+    }
+    playback_task_pool_.Release(std::move(task));
+}
+
+int AudioService::GetBufferedStreamMs(int frame_duration) {
+    // Everything between the network and the DAC, the frame being decoded excluded
+    return (jitter_buffer_.size() + audio_playback_queue_.size()) * frame_duration;
+}
+
+void AudioService::CompensateDrift(std::vector<int16_t>& pcm, int frame_duration) {
+#if CONFIG_USE_DRIFT_COMPENSATION
+    if (drift_reset_.exchange(false)) {
+        drift_compensator_.Reset();
     }
+    int target_ms = jitter_buffer_.GetStats().target_depth * frame_duration;
+    drift_compensator_.Update(GetBufferedStreamMs(frame_duration), target_ms, frame_duration);
+    drift_compensator_.Process(pcm, drift_buffer_);
+#endif
+}
 
-    ESP_LOGW(TAG, "Opus codec task stopped");
+void AudioService::StretchStreamFrame(std::vector<int16_t>& pcm, int frame_duration) {
+#if CONFIG_USE_TIME_STRETCH
+    // Catch up after a burst, and stretch the last frames when the buffer runs dry mid-reply.
+    // Once the server has sent the whole reply an empty buffer is just its end, played as it is
+    auto mode = kTimeStretchNone;
+    int target_ms = jitter_buffer_.GetStats().target_depth * frame_duration;
+    if (GetBufferedStreamMs(frame_duration) > target_ms + TIME_STRETCH_ACCELERATE_MARGIN_MS) {
+        mode = kTimeStretchAccelerate;
+    } else if (jitter_buffer_.empty() && expanded_frames_in_row_ < TIME_STRETCH_MAX_EXPAND_FRAMES &&
+            early_packet_buffer_.IsStreaming()) {
+        mode = kTimeStretchExpand;
+    }
+    expanded_frames_in_row_ = mode == kTimeStretchExpand ? expanded_frames_in_row_ + 1 : 0;
+    time_stretcher_.Process(pcm, decoder_->sample_rate, mode, stretch_buffer_);
+#endif
 }
 
 void AudioService::SetDecodeSampleRate(int sample_rate, int frame_duration) {
-    if (opus_decoder_->sample_rate() == sample_rate && opus_decoder_->duration_ms() == frame_duration) {
+    if (decoder_reset_.exchange(false)) {
+        decoder_cache_.ResetState();
+    }
+    // Each stream keeps its decoder state and resampler history, switching back is a lookup
+    decoder_ = &decoder_cache_.Get(sample_rate, frame_duration);
+}
+
+void AudioService::SetEncodeFrameDuration(int frame_duration) {
+    if (opus_encoder_ && encoder_frame_duration_ms_ == frame_duration) {
         return;
     }
 
-    opus_decoder_.reset();
-    opus_decoder_ = std::make_unique<OpusDecoderWrapper>(sample_rate, 1, frame_duration);
+    opus_encoder_.reset();
+    opus_encoder_ = std::make_unique<OpusEncoderWrapper>(16000, 1, frame_duration);
+    opus_encoder_->SetComplexity(encoder_controller_.complexity());
+    encoder_frame_duration_ms_ = frame_duration;
+}
 
-    auto codec = Board::GetInstance().GetAudioCodec();
-    if (opus_decoder_->sample_rate() != codec->output_sample_rate()) {
-        ESP_LOGI(TAG, "Resampling audio from %d to %d", opus_decoder_->sample_rate(), codec->output_sample_rate());
-        output_resampler_.Configure(opus_decoder_->sample_rate(), codec->output_sample_rate());
+void AudioService::UpdateEncoderController(uint32_t encode_time_us, int frame_duration) {
+    encoder_window_.encode_time_us += encode_time_us;
+    encoder_window_.audio_ms += frame_duration;
+    encoder_window_.send_queue_ms = std::max<uint32_t>(encoder_window_.send_queue_ms, audio_send_queue_.size() * frame_duration);
+    if (encoder_window_.audio_ms < ENCODER_CONTROL_WINDOW_MS) {
+        return;
     }
+
+    encoder_window_.send_failures = pending_send_failures_.exchange(0);
+    if (encoder_controller_.Update(encoder_window_)) {
+        ESP_LOGI(TAG, "Encoder complexity -> %d (%s, cpu %d%%, send queue %lu ms, send failures %lu)",
+            encoder_controller_.complexity(), encoder_controller_.last_reason(), encoder_controller_.cpu_load_percent(),
+            (unsigned long)encoder_window_.send_queue_ms, (unsigned long)encoder_window_.send_failures);
+        opus_encoder_->SetComplexity(encoder_controller_.complexity());
+    }
+    encoder_window_ = EncoderControllerInput();
+}
+
+void AudioService::SetFrameDuration(int frame_duration_ms) {
+    if (frame_duration_ms != 20 && frame_duration_ms != 40 && frame_duration_ms != 60) {
+        ESP_LOGW(TAG, "Unsupported frame duration %d ms, keeping %d ms", frame_duration_ms, frame_duration_ms_);
+        return;
+    }
+    if (frame_duration_ms == frame_duration_ms_) {
+        return;
+    }
+    ESP_LOGI(TAG, "Uplink frame duration changed from %d ms to %d ms", frame_duration_ms_, frame_duration_ms);
+    frame_duration_ms_ = frame_duration_ms;
+    // The encoder follows on the next frame, see OpusEncodeTask
+    if (audio_processor_initialized_) {
+        audio_processor_->SetFrameDuration(frame_duration_ms);
+    }
+}
+
+void AudioService::PushTaskToEncodeQueue(AudioTaskType type, const std::vector<int16_t>& pcm) {
+    // Copy into a pooled buffer, so the caller keeps its own buffer for the next frame
+    auto task = encode_task_pool_.Acquire();
+    task->pcm.assign(pcm.begin(), pcm.end());
+    PushTaskToEncodeQueue(type, std::move(task));
 }
 
 void AudioService::PushTaskToEncodeQueue(AudioTaskType type, std::vector<int16_t>&& pcm) {
-    auto task = std::make_unique<AudioTask>();
+    // The caller gets the recycled buffer of the pooled task back for its next frame
+    auto task = encode_task_pool_.Acquire();
+    task->pcm.swap(pcm);
+    PushTaskToEncodeQueue(type, std::move(task));
+}
+
+void AudioService::PushTaskToEncodeQueue(AudioTaskType type, std::unique_ptr<AudioTask>&& task) {
     task->type = type;
-    task->pcm = std::move(pcm);
-    
-    /* Push the task to the encode queue */
-    std::unique_lock<std::mutex> lock(audio_queue_mutex_);
+    task->timestamp = 0;
+    task->time_us = esp_timer_get_time();
 
     /* If the task is to send queue, we need to set the timestamp */
+    uint32_t timestamp = 0;
+    while (timestamp_queue_.PopCleared(timestamp)) {
+    }
     if (type == kAudioTaskTypeEncodeToSendQueue && !timestamp_queue_.empty()) {
-        if (timestamp_queue_.size() <= MAX_TIMESTAMPS_IN_QUEUE) {
-            task->timestamp = timestamp_queue_.front();
-        } else {
-            ESP_LOGW(TAG, "Timestamp queue (%u) is full, dropping timestamp", timestamp_queue_.size());
+        size_t queued = timestamp_queue_.size();
+        if (timestamp_queue_.Pop(timestamp)) {
+            if (queued <= MAX_TIMESTAMPS_IN_QUEUE) {
+                task->timestamp = timestamp;
+            } else {
+                ESP_LOGW(TAG, "Timestamp queue (%u) is full, dropping timestamp", queued);
+            }
         }
-        timestamp_queue_.pop_front();
     }
 
-    audio_queue_cv_.wait(lock, [this]() { return audio_encode_queue_.size() < MAX_ENCODE_TASKS_IN_QUEUE; });
-    audio_encode_queue_.push_back(std::move(task));
-    audio_queue_cv_.notify_all();
+    /* Push the task to the encode queue, wait for the codec task if it is full */
+    while (!audio_encode_queue_.Push(std::move(task))) {
+        if (service_stopped_) {
+            return;
+        }
+        WaitQueueEvent(AS_QUEUE_ENCODE_POPPED);
+    }
+    NotifyQueueEvent(AS_QUEUE_ENCODE_PUSHED);
+    UpdateHighWater(debug_statistics_.encode_queue_max, audio_encode_queue_.size());
 }
 
 bool AudioService::PushPacketToDecodeQueue(std::unique_ptr<AudioStreamPacket> packet, bool wait) {
-    std::unique_lock<std::mutex> lock(audio_queue_mutex_);
-    if (audio_decode_queue_.size() >= MAX_DECODE_PACKETS_IN_QUEUE) {
-        if (wait) {
-            audio_queue_cv_.wait(lock, [this]() { return audio_decode_queue_.size() < MAX_DECODE_PACKETS_IN_QUEUE; });
-        } else {
+    while (audio_decode_queue_.size() >= MAX_DECODE_PACKETS_IN_QUEUE) {
+        if (!wait || service_stopped_) {
+            packet_pool_.Release(std::move(packet));
             return false;
         }
+        WaitQueueEvent(AS_QUEUE_DECODE_POPPED);
+    }
+    packet->time_us = esp_timer_get_time();
+    if (!audio_decode_queue_.Push(std::move(packet))) {
+        packet_pool_.Release(std::move(packet));
+        return false;
     }
-    audio_decode_queue_.push_back(std::move(packet));
-    audio_queue_cv_.notify_all();
+    NotifyQueueEvent(AS_QUEUE_DECODE_PUSHED);
+    UpdateHighWater(debug_statistics_.decode_queue_max, audio_decode_queue_.size());
+    return true;
+}
+
+bool AudioService::PushPacketToJitterBuffer(std::unique_ptr<AudioStreamPacket> packet) {
+    packet->time_us = esp_timer_get_time();
+    return PushReceivedPacket(std::move(packet));
+}
+
+void AudioService::PushIncomingPacket(std::unique_ptr<AudioStreamPacket> packet, uint32_t reply_id) {
+    packet->time_us = esp_timer_get_time();
+    if (!early_packet_buffer_.Hold(std::move(packet), reply_id)) {
+        PushReceivedPacket(std::move(packet));
+    }
+}
+
+void AudioService::StartReply(uint32_t reply_id) {
+    if (early_packet_buffer_.IsOpen(reply_id)) {
+        return;
+    }
+    // Until Open() every packet is held, so the reset cannot drop anything of this reply
+    ResetDecoder();
+    early_packet_buffer_.Open(reply_id, esp_timer_get_time(), [this](std::unique_ptr<AudioStreamPacket>&& packet) {
+        PushReceivedPacket(std::move(packet));
+    });
+    // "tts stop" may have come before the reset, the jitter buffer must still know the end
+    if (early_packet_buffer_.IsFinished(reply_id)) {
+        jitter_buffer_.Finish();
+    }
+}
+
+void AudioService::FinishReply(uint32_t reply_id) {
+    early_packet_buffer_.Finish(reply_id);
+    // Once open the jitter buffer holds this reply, running empty is then its end
+    if (early_packet_buffer_.IsOpen(reply_id)) {
+        jitter_buffer_.Finish();
+    }
+}
+
+void AudioService::EndReply() {
+    early_packet_buffer_.Close();
+}
+
+void AudioService::ClearEarlyPackets() {
+    early_packet_buffer_.Clear();
+}
+
+bool AudioService::PushReceivedPacket(std::unique_ptr<AudioStreamPacket>&& packet) {
+    // The arrival time, so held packets keep their place in the jitter estimate
+    int64_t arrival_us = packet->time_us;
+    auto end_of_speech_us = end_of_speech_us_.exchange(0);
+    if (end_of_speech_us != 0) {
+        debug_statistics_.end_of_speech_to_tts.Record(arrival_us - end_of_speech_us);
+        ESP_LOGI(TAG, "End of speech to first TTS packet: %ld ms", (long)((arrival_us - end_of_speech_us) / 1000));
+    }
+    if (!jitter_buffer_.Push(std::move(packet), arrival_us / 1000)) {
+        return false;
+    }
+    NotifyQueueEvent(AS_QUEUE_DECODE_PUSHED);
+    UpdateHighWater(debug_statistics_.jitter_buffer_max, jitter_buffer_.size());
     return true;
 }
 
 std::unique_ptr<AudioStreamPacket> AudioService::PopPacketFromSendQueue() {
-    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-    if (audio_send_queue_.empty()) {
+    std::unique_ptr<AudioStreamPacket> packet;
+    if (!audio_send_queue_.Pop(packet)) {
         return nullptr;
     }
-    auto packet = std::move(audio_send_queue_.front());
-    audio_send_queue_.pop_front();
-    audio_queue_cv_.notify_all();
+    NotifyQueueEvent(AS_QUEUE_SEND_POPPED);
+    debug_statistics_.encode_to_send.Record(esp_timer_get_time() - packet->time_us);
     return packet;
 }
 
+void AudioService::ReportSendFailure() {
+    pending_send_failures_++;
+    debug_statistics_.send_failures++;
+}
+
 void AudioService::EncodeWakeWord() {
     if (wake_word_) {
-        wake_word_->EncodeWakeWordData();
+        wake_word_->EncodeWakeWordData(frame_duration_ms_);
     }
 }
 
@@ -445,13 +937,176 @@ const std::string& AudioService::GetLastWakeWord() const {
 }
 
 std::unique_ptr<AudioStreamPacket> AudioService::PopWakeWordPacket() {
-    auto packet = std::make_unique<AudioStreamPacket>();
+    auto packet = packet_pool_.Acquire();
+    packet->sample_rate = 16000;
+    packet->frame_duration = frame_duration_ms_;
+    packet->timestamp = 0;
     if (wake_word_->GetWakeWordOpus(packet->payload)) {
+        auto detected_us = wake_word_detected_us_.exchange(0);
+        if (detected_us != 0) {
+            auto latency_us = esp_timer_get_time() - detected_us;
+            debug_statistics_.wake_word_to_upload.Record(latency_us);
+            ESP_LOGI(TAG, "Wake word to first uploaded packet: %ld ms", (long)(latency_us / 1000));
+        }
         return packet;
     }
+    packet_pool_.Release(std::move(packet));
     return nullptr;
 }
 
+static cJSON* LatencyHistogramToJson(const LatencyHistogram& histogram) {
+    cJSON* json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(json, "count", histogram.count);
+    cJSON_AddNumberToObject(json, "avg_ms", histogram.count > 0 ? histogram.total_us / histogram.count / 1000.0 : 0);
+    cJSON_AddNumberToObject(json, "max_ms", histogram.max_us / 1000.0);
+    cJSON* buckets = cJSON_CreateArray();
+    for (int i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+        cJSON_AddItemToArray(buckets, cJSON_CreateNumber(histogram.buckets[i]));
+    }
+    cJSON_AddItemToObject(json, "buckets", buckets);
+    return json;
+}
+
+cJSON* AudioService::GetStatisticsJson() {
+    const auto& stats = debug_statistics_;
+    cJSON* json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(json, "input_count", stats.input_count);
+    cJSON_AddNumberToObject(json, "encode_count", stats.encode_count);
+    cJSON_AddNumberToObject(json, "decode_count", stats.decode_count);
+    cJSON_AddNumberToObject(json, "playback_count", stats.playback_count);
+    cJSON_AddNumberToObject(json, "encode_time_ms", stats.encode_time_us / 1000);
+    cJSON_AddNumberToObject(json, "decode_time_ms", stats.decode_time_us / 1000);
+    cJSON_AddNumberToObject(json, "mix_time_ms", stats.mix_time_us / 1000);
+    cJSON_AddNumberToObject(json, "pool_exhausted", GetPoolExhaustedCount());
+    cJSON_AddNumberToObject(json, "send_failures", stats.send_failures);
+
+    // Stack high-water marks, the handles are only valid while the tasks run
+    if (!service_stopped_) {
+        const std::pair<const char*, TaskHandle_t> tasks[] = {
+            { "audio_input", audio_input_task_handle_ },
+            { "audio_output", audio_output_task_handle_ },
+            { "opus_encode", opus_encode_task_handle_ },
+            { "opus_decode", opus_decode_task_handle_ },
+        };
+        cJSON* stack_json = cJSON_CreateObject();
+        for (const auto& [name, handle] : tasks) {
+            if (handle == nullptr) {
+                continue;
+            }
+            unsigned free_bytes = uxTaskGetStackHighWaterMark(handle);
+            if (free_bytes < AUDIO_TASK_STACK_MIN_FREE) {
+                ESP_LOGW(TAG, "Task %s has only %u bytes of stack left", name, free_bytes);
+            }
+            cJSON_AddNumberToObject(stack_json, name, free_bytes);
+        }
+        cJSON_AddItemToObject(json, "stack_free", stack_json);
+    }
+
+    cJSON* encoder = cJSON_CreateObject();
+    cJSON_AddNumberToObject(encoder, "complexity", encoder_controller_.complexity());
+    cJSON_AddNumberToObject(encoder, "cpu_load_percent", encoder_controller_.cpu_load_percent());
+    cJSON_AddBoolToObject(encoder, "congested", encoder_controller_.congested());
+    cJSON_AddNumberToObject(encoder, "step_up_count", encoder_controller_.step_up_count());
+    cJSON_AddNumberToObject(encoder, "step_down_count", encoder_controller_.step_down_count());
+    cJSON_AddStringToObject(encoder, "last_reason", encoder_controller_.last_reason());
+    cJSON_AddItemToObject(json, "encoder", encoder);
+
+    static const int bounds_ms[] = LATENCY_HISTOGRAM_BOUNDS_MS;
+    cJSON* latency = cJSON_CreateObject();
+    cJSON_AddItemToObject(latency, "bucket_bounds_ms", cJSON_CreateIntArray(bounds_ms, LATENCY_HISTOGRAM_BUCKETS - 1));
+    cJSON_AddItemToObject(latency, "capture_to_encode", LatencyHistogramToJson(stats.capture_to_encode));
+    cJSON_AddItemToObject(latency, "encode_to_send", LatencyHistogramToJson(stats.encode_to_send));
+    cJSON_AddItemToObject(latency, "receive_to_decode", LatencyHistogramToJson(stats.receive_to_decode));
+    cJSON_AddItemToObject(latency, "decode_to_output", LatencyHistogramToJson(stats.decode_to_output));
+    cJSON_AddItemToObject(latency, "sound_to_output", LatencyHistogramToJson(stats.sound_to_output));
+    cJSON_AddItemToObject(latency, "wake_word_to_upload", LatencyHistogramToJson(stats.wake_word_to_upload));
+    cJSON_AddItemToObject(latency, "voice_processing_start", LatencyHistogramToJson(stats.voice_processing_start));
+    cJSON_AddItemToObject(latency, "end_of_speech_to_tts", LatencyHistogramToJson(stats.end_of_speech_to_tts));
+    cJSON_AddItemToObject(json, "latency", latency);
+
+    cJSON* high_water = cJSON_CreateObject();
+    cJSON_AddNumberToObject(high_water, "encode", stats.encode_queue_max);
+    cJSON_AddNumberToObject(high_water, "send", stats.send_queue_max);
+    cJSON_AddNumberToObject(high_water, "decode", stats.decode_queue_max);
+    cJSON_AddNumberToObject(high_water, "jitter_buffer", stats.jitter_buffer_max);
+    cJSON_AddNumberToObject(high_water, "playback", stats.playback_queue_max);
+    cJSON_AddItemToObject(json, "queue_high_water", high_water);
+
+    auto jitter = jitter_buffer_.GetStats();
+    cJSON* jitter_json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(jitter_json, "depth", jitter.depth);
+    cJSON_AddNumberToObject(jitter_json, "target_depth", jitter.target_depth);
+    cJSON_AddNumberToObject(jitter_json, "jitter_ms", jitter.jitter_ms);
+    cJSON_AddNumberToObject(jitter_json, "late_packets", jitter.late_packets);
+    cJSON_AddNumberToObject(jitter_json, "dropped_packets", jitter.dropped_packets);
+    cJSON_AddNumberToObject(jitter_json, "concealed_frames", jitter.concealed_frames);
+    cJSON_AddNumberToObject(jitter_json, "underruns", jitter.underruns);
+    cJSON_AddItemToObject(json, "jitter_buffer", jitter_json);
+
+    auto early = early_packet_buffer_.GetStats();
+    cJSON* early_json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(early_json, "held_packets", early.held_packets);
+    cJSON_AddNumberToObject(early_json, "rescued_packets", early.rescued_packets);
+    cJSON_AddNumberToObject(early_json, "expired_packets", early.expired_packets);
+    cJSON_AddItemToObject(json, "early_packets", early_json);
+
+    cJSON* drift_json = cJSON_CreateObject();
+    cJSON_AddBoolToObject(drift_json, "steady", drift_compensator_.steady());
+    cJSON_AddNumberToObject(drift_json, "drift_ppm", drift_compensator_.drift_ppm());
+    cJSON_AddNumberToObject(drift_json, "correction_ppm", drift_compensator_.correction_ppm());
+    cJSON_AddNumberToObject(drift_json, "level_ms", drift_compensator_.level_ms());
+    cJSON_AddNumberToObject(drift_json, "inserted_samples", drift_compensator_.inserted_samples());
+    cJSON_AddNumberToObject(drift_json, "dropped_samples", drift_compensator_.dropped_samples());
+    cJSON_AddItemToObject(json, "drift", drift_json);
+
+    auto& stretch = time_stretcher_.stats();
+    cJSON* stretch_json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(stretch_json, "accelerated_frames", stretch.accelerated_frames);
+    cJSON_AddNumberToObject(stretch_json, "expanded_frames", stretch.expanded_frames);
+    cJSON_AddNumberToObject(stretch_json, "removed_samples", stretch.removed_samples);
+    cJSON_AddNumberToObject(stretch_json, "added_samples", stretch.added_samples);
+    cJSON_AddNumberToObject(stretch_json, "rejected_segments", stretch.rejected_segments);
+    cJSON_AddItemToObject(json, "time_stretch", stretch_json);
+
+    cJSON* decoder_json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(decoder_json, "cached_switches", decoder_cache_.hits());
+    cJSON_AddNumberToObject(decoder_json, "created", decoder_cache_.misses());
+    cJSON_AddItemToObject(json, "decoder_cache", decoder_json);
+
+    cJSON* i2s_json = cJSON_CreateObject();
+    cJSON_AddBoolToObject(i2s_json, "low_latency", codec_->dma_profile() == kAudioCodecDmaProfileLowLatency);
+    cJSON_AddNumberToObject(i2s_json, "dma_desc_num", codec_->dma_desc_num());
+    cJSON_AddNumberToObject(i2s_json, "dma_frame_num", codec_->dma_frame_num());
+    static const char* profile_names[kAudioCodecDmaProfileCount] = { "default", "low_latency" };
+    cJSON* underruns_json = cJSON_CreateObject();
+    cJSON* overruns_json = cJSON_CreateObject();
+    for (int i = 0; i < kAudioCodecDmaProfileCount; i++) {
+        cJSON_AddNumberToObject(underruns_json, profile_names[i], stats.output_dma_underruns[i]);
+        cJSON_AddNumberToObject(overruns_json, profile_names[i], stats.input_dma_overruns[i]);
+    }
+    cJSON_AddItemToObject(i2s_json, "output_underruns", underruns_json);
+    cJSON_AddItemToObject(i2s_json, "input_overruns", overruns_json);
+    cJSON_AddItemToObject(json, "i2s", i2s_json);
+
+    cJSON* dtx_json = cJSON_CreateObject();
+    cJSON_AddBoolToObject(dtx_json, "enabled", uplink_dtx_enabled_);
+    cJSON_AddNumberToObject(dtx_json, "sent_packets", uplink_dtx_stats_.sent_packets);
+    cJSON_AddNumberToObject(dtx_json, "keepalive_packets", uplink_dtx_stats_.keepalive_packets);
+    cJSON_AddNumberToObject(dtx_json, "suppressed_packets", uplink_dtx_stats_.suppressed_packets);
+    cJSON_AddNumberToObject(dtx_json, "suppressed_bytes", uplink_dtx_stats_.suppressed_bytes);
+    cJSON_AddItemToObject(json, "uplink_dtx", dtx_json);
+    return json;
+}
+
+void AudioService::ResetStatistics() {
+    // The audio tasks may be updating counters at the same time, a lost increment is fine here
+    debug_statistics_ = DebugStatistics();
+}
+
+uint32_t AudioService::GetPoolExhaustedCount() const {
+    return packet_pool_.exhausted_count() + encode_task_pool_.exhausted_count() + playback_task_pool_.exhausted_count();
+}
+
 void AudioService::EnableWakeWordDetection(bool enable) {
     if (!wake_word_) {
         return;
@@ -478,13 +1133,19 @@ void AudioService::EnableVoiceProcessing(bool enable) {
     ESP_LOGD(TAG, "%s voice processing", enable ? "Enabling" : "Disabling");
     if (enable) {
         if (!audio_processor_initialized_) {
-            audio_processor_->Initialize(codec_, OPUS_FRAME_DURATION_MS, models_list_);
+            audio_processor_->Initialize(codec_, frame_duration_ms_, models_list_);
             audio_processor_initialized_ = true;
         }
 
         /* We should make sure no audio is playing */
         ResetDecoder();
+#if CONFIG_USE_SHARED_AFE
+        // A shared AFE that is already running for the wake word needs no warmup
+        audio_input_need_warmup_ = !shared_afe_->IsRunning();
+#else
         audio_input_need_warmup_ = true;
+#endif
+        voice_processing_enabled_us_ = esp_timer_get_time();
         audio_processor_->Start();
         xEventGroupSetBits(event_group_, AS_EVENT_AUDIO_PROCESSOR_RUNNING);
     } else {
@@ -499,23 +1160,80 @@ void AudioService::EnableAudioTesting(bool enable) {
         xEventGroupSetBits(event_group_, AS_EVENT_AUDIO_TESTING_RUNNING);
     } else {
         xEventGroupClearBits(event_group_, AS_EVENT_AUDIO_TESTING_RUNNING);
-        /* Copy audio_testing_queue_ to audio_decode_queue_ */
-        std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-        audio_decode_queue_ = std::move(audio_testing_queue_);
-        audio_queue_cv_.notify_all();
+        /* Move audio_testing_queue_ to audio_decode_queue_, the decode task recycles what was queued before */
+        audio_decode_queue_.RequestClear();
+        NotifyQueueEvent(AS_QUEUE_DECODE_PUSHED);
+        std::unique_ptr<AudioStreamPacket> packet;
+        while (audio_testing_queue_.Pop(packet)) {
+            packet->time_us = esp_timer_get_time();
+            while (!audio_decode_queue_.Push(std::move(packet))) {
+                if (service_stopped_) {
+                    packet_pool_.Release(std::move(packet));
+                    break;
+                }
+                WaitQueueEvent(AS_QUEUE_DECODE_POPPED);
+            }
+        }
+        NotifyQueueEvent(AS_QUEUE_DECODE_PUSHED);
     }
 }
 
 void AudioService::EnableDeviceAec(bool enable) {
     ESP_LOGI(TAG, "%s device AEC", enable ? "Enabling" : "Disabling");
+    device_aec_enabled_ = enable;
     if (!audio_processor_initialized_) {
-        audio_processor_->Initialize(codec_, OPUS_FRAME_DURATION_MS, models_list_);
+        audio_processor_->Initialize(codec_, frame_duration_ms_, models_list_);
         audio_processor_initialized_ = true;
     }
 
     audio_processor_->EnableDeviceAec(enable);
 }
 
+void AudioService::EnableUplinkDtx(bool enable) {
+    ESP_LOGI(TAG, "%s uplink DTX", enable ? "Enabling" : "Disabling");
+    // Start with a hangover, so the first frames after listening starts are always sent. Stored
+    // before the flag, so the encode task never sees DTX enabled with an old voice time
+    dtx_last_voice_us_ = esp_timer_get_time();
+    uplink_dtx_enabled_ = enable;
+    if (!enable) {
+        // Dropped by the encode task with its next frame
+        dtx_preroll_queue_.RequestClear();
+    }
+}
+
+void AudioService::EnableLowLatency(bool enable) {
+#if CONFIG_USE_LOW_LATENCY_I2S
+    // Takes effect at the next codec read or write
+    codec_->SetDmaProfile(enable ? kAudioCodecDmaProfileLowLatency : kAudioCodecDmaProfileDefault);
+#endif
+}
+
+void AudioService::EnableEndpointer(bool enable) {
+    ESP_LOGI(TAG, "%s device endpointer", enable ? "Enabling" : "Disabling");
+    endpointer_reset_ = true;
+    endpointer_enabled_ = enable;
+}
+
+bool AudioService::ProcessEndpointer(size_t samples) {
+    if (endpointer_reset_.exchange(false)) {
+        endpointer_.Reset();
+    }
+    if (endpointer_.endpoint_reached()) {
+        return false;
+    }
+    auto reason = endpointer_.Process(voice_detected_, samples * 1000 / 16000);
+    if (reason == kEndpointNone) {
+        return true;
+    }
+    ESP_LOGI(TAG, "End of utterance (%s), %d ms of trailing silence",
+        reason == kEndpointSilence ? "silence" : "max length", endpointer_.trailing_silence_ms());
+    if (callbacks_.on_end_of_utterance) {
+        callbacks_.on_end_of_utterance();
+    }
+    // The frame that reached the endpoint is still sent, nothing after it
+    return true;
+}
+
 void AudioService::SetCallbacks(AudioServiceCallbacks& callbacks) {
     callbacks_ = callbacks;
 }
@@ -527,111 +1245,223 @@ void AudioService::PlaySound(const std::string_view& ogg) {
         codec_->EnableOutput(true);
     }
 
-    const uint8_t* buf = reinterpret_cast<const uint8_t*>(ogg.data());
-    size_t size = ogg.size();
-    size_t offset = 0;
+    int64_t expected = 0;
+    sound_request_us_.compare_exchange_strong(expected, esp_timer_get_time());
 
-    auto find_page = [&](size_t start)->size_t {
-        for (size_t i = start; i + 4 <= size; ++i) {
-            if (buf[i] == 'O' && buf[i+1] == 'g' && buf[i+2] == 'g' && buf[i+3] == 'S') return i;
+    int output_sample_rate = codec_->output_sample_rate();
+    std::shared_ptr<PcmSound> pcm;
+#if CONFIG_USE_SOUND_PCM_CACHE
+    pcm = sound_cache_.GetPcm(ogg, output_sample_rate);
+#endif
+    if (pcm) {
+        {
+            std::lock_guard<std::mutex> lock(notification_mutex_);
+            notification_sound_ = std::move(pcm);
+            notification_offset_ = 0;
+            notification_playing_ = true;
         }
-        return static_cast<size_t>(-1);
-    };
+        NotifyQueueEvent(AS_QUEUE_PLAYBACK_PUSHED);
+        return;
+    }
 
-    bool seen_head = false;
-    bool seen_tags = false;
-    int sample_rate = 16000; // 默认值
+    auto sound = sound_cache_.Get(ogg);
+    if (sound == nullptr) {
+        ESP_LOGE(TAG, "Failed to parse sound of %u bytes", (unsigned)ogg.size());
+        return;
+    }
 
-    while (true) {
-        size_t pos = find_page(offset);
-        if (pos == static_cast<size_t>(-1)) break;
-        offset = pos;
-        if (offset + 27 > size) break;
-
-        const uint8_t* page = buf + offset;
-        uint8_t page_segments = page[26];
-        size_t seg_table_off = offset + 27;
-        if (seg_table_off + page_segments > size) break;
-
-        size_t body_size = 0;
-        for (size_t i = 0; i < page_segments; ++i) body_size += page[27 + i];
-
-        size_t body_off = seg_table_off + page_segments;
-        if (body_off + body_size > size) break;
-
-        // Parse packets using lacing
-        size_t cur = body_off;
-        size_t seg_idx = 0;
-        while (seg_idx < page_segments) {
-            size_t pkt_len = 0;
-            size_t pkt_start = cur;
-            bool continued = false;
-            do {
-                uint8_t l = page[27 + seg_idx++];
-                pkt_len += l;
-                cur += l;
-                continued = (l == 255);
-            } while (continued && seg_idx < page_segments);
-
-            if (pkt_len == 0) continue;
-            const uint8_t* pkt_ptr = buf + pkt_start;
-
-            if (!seen_head) {
-                // 解析OpusHead包
-                if (pkt_len >= 19 && std::memcmp(pkt_ptr, "OpusHead", 8) == 0) {
-                    seen_head = true;
-                    
-                    // OpusHead结构：[0-7] "OpusHead", [8] version, [9] channel_count, [10-11] pre_skip
-                    // [12-15] input_sample_rate, [16-17] output_gain, [18] mapping_family
-                    if (pkt_len >= 12) {
-                        uint8_t version = pkt_ptr[8];
-                        uint8_t channel_count = pkt_ptr[9];
-                        
-                        if (pkt_len >= 16) {
-                            // 读取输入采样率 (little-endian)
-                            sample_rate = pkt_ptr[12] | (pkt_ptr[13] << 8) | 
-                                        (pkt_ptr[14] << 16) | (pkt_ptr[15] << 24);
-                            ESP_LOGI(TAG, "OpusHead: version=%d, channels=%d, sample_rate=%d", 
-                                   version, channel_count, sample_rate);
-                        }
-                    }
-                }
-                continue;
-            }
-            if (!seen_tags) {
-                // Expect OpusTags in second packet
-                if (pkt_len >= 8 && std::memcmp(pkt_ptr, "OpusTags", 8) == 0) {
-                    seen_tags = true;
-                }
-                continue;
-            }
+    // Speech is playing, have the decode task decode the sound so it is mixed over the speech
+    // instead of queued behind it. Without PSRAM for the PCM it is queued behind the speech.
+    if ((!audio_playback_queue_.empty() || !jitter_buffer_.empty()) &&
+        heap_caps_get_free_size(MALLOC_CAP_SPIRAM) >= MaxSoundSamples(*sound, output_sample_rate) * sizeof(int16_t)) {
+        {
+            std::lock_guard<std::mutex> lock(notification_mutex_);
+            requested_sound_ = ogg;
+        }
+        sound_requested_ = true;
+        NotifyQueueEvent(AS_QUEUE_DECODE_PUSHED);
+        return;
+    }
+
+    const uint8_t* buf = reinterpret_cast<const uint8_t*>(ogg.data());
+    for (const auto& ref : sound->packets) {
+        // Pooled packets keep their buffer, so this is a copy without allocation
+        auto packet = packet_pool_.Acquire();
+        packet->sample_rate = sound->sample_rate;
+        packet->frame_duration = SOUND_FRAME_DURATION_MS;
+        packet->timestamp = 0;
+        packet->payload.assign(buf + ref.offset, buf + ref.offset + ref.length);
+        PushPacketToDecodeQueue(std::move(packet), true);
+    }
+}
+
+bool AudioService::PreloadSound(const std::string_view& ogg) {
+#if CONFIG_USE_SOUND_PCM_CACHE
+    int output_sample_rate = codec_->output_sample_rate();
+    if (sound_cache_.GetPcm(ogg, output_sample_rate)) {
+        return true;
+    }
+    auto pcm = DecodeSound(ogg, output_sample_rate);
+    if (!pcm || !sound_cache_.PutPcm(ogg, pcm)) {
+        return false;
+    }
+    ESP_LOGI(TAG, "Cached %u ms of sound PCM, %u bytes in cache", (unsigned)(pcm->samples * 1000 / output_sample_rate),
+        (unsigned)sound_cache_.pcm_bytes());
+    return true;
+#else
+    return false;
+#endif
+}
+
+std::shared_ptr<PcmSound> AudioService::DecodeSound(const std::string_view& ogg, int output_sample_rate) {
+    auto sound = sound_cache_.Get(ogg);
+    if (sound == nullptr) {
+        return nullptr;
+    }
+
+    // Allocate the PSRAM buffer before decoding anything, without PSRAM this fails right away
+    size_t max_samples = MaxSoundSamples(*sound, output_sample_rate);
+    auto decoded = std::make_shared<PcmSound>(max_samples, output_sample_rate);
+    if (decoded->data == nullptr) {
+        ESP_LOGW(TAG, "Failed to allocate %u bytes of sound PCM", (unsigned)(max_samples * sizeof(int16_t)));
+        return nullptr;
+    }
 
-            // Audio packet (Opus)
-            auto packet = std::make_unique<AudioStreamPacket>();
-            packet->sample_rate = sample_rate;
-            packet->frame_duration = 60;
-            packet->payload.resize(pkt_len);
-            std::memcpy(packet->payload.data(), pkt_ptr, pkt_len);
-            PushPacketToDecodeQueue(std::move(packet), true);
+    // Decode with a private decoder, the playback decoder keeps the state of the stream. Both live on
+    // the heap, the SILK resampler state alone would take a good part of the decode task's stack
+    auto decoder = std::make_unique<OpusDecoderWrapper>(sound->sample_rate, 1, SOUND_FRAME_DURATION_MS);
+    auto resampler = std::make_unique<AudioResampler>(POLYPHASE_OUTPUT_RESAMPLER);
+    if (sound->sample_rate != output_sample_rate) {
+        resampler->Configure(sound->sample_rate, output_sample_rate);
+    }
+    const uint8_t* buf = reinterpret_cast<const uint8_t*>(ogg.data());
+    std::vector<int16_t> frame;
+    std::vector<uint8_t> payload;
+    size_t samples = 0;
+    for (const auto& ref : sound->packets) {
+        payload.assign(buf + ref.offset, buf + ref.offset + ref.length);
+        if (!decoder->Decode(std::move(payload), frame)) {
+            ESP_LOGE(TAG, "Failed to decode sound");
+            return nullptr;
+        }
+        int16_t* out = decoded->data + samples;
+        size_t count = frame.size();
+        if (sound->sample_rate != output_sample_rate) {
+            count = resampler->GetOutputSamples(frame.size());
         }
+        if (samples + count > max_samples) {
+            ESP_LOGE(TAG, "Sound frame larger than %d ms", SOUND_FRAME_DURATION_MS);
+            return nullptr;
+        }
+        if (sound->sample_rate != output_sample_rate) {
+            resampler->Process(frame.data(), frame.size(), out);
+        } else {
+            std::copy(frame.begin(), frame.end(), out);
+        }
+        samples += count;
+    }
+    // The tail of the buffer stays unused, at most a sample per packet plus a short last frame
+    decoded->samples = samples;
+    return decoded;
+}
+
+void AudioService::DecodeRequestedSound() {
+    std::string_view ogg;
+    {
+        std::lock_guard<std::mutex> lock(notification_mutex_);
+        ogg = requested_sound_;
+        requested_sound_ = std::string_view();
+    }
+    if (ogg.empty()) {
+        return;
+    }
+    auto pcm = DecodeSound(ogg, codec_->output_sample_rate());
+    if (!pcm) {
+        ESP_LOGW(TAG, "Dropped sound of %u bytes", (unsigned)ogg.size());
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(notification_mutex_);
+        notification_sound_ = std::move(pcm);
+        notification_offset_ = 0;
+        notification_playing_ = true;
+    }
+    NotifyQueueEvent(AS_QUEUE_PLAYBACK_PUSHED);
+}
+
+bool AudioService::HasNotification() {
+    // Checked by the output task on every frame, without the lock
+    return notification_playing_;
+}
 
-        offset = body_off + body_size;
+size_t AudioService::ReadNotification(std::vector<int16_t>& pcm, size_t samples) {
+    // Always fills `samples`, with silence after the end of the sound
+    pcm.resize(samples);
+    if (!notification_playing_) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(notification_mutex_);
+    if (!notification_sound_) {
+        return 0;
+    }
+    size_t count = std::min(samples, notification_sound_->samples - notification_offset_);
+    const int16_t* data = notification_sound_->data + notification_offset_;
+    std::copy(data, data + count, pcm.begin());
+    std::fill(pcm.begin() + count, pcm.end(), 0);
+    notification_offset_ += count;
+    if (notification_offset_ >= notification_sound_->samples) {
+        notification_sound_.reset();
+        notification_playing_ = false;
     }
+    return count;
 }
 
 bool AudioService::IsIdle() {
-    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-    return audio_encode_queue_.empty() && audio_decode_queue_.empty() && audio_playback_queue_.empty() && audio_testing_queue_.empty();
+    if (HasNotification()) {
+        return false;
+    }
+    return audio_encode_queue_.empty() && audio_decode_queue_.empty() && jitter_buffer_.empty() &&
+        audio_playback_queue_.empty() && audio_testing_queue_.empty();
 }
 
 void AudioService::ResetDecoder() {
-    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-    opus_decoder_->ResetState();
-    timestamp_queue_.clear();
-    audio_decode_queue_.clear();
-    audio_playback_queue_.clear();
-    audio_testing_queue_.clear();
-    audio_queue_cv_.notify_all();
+    // Applied by the decode task before the next packet, the queues are emptied by their consumers
+    decoder_reset_ = true;
+    timestamp_queue_.RequestClear();
+    audio_decode_queue_.RequestClear();
+    jitter_buffer_.Reset();
+    drift_reset_ = true;
+    audio_playback_queue_.RequestClear();
+    ClearPacketQueue(audio_testing_queue_);
+    NotifyQueueEvent(AS_QUEUE_DECODE_PUSHED | AS_QUEUE_PLAYBACK_PUSHED);
+}
+
+void AudioService::ClearPacketQueue(AudioQueue<std::unique_ptr<AudioStreamPacket>>& queue) {
+    // Only for queues consumed by the calling task, the packets go back to the pool
+    std::unique_ptr<AudioStreamPacket> packet;
+    while (queue.Pop(packet)) {
+        packet_pool_.Release(std::move(packet));
+    }
+}
+
+bool AudioService::RecycleClearedPackets(AudioQueue<std::unique_ptr<AudioStreamPacket>>& queue) {
+    bool recycled = false;
+    std::unique_ptr<AudioStreamPacket> packet;
+    while (queue.PopCleared(packet)) {
+        packet_pool_.Release(std::move(packet));
+        recycled = true;
+    }
+    return recycled;
+}
+
+bool AudioService::RecycleClearedTasks(AudioQueue<std::unique_ptr<AudioTask>>& queue, AudioPool<AudioTask>& pool) {
+    bool recycled = false;
+    std::unique_ptr<AudioTask> task;
+    while (queue.PopCleared(task)) {
+        pool.Release(std::move(task));
+        recycled = true;
+    }
+    return recycled;
 }
 
 void AudioService::CheckAndUpdateAudioPowerState() {
@@ -656,7 +1486,11 @@ void AudioService::SetModelsList(srmodel_list_t* models_list) {
     if (esp_srmodel_filter(models_list_, ESP_MN_PREFIX, NULL) != nullptr) {
         wake_word_ = std::make_unique<CustomWakeWord>();
     } else if (esp_srmodel_filter(models_list_, ESP_WN_PREFIX, NULL) != nullptr) {
+#if CONFIG_USE_SHARED_AFE
+        wake_word_ = std::make_unique<SharedAfeWakeWord>(shared_afe_);
+#else
         wake_word_ = std::make_unique<AfeWakeWord>();
+#endif
     } else {
         wake_word_ = nullptr;
     }
@@ -670,6 +1504,7 @@ void AudioService::SetModelsList(srmodel_list_t* models_list) {
 
     if (wake_word_) {
         wake_word_->OnWakeWordDetected([this](const std::string& wake_word) {
+            wake_word_detected_us_ = esp_timer_get_time();
             if (callbacks_.on_wake_word_detected) {
                 callbacks_.on_wake_word_detected(wake_word);
             }
@@ -679,6 +1514,11 @@ void AudioService::SetModelsList(srmodel_list_t* models_list) {
 
 bool AudioService::IsAfeWakeWord() {
 #if CONFIG_IDF_TARGET_ESP32S3 || CONFIG_IDF_TARGET_ESP32P4
+#if CONFIG_USE_SHARED_AFE
+    if (wake_word_ != nullptr && dynamic_cast<SharedAfeWakeWord*>(wake_word_.get()) != nullptr) {
+        return true;
+    }
+#endif
     return wake_word_ != nullptr && dynamic_cast<AfeWakeWord*>(wake_word_.get()) != nullptr;
 #else
     return false;
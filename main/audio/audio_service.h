@@ -6,6 +6,8 @@
 #include <condition_variable>
 #include <chrono>
 #include <mutex>
+#include <atomic>
+#include <algorithm>
 
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
@@ -15,33 +17,131 @@
 
 #include <opus_encoder.h>
 #include <opus_decoder.h>
-#include <opus_resampler.h>
 
 #include "audio_codec.h"
+#include "audio_queue.h"
+#include "audio_pool.h"
+#include "audio_resampler.h"
+#include "jitter_buffer.h"
+#include "early_packet_buffer.h"
+#include "drift_compensator.h"
+#include "time_stretcher.h"
+#include "decoder_cache.h"
+#include "encoder_controller.h"
+#include "endpointer.h"
+#include "sound_cache.h"
+#include "audio_mixer.h"
 #include "audio_processor.h"
 #include "processors/audio_debugger.h"
 #include "wake_word.h"
 #include "protocol.h"
 
+class SharedAfe;
 
 /*
  * There are two types of audio data flow:
  * 1. (MIC) -> [Processors] -> {Encode Queue} -> [Opus Encoder] -> {Send Queue} -> (Server)
  * 2. (Server) -> {Decode Queue} -> [Opus Decoder] -> {Playback Queue} -> (Speaker)
  *
- * We use one task for MIC / Speaker / Processors, and one task for Opus Encoder / Opus Decoder.
+ * We use one task for MIC / Speaker / Processors, and separate tasks for Opus Encoder and Opus Decoder,
+ * so a slow decode never delays mic encoding in realtime mode (and the other way around).
  * 
  * Decode Queue and Send Queue are the main queues, because Opus packets are quite smaller than PCM packets.
- * 
+ *
+ * Every queue is a bounded lock-free SPSC ring with its own wakeup bits in queue_event_group_, so a task
+ * is only woken up by the queues it is actually waiting on. A queue is only emptied by its consumer:
+ * ResetDecoder() and Stop() request the clear and the owning task recycles the items.
+ *
+ * Packets from the server go through a jitter buffer instead of the decode queue. It reorders them
+ * and lets the decoder conceal lost frames; local sounds and audio testing still use the decode queue.
+ *
+ * The output task mixes a decoded notification sound over the speech (ducked while it plays), so
+ * an alert during a reply is heard right away instead of after the buffered TTS.
  */
 
-#define OPUS_FRAME_DURATION_MS 60
+// Default uplink frame duration, the actual one is a runtime setting (20 / 40 / 60 ms) confirmed by the server hello
+#define OPUS_FRAME_DURATION_MS CONFIG_OPUS_FRAME_DURATION_MS
+#define OPUS_MIN_FRAME_DURATION_MS 20
 #define MAX_ENCODE_TASKS_IN_QUEUE 2
 #define MAX_PLAYBACK_TASKS_IN_QUEUE 2
-#define MAX_DECODE_PACKETS_IN_QUEUE (2400 / OPUS_FRAME_DURATION_MS)
-#define MAX_SEND_PACKETS_IN_QUEUE (2400 / OPUS_FRAME_DURATION_MS)
+#define MAX_DECODE_PACKETS_IN_QUEUE (2400 / 60)
+// Send and testing queues are sized for the shortest frame, the limit in use follows the current duration
+#define AUDIO_SEND_MAX_DURATION_MS 2400
+#define MAX_SEND_PACKETS_IN_QUEUE (AUDIO_SEND_MAX_DURATION_MS / OPUS_MIN_FRAME_DURATION_MS)
 #define AUDIO_TESTING_MAX_DURATION_MS 10000
+#define MAX_TESTING_PACKETS_IN_QUEUE (AUDIO_TESTING_MAX_DURATION_MS / OPUS_MIN_FRAME_DURATION_MS)
 #define MAX_TIMESTAMPS_IN_QUEUE 3
+// Decoder / resampler pairs kept for streams with different rates or frame durations
+#define OPUS_DECODER_CACHE_SIZE 3
+#define JITTER_BUFFER_POLL_MS 10
+
+// The encode and decode tasks share the 26 KB the single codec task used to have. libopus takes most
+// of both: the decoder needs a 60 ms SILK frame buffer (2.9 KB at 24 kHz) beside its CELT buffers, so
+// it keeps 8 KB. The stages around libopus take about 2 KB of either task, a log line included
+// (test/host/task_stack_test), the device reports what is left of each in "stack_free"
+#define OPUS_CODEC_STACK_BUDGET (2048 * 13)
+#define OPUS_DECODE_TASK_STACK_SIZE (2048 * 4)
+#define OPUS_ENCODE_TASK_STACK_SIZE (OPUS_CODEC_STACK_BUDGET - OPUS_DECODE_TASK_STACK_SIZE)
+// A task with less unused stack than this is reported in the log
+#define AUDIO_TASK_STACK_MIN_FREE 1024
+#define OPUS_TASK_CORE_ID(core) ((core) < 0 ? tskNO_AFFINITY : (core))
+
+// A notification sound playing without speech is written to the codec in chunks of this length
+#define SOUND_PCM_FRAME_MS 20
+// Frame duration of the Ogg Opus sound assets
+#define SOUND_FRAME_DURATION_MS 60
+
+#if CONFIG_USE_POLYPHASE_INPUT_RESAMPLER
+#define POLYPHASE_INPUT_RESAMPLER true
+#else
+#define POLYPHASE_INPUT_RESAMPLER false
+#endif
+#if CONFIG_USE_POLYPHASE_OUTPUT_RESAMPLER
+#define POLYPHASE_OUTPUT_RESAMPLER true
+#else
+#define POLYPHASE_OUTPUT_RESAMPLER false
+#endif
+
+#if CONFIG_USE_DEVICE_ENDPOINTER
+#define ENDPOINTER_HANGOVER_MS CONFIG_ENDPOINTER_HANGOVER_MS
+#define ENDPOINTER_MIN_SPEECH_MS CONFIG_ENDPOINTER_MIN_SPEECH_MS
+#define ENDPOINTER_MAX_UTTERANCE_MS CONFIG_ENDPOINTER_MAX_UTTERANCE_MS
+#else
+#define ENDPOINTER_HANGOVER_MS 800
+#define ENDPOINTER_MIN_SPEECH_MS 200
+#define ENDPOINTER_MAX_UTTERANCE_MS 15000
+#endif
+
+// Encoded audio between two encoder complexity decisions
+#define ENCODER_CONTROL_WINDOW_MS 1000
+
+// Recycled objects kept by the pools, one in flight per task on top of the queue capacity. Packets
+// cover every queue that holds them while talking: jitter buffer, early packets, sounds in the decode
+// queue, send queue and DTX pre-roll. The audio testing queue (Wi-Fi configuration mode) uses the heap.
+#define AUDIO_PACKET_POOL_IN_FLIGHT 4
+#define AUDIO_PACKET_POOL_SIZE (MAX_DECODE_PACKETS_IN_QUEUE * 2 + MAX_EARLY_PACKETS + MAX_SEND_PACKETS_IN_QUEUE + \
+    MAX_DTX_PREROLL_PACKETS + AUDIO_PACKET_POOL_IN_FLIGHT)
+#define AUDIO_TASK_POOL_SIZE (MAX_ENCODE_TASKS_IN_QUEUE + 2)
+
+// Latency histogram buckets, upper bounds in ms, the last bucket is open-ended
+#define LATENCY_HISTOGRAM_BOUNDS_MS { 5, 10, 20, 40, 80, 160, 320, 640 }
+#define LATENCY_HISTOGRAM_BUCKETS 9
+
+// Uplink silence suppression: frames kept after speech ends, frames held back to cover the VAD onset delay,
+// and how often one frame is still sent during silence to keep the session alive
+#define UPLINK_DTX_HANGOVER_MS 600
+#define UPLINK_DTX_PREROLL_MS 120
+#define UPLINK_DTX_KEEPALIVE_MS 2000
+#define MAX_DTX_PREROLL_PACKETS (UPLINK_DTX_PREROLL_MS / OPUS_MIN_FRAME_DURATION_MS)
+
+// Downlink packets that arrive up to this long before the speaking state are still played
+#define EARLY_PACKET_MAX_AGE_MS CONFIG_EARLY_TTS_PACKET_WINDOW_MS
+#define MAX_EARLY_PACKETS (EARLY_PACKET_MAX_AGE_MS / OPUS_MIN_FRAME_DURATION_MS + 1)
+
+// Playback speeds up while this much more than the jitter buffer target is buffered, and slows down
+// for at most this many frames in a row while the jitter buffer is empty before the reply has ended
+#define TIME_STRETCH_ACCELERATE_MARGIN_MS 240
+#define TIME_STRETCH_MAX_EXPAND_FRAMES 2
 
 #define AUDIO_POWER_TIMEOUT_MS 15000
 #define AUDIO_POWER_CHECK_INTERVAL_MS 1000
@@ -52,10 +152,21 @@
 #define AS_EVENT_AUDIO_PROCESSOR_RUNNING    (1 << 2)
 #define AS_EVENT_PLAYBACK_NOT_EMPTY         (1 << 3)
 
+// Queue wakeup bits, one per queue and direction
+#define AS_QUEUE_ENCODE_PUSHED              (1 << 0)
+#define AS_QUEUE_ENCODE_POPPED              (1 << 1)
+#define AS_QUEUE_DECODE_PUSHED              (1 << 2)
+#define AS_QUEUE_DECODE_POPPED              (1 << 3)
+#define AS_QUEUE_PLAYBACK_PUSHED            (1 << 4)
+#define AS_QUEUE_PLAYBACK_POPPED            (1 << 5)
+#define AS_QUEUE_SEND_POPPED                (1 << 6)
+#define AS_QUEUE_ALL_BITS                   (0x7F)
+
 struct AudioServiceCallbacks {
     std::function<void(void)> on_send_queue_available;
     std::function<void(const std::string&)> on_wake_word_detected;
     std::function<void(bool)> on_vad_change;
+    std::function<void(void)> on_end_of_utterance;
     std::function<void(void)> on_audio_testing_queue_full;
 };
 
@@ -67,9 +178,19 @@ enum AudioTaskType {
 };
 
 struct AudioTask {
-    AudioTaskType type;
+    AudioTaskType type = kAudioTaskTypeEncodeToSendQueue;
     std::vector<int16_t> pcm;
-    uint32_t timestamp;
+    uint32_t timestamp = 0;
+    int64_t time_us = 0;    // Capture time for encode tasks, decode time for playback tasks
+};
+
+struct LatencyHistogram {
+    uint32_t buckets[LATENCY_HISTOGRAM_BUCKETS] = {};
+    uint32_t count = 0;
+    uint32_t max_us = 0;
+    uint64_t total_us = 0;
+
+    void Record(int64_t latency_us);
 };
 
 struct DebugStatistics {
@@ -77,6 +198,40 @@ struct DebugStatistics {
     uint32_t decode_count = 0;
     uint32_t encode_count = 0;
     uint32_t playback_count = 0;
+    uint32_t send_failures = 0;
+    // CPU time spent by each codec worker
+    uint64_t encode_time_us = 0;
+    uint64_t decode_time_us = 0;
+    uint64_t mix_time_us = 0;
+    // Per-stage latency
+    LatencyHistogram capture_to_encode;
+    LatencyHistogram encode_to_send;
+    LatencyHistogram receive_to_decode;
+    LatencyHistogram decode_to_output;
+    // PlaySound call to the next frame written to the codec
+    LatencyHistogram sound_to_output;
+    // Wake word detection to the first pre-roll packet handed to the protocol
+    LatencyHistogram wake_word_to_upload;
+    // EnableVoiceProcessing(true) to the first processed frame
+    LatencyHistogram voice_processing_start;
+    // VAD end of speech to the next downlink (TTS) packet
+    LatencyHistogram end_of_speech_to_tts;
+    // Queue depth high-water marks
+    uint32_t encode_queue_max = 0;
+    uint32_t send_queue_max = 0;
+    uint32_t decode_queue_max = 0;
+    uint32_t jitter_buffer_max = 0;
+    uint32_t playback_queue_max = 0;
+    // I2S DMA overflows between back to back writes / reads, per DMA profile
+    uint32_t output_dma_underruns[kAudioCodecDmaProfileCount] = {};
+    uint32_t input_dma_overruns[kAudioCodecDmaProfileCount] = {};
+};
+
+struct UplinkDtxStats {
+    uint32_t sent_packets = 0;
+    uint32_t keepalive_packets = 0;
+    uint32_t suppressed_packets = 0;
+    uint32_t suppressed_bytes = 0;
 };
 
 class AudioService {
@@ -95,17 +250,52 @@ public:
     bool IsWakeWordRunning() const { return xEventGroupGetBits(event_group_) & AS_EVENT_WAKE_WORD_RUNNING; }
     bool IsAudioProcessorRunning() const { return xEventGroupGetBits(event_group_) & AS_EVENT_AUDIO_PROCESSOR_RUNNING; }
     bool IsAfeWakeWord();
+    int frame_duration_ms() const { return frame_duration_ms_; }
+    int configured_frame_duration_ms() const { return configured_frame_duration_ms_; }
+    void SetFrameDuration(int frame_duration_ms);
 
     void EnableWakeWordDetection(bool enable);
     void EnableVoiceProcessing(bool enable);
     void EnableAudioTesting(bool enable);
     void EnableDeviceAec(bool enable);
+    // Stop sending uplink frames while the VAD reports silence, only if the server accepted "dtx" in the hello
+    void EnableUplinkDtx(bool enable);
+    // Stop encoding and report on_end_of_utterance once the endpointer decides the user has finished
+    void EnableEndpointer(bool enable);
+    // Smaller I2S DMA buffers for realtime conversations, with CONFIG_USE_LOW_LATENCY_I2S
+    void EnableLowLatency(bool enable);
+    const UplinkDtxStats& GetUplinkDtxStats() const { return uplink_dtx_stats_; }
+    void ResetUplinkDtxStats() { uplink_dtx_stats_ = UplinkDtxStats(); }
 
     void SetCallbacks(AudioServiceCallbacks& callbacks);
 
     bool PushPacketToDecodeQueue(std::unique_ptr<AudioStreamPacket> packet, bool wait = false);
+    bool PushPacketToJitterBuffer(std::unique_ptr<AudioStreamPacket> packet);
+    JitterBufferStats GetJitterBufferStats() { return jitter_buffer_.GetStats(); }
+    const TimeStretchStats& GetTimeStretchStats() const { return time_stretcher_.stats(); }
+    // Downlink packets of a reply, held until StartReply() and then passed to the jitter buffer.
+    // reply_id changes with every "tts start", packets of an earlier reply are dropped.
+    void PushIncomingPacket(std::unique_ptr<AudioStreamPacket> packet, uint32_t reply_id);
+    // Resets the decoder, then plays the held packets of the reply and every later one
+    void StartReply(uint32_t reply_id);
+    // The server has sent the whole reply, what is buffered plays out without being stretched
+    void FinishReply(uint32_t reply_id);
+    // Hold the packets again, e.g. once the device stops speaking
+    void EndReply();
+    void ClearEarlyPackets();
+    const DebugStatistics& GetDebugStatistics() const { return debug_statistics_; }
+    cJSON* GetStatisticsJson();
+    void ResetStatistics();
     std::unique_ptr<AudioStreamPacket> PopPacketFromSendQueue();
+    // Called by the sender when the transport rejects a packet, feeds the encoder controller
+    void ReportSendFailure();
+    std::unique_ptr<AudioStreamPacket> AcquirePacket() { return packet_pool_.Acquire(); }
+    void RecyclePacket(std::unique_ptr<AudioStreamPacket>&& packet) { packet_pool_.Release(std::move(packet)); }
+    uint32_t GetPoolExhaustedCount() const;
+    // The decode queue has a single producer, call from the main task only (see Application::PlaySound)
     void PlaySound(const std::string_view& sound);
+    // Decode a short sound into the PCM cache, PlaySound then mixes it straight into the output
+    bool PreloadSound(const std::string_view& sound);
     bool ReadAudioData(std::vector<int16_t>& data, int sample_rate, int samples);
     void ResetDecoder();
     void SetModelsList(srmodel_list_t* models_list);
@@ -114,37 +304,108 @@ private:
     AudioCodec* codec_ = nullptr;
     AudioServiceCallbacks callbacks_;
     std::unique_ptr<AudioProcessor> audio_processor_;
+    // Only with CONFIG_USE_SHARED_AFE, owned together with the wake word and audio processor front ends
+    std::shared_ptr<SharedAfe> shared_afe_;
     std::unique_ptr<WakeWord> wake_word_;
     std::unique_ptr<AudioDebugger> audio_debugger_;
     std::unique_ptr<OpusEncoderWrapper> opus_encoder_;
-    std::unique_ptr<OpusDecoderWrapper> opus_decoder_;
-    OpusResampler input_resampler_;
-    OpusResampler reference_resampler_;
-    OpusResampler output_resampler_;
+    DecoderCache decoder_cache_{OPUS_DECODER_CACHE_SIZE, POLYPHASE_OUTPUT_RESAMPLER};
+    // The stream being decoded, only touched by the decode task
+    DecoderSlot* decoder_ = nullptr;
+    // Format of the server stream, lost frames are concealed by its decoder and not by the last one used
+    int stream_sample_rate_ = 0;
+    int stream_frame_duration_ = 0;
+    std::atomic<bool> decoder_reset_{false};
+    AudioResampler input_resampler_{POLYPHASE_INPUT_RESAMPLER};
+    AudioResampler reference_resampler_{POLYPHASE_INPUT_RESAMPLER};
     DebugStatistics debug_statistics_;
+    EncoderController encoder_controller_{CONFIG_OPUS_ENCODE_COMPLEXITY_MIN, CONFIG_OPUS_ENCODE_COMPLEXITY_MAX};
+    EncoderControllerInput encoder_window_;
+    std::atomic<uint32_t> pending_send_failures_{0};
+    SoundCache sound_cache_;
+    std::atomic<int64_t> sound_request_us_{0};
+    std::atomic<int64_t> wake_word_detected_us_{0};
+    std::atomic<int64_t> voice_processing_enabled_us_{0};
+    // Decoded sound mixed over the speech by the output task
+    std::mutex notification_mutex_;
+    // Sound the decode task should decode into notification_sound_, guarded by notification_mutex_
+    std::string_view requested_sound_;
+    std::atomic<bool> sound_requested_{false};
+    std::shared_ptr<PcmSound> notification_sound_;
+    size_t notification_offset_ = 0;
+    // Set and cleared together with notification_sound_, so the output task only locks while a sound plays
+    std::atomic<bool> notification_playing_{false};
+    std::vector<int16_t> notification_buffer_;
+    AudioMixer mixer_;
+    // The mixed frame in the codec's native I2S format, for codecs that have one
+    std::vector<int32_t> native_output_buffer_;
     srmodel_list_t* models_list_ = nullptr;
 
     EventGroupHandle_t event_group_;
+    EventGroupHandle_t queue_event_group_;
 
     // Audio encode / decode
     TaskHandle_t audio_input_task_handle_ = nullptr;
     TaskHandle_t audio_output_task_handle_ = nullptr;
-    TaskHandle_t opus_codec_task_handle_ = nullptr;
-    std::mutex audio_queue_mutex_;
-    std::condition_variable audio_queue_cv_;
-    std::deque<std::unique_ptr<AudioStreamPacket>> audio_decode_queue_;
-    std::deque<std::unique_ptr<AudioStreamPacket>> audio_send_queue_;
-    std::deque<std::unique_ptr<AudioStreamPacket>> audio_testing_queue_;
-    std::deque<std::unique_ptr<AudioTask>> audio_encode_queue_;
-    std::deque<std::unique_ptr<AudioTask>> audio_playback_queue_;
+    TaskHandle_t opus_encode_task_handle_ = nullptr;
+    TaskHandle_t opus_decode_task_handle_ = nullptr;
+    // The decode queue also receives the whole testing queue when audio testing stops
+    AudioQueue<std::unique_ptr<AudioStreamPacket>> audio_decode_queue_{std::max(MAX_DECODE_PACKETS_IN_QUEUE, MAX_TESTING_PACKETS_IN_QUEUE)};
+    AudioQueue<std::unique_ptr<AudioStreamPacket>> audio_send_queue_{MAX_SEND_PACKETS_IN_QUEUE};
+    AudioQueue<std::unique_ptr<AudioStreamPacket>> audio_testing_queue_{MAX_TESTING_PACKETS_IN_QUEUE};
+    AudioQueue<std::unique_ptr<AudioTask>> audio_encode_queue_{MAX_ENCODE_TASKS_IN_QUEUE};
+    AudioQueue<std::unique_ptr<AudioTask>> audio_playback_queue_{MAX_PLAYBACK_TASKS_IN_QUEUE};
+    // Silent frames held back by the uplink DTX, sent ahead of the next talkspurt
+    AudioQueue<std::unique_ptr<AudioStreamPacket>> dtx_preroll_queue_{MAX_DTX_PREROLL_PACKETS};
     // For server AEC
-    std::deque<uint32_t> timestamp_queue_;
+    AudioQueue<uint32_t> timestamp_queue_{MAX_TIMESTAMPS_IN_QUEUE * 2};
+
+    // Recycled frames, PCM and Opus buffers keep their capacity between frames
+    AudioPool<AudioStreamPacket> packet_pool_{AUDIO_PACKET_POOL_SIZE};
+    AudioPool<AudioTask> encode_task_pool_{AUDIO_TASK_POOL_SIZE};
+    AudioPool<AudioTask> playback_task_pool_{AUDIO_TASK_POOL_SIZE};
+    std::vector<int16_t> input_buffer_;
+    std::vector<int16_t> output_resample_buffer_;
+    // Codec input copies, so the pooled payload / PCM buffers are only read by the Opus wrappers
+    std::vector<uint8_t> decode_payload_;
+    std::vector<int16_t> encode_pcm_;
+    DriftCompensator drift_compensator_;
+    std::vector<int16_t> drift_buffer_;
+    std::atomic<bool> drift_reset_{false};
+    TimeStretcher time_stretcher_;
+    std::vector<int16_t> stretch_buffer_;
+    int expanded_frames_in_row_ = 0;
+    // Input scratch: planar mic / reference before resampling, and the resampler output
+    std::vector<int16_t> deinterleave_buffer_;
+    std::vector<int16_t> resample_buffer_;
+    JitterBuffer jitter_buffer_{MAX_DECODE_PACKETS_IN_QUEUE, packet_pool_};
+    EarlyPacketBuffer early_packet_buffer_{MAX_EARLY_PACKETS, EARLY_PACKET_MAX_AGE_MS, packet_pool_};
 
+    int configured_frame_duration_ms_ = OPUS_FRAME_DURATION_MS;
+    int frame_duration_ms_ = OPUS_FRAME_DURATION_MS;
+    int encoder_frame_duration_ms_ = 0;
     bool wake_word_initialized_ = false;
     bool audio_processor_initialized_ = false;
-    bool voice_detected_ = false;
+    // Set by the input task (VAD) or the main task, read by the encode task
+    std::atomic<bool> voice_detected_{false};
+    std::atomic<bool> device_aec_enabled_{false};
+    std::atomic<bool> uplink_dtx_enabled_{false};
+    std::atomic<int64_t> dtx_last_voice_us_{0};
+    int64_t dtx_last_sent_us_ = 0;
+    UplinkDtxStats uplink_dtx_stats_;
+    // The endpointer runs on the audio processor output, it is reset there when re-enabled
+    Endpointer endpointer_{ENDPOINTER_HANGOVER_MS, ENDPOINTER_MIN_SPEECH_MS, ENDPOINTER_MAX_UTTERANCE_MS};
+    std::atomic<bool> endpointer_enabled_{false};
+    std::atomic<bool> endpointer_reset_{false};
+    std::atomic<int64_t> end_of_speech_us_{0};
     bool service_stopped_ = true;
     bool audio_input_need_warmup_ = false;
+    // The DMA also overflows while nothing is read / written, so the codec counters are only
+    // accounted from one read / write to the next while streaming
+    bool input_streaming_ = false;
+    bool output_streaming_ = false;
+    uint32_t input_dma_overrun_mark_ = 0;
+    uint32_t output_dma_underrun_mark_ = 0;
 
     esp_timer_handle_t audio_power_timer_ = nullptr;
     std::chrono::steady_clock::time_point last_input_time_;
@@ -152,10 +413,39 @@ private:
 
     void AudioInputTask();
     void AudioOutputTask();
-    void OpusCodecTask();
+    void OpusEncodeTask();
+    void OpusDecodeTask();
+    bool PushReceivedPacket(std::unique_ptr<AudioStreamPacket>&& packet);
+    // Returns false once the endpoint is reached and the frame should not be encoded
+    bool ProcessEndpointer(size_t samples);
+    void PushTaskToEncodeQueue(AudioTaskType type, const std::vector<int16_t>& pcm);
+    // Swaps pcm with the pooled task buffer instead of copying it
     void PushTaskToEncodeQueue(AudioTaskType type, std::vector<int16_t>&& pcm);
+    void PushTaskToEncodeQueue(AudioTaskType type, std::unique_ptr<AudioTask>&& task);
+    void PushPacketToSendQueue(std::unique_ptr<AudioStreamPacket>&& packet);
+    void SuppressSilentPacket(std::unique_ptr<AudioStreamPacket>&& packet);
+    std::shared_ptr<PcmSound> DecodeSound(const std::string_view& ogg, int output_sample_rate);
+    void DecodeRequestedSound();
+    bool HasNotification();
+    size_t ReadNotification(std::vector<int16_t>& pcm, size_t samples);
+    void ClearPacketQueue(AudioQueue<std::unique_ptr<AudioStreamPacket>>& queue);
+    // Consumer side of AudioQueue::RequestClear(), returns true if anything went back to the pool
+    bool RecycleClearedPackets(AudioQueue<std::unique_ptr<AudioStreamPacket>>& queue);
+    bool RecycleClearedTasks(AudioQueue<std::unique_ptr<AudioTask>>& queue, AudioPool<AudioTask>& pool);
+    // Frames of the server stream go through the drift compensator, local sounds do not
+    void DecodeToPlaybackQueue(std::unique_ptr<AudioStreamPacket>&& packet, bool stream = false);
+    void ConcealToPlaybackQueue();
+    // Mixes into pcm, or straight into the codec's native format, and writes the frame
+    void MixToCodec(const int16_t* const inputs[kAudioMixerSourceCount], size_t samples, std::vector<int16_t>& pcm);
+    int GetBufferedStreamMs(int frame_duration);
+    void CompensateDrift(std::vector<int16_t>& pcm, int frame_duration);
+    void StretchStreamFrame(std::vector<int16_t>& pcm, int frame_duration);
     void SetDecodeSampleRate(int sample_rate, int frame_duration);
+    void SetEncodeFrameDuration(int frame_duration);
+    void UpdateEncoderController(uint32_t encode_time_us, int frame_duration);
     void CheckAndUpdateAudioPowerState();
+    void WaitQueueEvent(EventBits_t bits, TickType_t timeout = portMAX_DELAY);
+    void NotifyQueueEvent(EventBits_t bits);
 };
 
 #endif
\ No newline at end of file
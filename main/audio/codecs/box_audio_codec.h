@@ -20,11 +20,19 @@ private:
     esp_codec_dev_handle_t output_dev_ = nullptr;
     esp_codec_dev_handle_t input_dev_ = nullptr;
     std::mutex data_if_mutex_;
+    // Kept to recreate the channels with other DMA sizes
+    gpio_num_t mclk_ = GPIO_NUM_NC;
+    gpio_num_t bclk_ = GPIO_NUM_NC;
+    gpio_num_t ws_ = GPIO_NUM_NC;
+    gpio_num_t dout_ = GPIO_NUM_NC;
+    gpio_num_t din_ = GPIO_NUM_NC;
 
     void CreateDuplexChannels(gpio_num_t mclk, gpio_num_t bclk, gpio_num_t ws, gpio_num_t dout, gpio_num_t din);
+    void CreateDevices();
 
     virtual int Read(int16_t* dest, int samples) override;
     virtual int Write(const int16_t* data, int samples) override;
+    virtual bool ReconfigureDma() override;
 
 public:
     BoxAudioCodec(void* i2c_master_handle, int input_sample_rate, int output_sample_rate,
@@ -17,16 +17,15 @@ Es8311AudioCodec::Es8311AudioCodec(void* i2c_master_handle, i2c_port_t i2c_port,
     input_gain_ = 30;
 
     assert(input_sample_rate_ == output_sample_rate_);
+    mclk_ = mclk;
+    bclk_ = bclk;
+    ws_ = ws;
+    dout_ = dout;
+    din_ = din;
     CreateDuplexChannels(mclk, bclk, ws, dout, din);
 
     // Do initialize of related interface: data_if, ctrl_if and gpio_if
-    audio_codec_i2s_cfg_t i2s_cfg = {
-        .port = I2S_NUM_0,
-        .rx_handle = rx_handle_,
-        .tx_handle = tx_handle_,
-    };
-    data_if_ = audio_codec_new_i2s_data(&i2s_cfg);
-    assert(data_if_ != NULL);
+    CreateDataInterface();
 
     // Output
     audio_codec_i2c_cfg_t i2c_cfg = {
@@ -89,6 +88,7 @@ void Es8311AudioCodec::UpdateDeviceState() {
         ESP_ERROR_CHECK(esp_codec_dev_set_out_vol(dev_, output_volume_));
     } else if (!input_enabled_ && !output_enabled_ && dev_ != nullptr) {
         esp_codec_dev_close(dev_);
+        esp_codec_dev_delete(dev_);
         dev_ = nullptr;
     }
     if (pa_pin_ != GPIO_NUM_NC) {
@@ -103,8 +103,8 @@ void Es8311AudioCodec::CreateDuplexChannels(gpio_num_t mclk, gpio_num_t bclk, gp
     i2s_chan_config_t chan_cfg = {
         .id = I2S_NUM_0,
         .role = I2S_ROLE_MASTER,
-        .dma_desc_num = AUDIO_CODEC_DMA_DESC_NUM,
-        .dma_frame_num = AUDIO_CODEC_DMA_FRAME_NUM,
+        .dma_desc_num = (uint32_t)dma_desc_num_,
+        .dma_frame_num = (uint32_t)dma_frame_num_,
         .auto_clear_after_cb = true,
         .auto_clear_before_cb = false,
         .intr_priority = 0,
@@ -153,8 +153,44 @@ void Es8311AudioCodec::CreateDuplexChannels(gpio_num_t mclk, gpio_num_t bclk, gp
     ESP_LOGI(TAG, "Duplex channels created");
 }
 
+void Es8311AudioCodec::CreateDataInterface() {
+    audio_codec_i2s_cfg_t i2s_cfg = {
+        .port = I2S_NUM_0,
+        .rx_handle = rx_handle_,
+        .tx_handle = tx_handle_,
+    };
+    data_if_ = audio_codec_new_i2s_data(&i2s_cfg);
+    assert(data_if_ != NULL);
+}
+
+bool Es8311AudioCodec::ReconfigureDma() {
+    // Closing both directions releases dev_, which holds the data interface of the old channels
+    bool input_enabled = input_enabled_;
+    bool output_enabled = output_enabled_;
+    EnableInput(false);
+    EnableOutput(false);
+    {
+        std::lock_guard<std::mutex> lock(data_if_mutex_);
+        audio_codec_delete_data_if(data_if_);
+        DeleteChannels();
+        CreateDuplexChannels(mclk_, bclk_, ws_, dout_, din_);
+        StartChannels();
+        CreateDataInterface();
+    }
+    EnableInput(input_enabled);
+    EnableOutput(output_enabled);
+    return true;
+}
+
 void Es8311AudioCodec::SetOutputVolume(int volume) {
-    ESP_ERROR_CHECK(esp_codec_dev_set_out_vol(dev_, volume));
+    {
+        // dev_ is replaced under this lock, and only exists while a direction is enabled; opening
+        // it applies output_volume_
+        std::lock_guard<std::mutex> lock(data_if_mutex_);
+        if (dev_ != nullptr) {
+            ESP_ERROR_CHECK(esp_codec_dev_set_out_vol(dev_, volume));
+        }
+    }
     AudioCodec::SetOutputVolume(volume);
 }
 
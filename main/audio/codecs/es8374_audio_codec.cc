@@ -15,18 +15,14 @@ Es8374AudioCodec::Es8374AudioCodec(void* i2c_master_handle, i2c_port_t i2c_port,
     input_gain_ = 30;
 
     pa_pin_ = pa_pin;
+    mclk_ = mclk;
+    bclk_ = bclk;
+    ws_ = ws;
+    dout_ = dout;
+    din_ = din;
     CreateDuplexChannels(mclk, bclk, ws, dout, din);
 
-    // Do initialize of related interface: data_if, ctrl_if and gpio_if
-    audio_codec_i2s_cfg_t i2s_cfg = {
-        .port = I2S_NUM_0,
-        .rx_handle = rx_handle_,
-        .tx_handle = tx_handle_,
-    };
-    data_if_ = audio_codec_new_i2s_data(&i2s_cfg);
-    assert(data_if_ != NULL);
-
-    // Output
+    // Do initialize of related interface: ctrl_if and gpio_if
     audio_codec_i2c_cfg_t i2c_cfg = {
         .port = i2c_port,
         .addr = es8374_addr,
@@ -46,18 +42,7 @@ Es8374AudioCodec::Es8374AudioCodec(void* i2c_master_handle, i2c_port_t i2c_port,
     codec_if_ = es8374_codec_new(&es8374_cfg);
     assert(codec_if_ != NULL);
 
-    esp_codec_dev_cfg_t dev_cfg = {
-        .dev_type = ESP_CODEC_DEV_TYPE_OUT,
-        .codec_if = codec_if_,
-        .data_if = data_if_,
-    };
-    output_dev_ = esp_codec_dev_new(&dev_cfg);
-    assert(output_dev_ != NULL);
-    dev_cfg.dev_type = ESP_CODEC_DEV_TYPE_IN;
-    input_dev_ = esp_codec_dev_new(&dev_cfg);
-    assert(input_dev_ != NULL);
-    esp_codec_set_disable_when_closed(output_dev_, false);
-    esp_codec_set_disable_when_closed(input_dev_, false);
+    CreateDevices();
     ESP_LOGI(TAG, "Es8374AudioCodec initialized");
 }
 
@@ -79,8 +64,8 @@ void Es8374AudioCodec::CreateDuplexChannels(gpio_num_t mclk, gpio_num_t bclk, gp
     i2s_chan_config_t chan_cfg = {
         .id = I2S_NUM_0,
         .role = I2S_ROLE_MASTER,
-        .dma_desc_num = 6,
-        .dma_frame_num = 240,
+        .dma_desc_num = (uint32_t)dma_desc_num_,
+        .dma_frame_num = (uint32_t)dma_frame_num_,
         .auto_clear_after_cb = true,
         .auto_clear_before_cb = false,
         .intr_priority = 0,
@@ -129,8 +114,56 @@ void Es8374AudioCodec::CreateDuplexChannels(gpio_num_t mclk, gpio_num_t bclk, gp
     ESP_LOGI(TAG, "Duplex channels created");
 }
 
+void Es8374AudioCodec::CreateDevices() {
+    audio_codec_i2s_cfg_t i2s_cfg = {
+        .port = I2S_NUM_0,
+        .rx_handle = rx_handle_,
+        .tx_handle = tx_handle_,
+    };
+    data_if_ = audio_codec_new_i2s_data(&i2s_cfg);
+    assert(data_if_ != NULL);
+
+    esp_codec_dev_cfg_t dev_cfg = {
+        .dev_type = ESP_CODEC_DEV_TYPE_OUT,
+        .codec_if = codec_if_,
+        .data_if = data_if_,
+    };
+    output_dev_ = esp_codec_dev_new(&dev_cfg);
+    assert(output_dev_ != NULL);
+    dev_cfg.dev_type = ESP_CODEC_DEV_TYPE_IN;
+    input_dev_ = esp_codec_dev_new(&dev_cfg);
+    assert(input_dev_ != NULL);
+    esp_codec_set_disable_when_closed(output_dev_, false);
+    esp_codec_set_disable_when_closed(input_dev_, false);
+}
+
+bool Es8374AudioCodec::ReconfigureDma() {
+    // The devices hold the data interface of the old channels, so they are created again
+    bool input_enabled = input_enabled_;
+    bool output_enabled = output_enabled_;
+    EnableInput(false);
+    EnableOutput(false);
+    {
+        std::lock_guard<std::mutex> lock(data_if_mutex_);
+        esp_codec_dev_delete(output_dev_);
+        esp_codec_dev_delete(input_dev_);
+        audio_codec_delete_data_if(data_if_);
+        DeleteChannels();
+        CreateDuplexChannels(mclk_, bclk_, ws_, dout_, din_);
+        StartChannels();
+        CreateDevices();
+    }
+    EnableInput(input_enabled);
+    EnableOutput(output_enabled);
+    return true;
+}
+
 void Es8374AudioCodec::SetOutputVolume(int volume) {
-    ESP_ERROR_CHECK(esp_codec_dev_set_out_vol(output_dev_, volume));
+    {
+        // ReconfigureDma() replaces the device under this lock
+        std::lock_guard<std::mutex> lock(data_if_mutex_);
+        ESP_ERROR_CHECK(esp_codec_dev_set_out_vol(output_dev_, volume));
+    }
     AudioCodec::SetOutputVolume(volume);
 }
 
@@ -1,7 +1,7 @@
 #include "no_audio_codec.h"
+#include "audio_gain.h"
 
 #include <esp_log.h>
-#include <cmath>
 #include <cstring>
 
 #define TAG "NoAudioCodec"
@@ -15,6 +15,38 @@ NoAudioCodec::~NoAudioCodec() {
     }
 }
 
+void NoAudioCodec::CreateChannels() {
+    tx_chan_cfg_.dma_desc_num = dma_desc_num_;
+    tx_chan_cfg_.dma_frame_num = dma_frame_num_;
+    rx_chan_cfg_.dma_desc_num = dma_desc_num_;
+    rx_chan_cfg_.dma_frame_num = dma_frame_num_;
+    if (duplex_) {
+        ESP_ERROR_CHECK(i2s_new_channel(&tx_chan_cfg_, &tx_handle_, &rx_handle_));
+        ESP_ERROR_CHECK(i2s_channel_init_std_mode(tx_handle_, &tx_std_cfg_));
+        ESP_ERROR_CHECK(i2s_channel_init_std_mode(rx_handle_, &rx_std_cfg_));
+        return;
+    }
+    ESP_ERROR_CHECK(i2s_new_channel(&tx_chan_cfg_, &tx_handle_, nullptr));
+    ESP_ERROR_CHECK(i2s_channel_init_std_mode(tx_handle_, &tx_std_cfg_));
+    CreateRxChannel();
+}
+
+void NoAudioCodec::CreateRxChannel() {
+    ESP_ERROR_CHECK(i2s_new_channel(&rx_chan_cfg_, nullptr, &rx_handle_));
+    ESP_ERROR_CHECK(i2s_channel_init_std_mode(rx_handle_, &rx_std_cfg_));
+}
+
+bool NoAudioCodec::ReconfigureDma() {
+    // A subclass that creates its channels itself leaves the saved configs empty
+    if (tx_std_cfg_.clk_cfg.sample_rate_hz == 0 || (duplex_ && rx_std_cfg_.clk_cfg.sample_rate_hz == 0)) {
+        return false;
+    }
+    DeleteChannels();
+    CreateChannels();
+    StartChannels();
+    return true;
+}
+
 NoAudioCodecDuplex::NoAudioCodecDuplex(int input_sample_rate, int output_sample_rate, gpio_num_t bclk, gpio_num_t ws, gpio_num_t dout, gpio_num_t din) {
     duplex_ = true;
     input_sample_rate_ = input_sample_rate;
@@ -29,7 +61,8 @@ NoAudioCodecDuplex::NoAudioCodecDuplex(int input_sample_rate, int output_sample_
         .auto_clear_before_cb = false,
         .intr_priority = 0,
     };
-    ESP_ERROR_CHECK(i2s_new_channel(&chan_cfg, &tx_handle_, &rx_handle_));
+    tx_chan_cfg_ = chan_cfg;
+    rx_chan_cfg_ = chan_cfg;
 
     i2s_std_config_t std_cfg = {
         .clk_cfg = {
@@ -69,8 +102,9 @@ NoAudioCodecDuplex::NoAudioCodecDuplex(int input_sample_rate, int output_sample_
             }
         }
     };
-    ESP_ERROR_CHECK(i2s_channel_init_std_mode(tx_handle_, &std_cfg));
-    ESP_ERROR_CHECK(i2s_channel_init_std_mode(rx_handle_, &std_cfg));
+    tx_std_cfg_ = std_cfg;
+    rx_std_cfg_ = std_cfg;
+    CreateChannels();
     ESP_LOGI(TAG, "Duplex channels created");
 }
 
@@ -90,7 +124,7 @@ NoAudioCodecSimplex::NoAudioCodecSimplex(int input_sample_rate, int output_sampl
         .auto_clear_before_cb = false,
         .intr_priority = 0,
     };
-    ESP_ERROR_CHECK(i2s_new_channel(&chan_cfg, &tx_handle_, nullptr));
+    tx_chan_cfg_ = chan_cfg;
 
     i2s_std_config_t std_cfg = {
         .clk_cfg = {
@@ -130,17 +164,18 @@ NoAudioCodecSimplex::NoAudioCodecSimplex(int input_sample_rate, int output_sampl
             }
         }
     };
-    ESP_ERROR_CHECK(i2s_channel_init_std_mode(tx_handle_, &std_cfg));
+    tx_std_cfg_ = std_cfg;
 
     // Create a new channel for MIC
     chan_cfg.id = (i2s_port_t)1;
-    ESP_ERROR_CHECK(i2s_new_channel(&chan_cfg, nullptr, &rx_handle_));
+    rx_chan_cfg_ = chan_cfg;
     std_cfg.clk_cfg.sample_rate_hz = (uint32_t)input_sample_rate_;
     std_cfg.gpio_cfg.bclk = mic_sck;
     std_cfg.gpio_cfg.ws = mic_ws;
     std_cfg.gpio_cfg.dout = I2S_GPIO_UNUSED;
     std_cfg.gpio_cfg.din = mic_din;
-    ESP_ERROR_CHECK(i2s_channel_init_std_mode(rx_handle_, &std_cfg));
+    rx_std_cfg_ = std_cfg;
+    CreateChannels();
     ESP_LOGI(TAG, "Simplex channels created");
 }
 
@@ -159,7 +194,7 @@ NoAudioCodecSimplex::NoAudioCodecSimplex(int input_sample_rate, int output_sampl
         .auto_clear_before_cb = false,
         .intr_priority = 0,
     };
-    ESP_ERROR_CHECK(i2s_new_channel(&chan_cfg, &tx_handle_, nullptr));
+    tx_chan_cfg_ = chan_cfg;
 
     i2s_std_config_t std_cfg = {
         .clk_cfg = {
@@ -199,58 +234,50 @@ NoAudioCodecSimplex::NoAudioCodecSimplex(int input_sample_rate, int output_sampl
             }
         }
     };
-    ESP_ERROR_CHECK(i2s_channel_init_std_mode(tx_handle_, &std_cfg));
+    tx_std_cfg_ = std_cfg;
 
     // Create a new channel for MIC
     chan_cfg.id = (i2s_port_t)1;
-    ESP_ERROR_CHECK(i2s_new_channel(&chan_cfg, nullptr, &rx_handle_));
+    rx_chan_cfg_ = chan_cfg;
     std_cfg.clk_cfg.sample_rate_hz = (uint32_t)input_sample_rate_;
     std_cfg.slot_cfg.slot_mask = mic_slot_mask;
     std_cfg.gpio_cfg.bclk = mic_sck;
     std_cfg.gpio_cfg.ws = mic_ws;
     std_cfg.gpio_cfg.dout = I2S_GPIO_UNUSED;
     std_cfg.gpio_cfg.din = mic_din;
-    ESP_ERROR_CHECK(i2s_channel_init_std_mode(rx_handle_, &std_cfg));
+    rx_std_cfg_ = std_cfg;
+    CreateChannels();
     ESP_LOGI(TAG, "Simplex channels created");
 }
 
 int NoAudioCodec::Write(const int16_t* data, int samples) {
     std::lock_guard<std::mutex> lock(data_if_mutex_);
-    std::vector<int32_t> buffer(samples);
-
-    // output_volume_: 0-100
-    // volume_factor_: 0-65536
-    int32_t volume_factor = pow(double(output_volume_) / 100.0, 2) * 65536;
-    for (int i = 0; i < samples; i++) {
-        int64_t temp = int64_t(data[i]) * volume_factor; // 使用 int64_t 进行乘法运算
-        if (temp > INT32_MAX) {
-            buffer[i] = INT32_MAX;
-        } else if (temp < INT32_MIN) {
-            buffer[i] = INT32_MIN;
-        } else {
-            buffer[i] = static_cast<int32_t>(temp);
-        }
-    }
+    write_buffer_.resize(samples);
+    ScaleToInt32(data, write_buffer_.data(), samples, output_volume_factor());
 
     size_t bytes_written;
-    ESP_ERROR_CHECK(i2s_channel_write(tx_handle_, buffer.data(), samples * sizeof(int32_t), &bytes_written, portMAX_DELAY));
+    ESP_ERROR_CHECK(i2s_channel_write(tx_handle_, write_buffer_.data(), samples * sizeof(int32_t), &bytes_written, portMAX_DELAY));
+    return bytes_written / sizeof(int32_t);
+}
+
+int NoAudioCodec::WriteNative(const int32_t* data, int words) {
+    std::lock_guard<std::mutex> lock(data_if_mutex_);
+    size_t bytes_written;
+    ESP_ERROR_CHECK(i2s_channel_write(tx_handle_, data, words * sizeof(int32_t), &bytes_written, portMAX_DELAY));
     return bytes_written / sizeof(int32_t);
 }
 
 int NoAudioCodec::Read(int16_t* dest, int samples) {
     size_t bytes_read;
 
-    std::vector<int32_t> bit32_buffer(samples);
-    if (i2s_channel_read(rx_handle_, bit32_buffer.data(), samples * sizeof(int32_t), &bytes_read, portMAX_DELAY) != ESP_OK) {
+    read_buffer_.resize(samples);
+    if (i2s_channel_read(rx_handle_, read_buffer_.data(), samples * sizeof(int32_t), &bytes_read, portMAX_DELAY) != ESP_OK) {
         ESP_LOGE(TAG, "Read Failed!");
         return 0;
     }
 
     samples = bytes_read / sizeof(int32_t);
-    for (int i = 0; i < samples; i++) {
-        int32_t value = bit32_buffer[i] >> 12;
-        dest[i] = (value > INT16_MAX) ? INT16_MAX : (value < -INT16_MAX) ? -INT16_MAX : (int16_t)value;
-    }
+    ShiftToInt16(read_buffer_.data(), dest, samples, 12);
     return samples;
 }
 
@@ -272,7 +299,7 @@ NoAudioCodecSimplexPdm::NoAudioCodecSimplexPdm(int input_sample_rate, int output
     tx_chan_cfg.auto_clear_after_cb = true;
     tx_chan_cfg.auto_clear_before_cb = false;
     tx_chan_cfg.intr_priority = 0;
-    ESP_ERROR_CHECK(i2s_new_channel(&tx_chan_cfg, &tx_handle_, NULL));
+    tx_chan_cfg_ = tx_chan_cfg;
 
 
     i2s_std_config_t tx_std_cfg = {
@@ -313,11 +340,11 @@ NoAudioCodecSimplexPdm::NoAudioCodecSimplexPdm(int input_sample_rate, int output
             },
         },
     };
-    ESP_ERROR_CHECK(i2s_channel_init_std_mode(tx_handle_, &tx_std_cfg));
+    tx_std_cfg_ = tx_std_cfg;
 #if SOC_I2S_SUPPORTS_PDM_RX
     // Create a new channel for MIC in PDM mode
     i2s_chan_config_t rx_chan_cfg = I2S_CHANNEL_DEFAULT_CONFIG((i2s_port_t)0, I2S_ROLE_MASTER);
-    ESP_ERROR_CHECK(i2s_new_channel(&rx_chan_cfg, NULL, &rx_handle_));
+    rx_chan_cfg_ = rx_chan_cfg;
     i2s_pdm_rx_config_t pdm_rx_cfg = {
         .clk_cfg = I2S_PDM_RX_CLK_DEFAULT_CONFIG((uint32_t)input_sample_rate_),
         /* The data bit-width of PDM mode is fixed to 16 */
@@ -331,13 +358,21 @@ NoAudioCodecSimplexPdm::NoAudioCodecSimplexPdm(int input_sample_rate, int output
             },
         },
     };
-    ESP_ERROR_CHECK(i2s_channel_init_pdm_rx_mode(rx_handle_, &pdm_rx_cfg));
+    pdm_rx_cfg_ = pdm_rx_cfg;
 #else
     ESP_LOGE(TAG, "PDM is not supported");
 #endif
+    CreateChannels();
     ESP_LOGI(TAG, "Simplex channels created");
 }
 
+void NoAudioCodecSimplexPdm::CreateRxChannel() {
+#if SOC_I2S_SUPPORTS_PDM_RX
+    ESP_ERROR_CHECK(i2s_new_channel(&rx_chan_cfg_, nullptr, &rx_handle_));
+    ESP_ERROR_CHECK(i2s_channel_init_pdm_rx_mode(rx_handle_, &pdm_rx_cfg_));
+#endif
+}
+
 int NoAudioCodecSimplexPdm::Read(int16_t* dest, int samples) {
     size_t bytes_read;
 
@@ -349,11 +384,7 @@ int NoAudioCodecSimplexPdm::Read(int16_t* dest, int samples) {
 
     samples = bytes_read / sizeof(int16_t);
     if (input_gain_ > 0) {
-        int gain_factor = (int)input_gain_;
-        for (int i = 0; i < samples; i++) {
-            int32_t amplified = dest[i] * gain_factor;
-            dest[i] = (amplified > INT16_MAX) ? INT16_MAX : (amplified < -INT16_MAX) ? -INT16_MAX : (int16_t)amplified;
-        }
+        AmplifyInt16(dest, samples, (int)input_gain_);
     }
     return samples;
 }
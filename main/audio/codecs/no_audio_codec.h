@@ -6,15 +6,29 @@
 #include <driver/gpio.h>
 #include <driver/i2s_pdm.h>
 #include <mutex>
+#include <vector>
 
 class NoAudioCodec : public AudioCodec {
 protected:
     std::mutex data_if_mutex_;
+    // 32-bit I2S scratch, grows to the frame size once and is reused
+    std::vector<int32_t> write_buffer_;
+    std::vector<int32_t> read_buffer_;
+    // Kept to recreate the channels with other DMA sizes
+    i2s_chan_config_t tx_chan_cfg_ = {};
+    i2s_chan_config_t rx_chan_cfg_ = {};
+    i2s_std_config_t tx_std_cfg_ = {};
+    i2s_std_config_t rx_std_cfg_ = {};
 
     virtual int Write(const int16_t* data, int samples) override;
+    virtual int WriteNative(const int32_t* data, int words) override;
     virtual int Read(int16_t* dest, int samples) override;
+    virtual bool ReconfigureDma() override;
+    void CreateChannels();
+    virtual void CreateRxChannel();
 
 public:
+    NoAudioCodec() { output_native_slots_ = 1; }
     virtual ~NoAudioCodec();
 };
 
@@ -30,6 +44,13 @@ public:
 };
 
 class NoAudioCodecSimplexPdm : public NoAudioCodec {
+private:
+#if SOC_I2S_SUPPORTS_PDM_RX
+    i2s_pdm_rx_config_t pdm_rx_cfg_ = {};
+#endif
+
+    virtual void CreateRxChannel() override;
+
 public:
     NoAudioCodecSimplexPdm(int input_sample_rate, int output_sample_rate, gpio_num_t spk_bclk, gpio_num_t spk_ws, gpio_num_t spk_dout, gpio_num_t mic_sck,  gpio_num_t mic_din);
     NoAudioCodecSimplexPdm(int input_sample_rate, int output_sample_rate, gpio_num_t spk_bclk, gpio_num_t spk_ws, gpio_num_t spk_dout, i2s_std_slot_mask_t spk_slot_mask, gpio_num_t mic_sck,  gpio_num_t mic_din);
@@ -0,0 +1,73 @@
+#include "decoder_cache.h"
+
+#include <esp_log.h>
+
+#define TAG "DecoderCache"
+
+DecoderCache::DecoderCache(size_t capacity, bool allow_polyphase)
+    : capacity_(capacity), allow_polyphase_(allow_polyphase) {
+    slots_.reserve(capacity);
+}
+
+void DecoderCache::SetOutputSampleRate(int output_sample_rate) {
+    if (output_sample_rate == output_sample_rate_) {
+        return;
+    }
+    output_sample_rate_ = output_sample_rate;
+    current_ = nullptr;
+    slots_.clear();
+}
+
+DecoderSlot& DecoderCache::Get(int sample_rate, int frame_duration) {
+    use_counter_++;
+    if (current_ != nullptr && current_->sample_rate == sample_rate && current_->frame_duration == frame_duration) {
+        current_->last_used = use_counter_;
+        return *current_;
+    }
+
+    DecoderSlot* slot = nullptr;
+    for (auto& s : slots_) {
+        if (s.sample_rate == sample_rate && s.frame_duration == frame_duration) {
+            slot = &s;
+            break;
+        }
+    }
+    if (slot != nullptr) {
+        hits_++;
+    } else {
+        misses_++;
+        if (slots_.size() < capacity_) {
+            slot = &slots_.emplace_back();
+        } else {
+            slot = &slots_[0];
+            for (auto& s : slots_) {
+                if (s.last_used < slot->last_used) {
+                    slot = &s;
+                }
+            }
+            ESP_LOGI(TAG, "Replacing decoder %d Hz / %d ms", slot->sample_rate, slot->frame_duration);
+        }
+        slot->sample_rate = sample_rate;
+        slot->frame_duration = frame_duration;
+        slot->decoder.reset();
+        slot->decoder = std::make_unique<OpusDecoderWrapper>(sample_rate, 1, frame_duration);
+        slot->resampler.reset();
+        if (sample_rate != output_sample_rate_) {
+            ESP_LOGI(TAG, "Resampling audio from %d to %d", sample_rate, output_sample_rate_);
+            slot->resampler = std::make_unique<AudioResampler>(allow_polyphase_);
+            slot->resampler->Configure(sample_rate, output_sample_rate_);
+        }
+    }
+    slot->last_used = use_counter_;
+    current_ = slot;
+    return *slot;
+}
+
+void DecoderCache::ResetState() {
+    for (auto& s : slots_) {
+        s.decoder->ResetState();
+        if (s.resampler) {
+            s.resampler->Reset();
+        }
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef DECODER_CACHE_H
+#define DECODER_CACHE_H
+
+#include <opus_decoder.h>
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+#include "audio_resampler.h"
+
+struct DecoderSlot {
+    int sample_rate = 0;
+    int frame_duration = 0;
+    uint32_t last_used = 0;
+    std::unique_ptr<OpusDecoderWrapper> decoder;
+    // Only set when the stream rate differs from the codec output rate
+    std::unique_ptr<AudioResampler> resampler;
+};
+
+/*
+ * Decoder and output resampler pairs, one per (sample rate, frame duration) stream.
+ *
+ * Sounds (16 kHz) interleaved with the server stream (24 kHz) used to recreate the decoder
+ * and reconfigure the resampler on every switch. Each stream now keeps its own decoder
+ * state and resampler history, so a switch is a lookup in a few slots. When all slots are
+ * in use, the least recently used one is replaced.
+ */
+class DecoderCache {
+public:
+    DecoderCache(size_t capacity, bool allow_polyphase);
+    DecoderCache(const DecoderCache&) = delete;
+    DecoderCache& operator=(const DecoderCache&) = delete;
+
+    // Drops all slots when the codec output rate changes
+    void SetOutputSampleRate(int output_sample_rate);
+    DecoderSlot& Get(int sample_rate, int frame_duration);
+    // Resets the decoder state and the resampler history of every stream, so a new stream does
+    // not start with the tail of the previous one
+    void ResetState();
+
+    uint32_t hits() const { return hits_; }
+    uint32_t misses() const { return misses_; }
+
+private:
+    const size_t capacity_;
+    const bool allow_polyphase_;
+    int output_sample_rate_ = 0;
+    std::vector<DecoderSlot> slots_;
+    DecoderSlot* current_ = nullptr;
+    uint32_t use_counter_ = 0;
+    uint32_t hits_ = 0;
+    uint32_t misses_ = 0;
+};
+
+#endif // DECODER_CACHE_H
@@ -0,0 +1,92 @@
+#include "drift_compensator.h"
+
+#include <algorithm>
+
+void DriftCompensator::Update(int buffered_ms, int target_ms, int frame_ms) {
+    if (!has_reference_) {
+        if (buffered_ms > target_ms + DRIFT_BACKLOG_MARGIN_MS) {
+            // Playing out the initial burst, the level falls however the clocks run
+            settled_ms_ = 0;
+            settle_sum_ms_ = 0;
+            return;
+        }
+        settle_sum_ms_ += (float)buffered_ms * frame_ms;
+        settled_ms_ += frame_ms;
+        if (settled_ms_ >= DRIFT_SETTLE_MS) {
+            reference_ms_ = settle_sum_ms_ / settled_ms_;
+            level_ms_ = reference_ms_;
+            has_reference_ = true;
+        }
+        return;
+    }
+
+    // A drift moves the level by a frame every minute or so and the smoothed level follows it,
+    // a jump well above it is the next burst of the reply
+    backlog_ = buffered_ms > level_ms_ + DRIFT_BACKLOG_MARGIN_MS;
+    if (backlog_) {
+        correction_ppm_ = 0;
+        return;
+    }
+    level_ms_ += (buffered_ms - level_ms_) * frame_ms / DRIFT_LEVEL_TIME_CONSTANT_MS;
+
+    // Positive when the server runs ahead of the DAC and the buffer fills up
+    float error_ms = level_ms_ - reference_ms_;
+    integral_ppm_ = std::clamp(integral_ppm_ + DRIFT_KI * error_ms * frame_ms / 1000, (float)-DRIFT_MAX_PPM, (float)DRIFT_MAX_PPM);
+    correction_ppm_ = std::clamp(DRIFT_KP * error_ms + integral_ppm_, (float)-DRIFT_MAX_PPM, (float)DRIFT_MAX_PPM);
+}
+
+void DriftCompensator::Process(std::vector<int16_t>& pcm, std::vector<int16_t>& scratch) {
+    const int in_samples = pcm.size();
+    if (in_samples < 4) {
+        return;
+    }
+    // The buffers take turns, each keeps room for an inserted sample from the first frame on,
+    // so a correction that only starts once the stream has settled does not allocate
+    pcm.reserve(in_samples + 1);
+    scratch.reserve(in_samples + 1);
+    owed_samples_ += correction_ppm_ * in_samples / 1000000;
+    int out_samples;
+    if (owed_samples_ >= 1) {
+        out_samples = in_samples - 1;
+        owed_samples_ -= 1;
+        dropped_samples_++;
+    } else if (owed_samples_ <= -1) {
+        out_samples = in_samples + 1;
+        owed_samples_ += 1;
+        inserted_samples_++;
+    } else {
+        return;
+    }
+
+    // The first and the last sample stay in place, so the frame joins its neighbours without a step
+    scratch.resize(out_samples);
+    const int16_t* in = pcm.data();
+    const uint64_t step = ((uint64_t)(in_samples - 1) << 16) / (out_samples - 1);
+    uint64_t position = 0;
+    for (int i = 0; i < out_samples; i++, position += step) {
+        int index = std::min((int)(position >> 16), in_samples - 1);
+        int32_t t = (int32_t)(position & 0xFFFF) >> 1;  // Q15
+        int32_t y0 = in[std::max(index - 1, 0)];
+        int32_t y1 = in[index];
+        int32_t y2 = in[std::min(index + 1, in_samples - 1)];
+        int32_t y3 = in[std::min(index + 2, in_samples - 1)];
+        // Catmull-Rom spline between y1 and y2
+        int32_t a = (-y0 + 3 * y1 - 3 * y2 + y3) / 2;
+        int32_t b = (2 * y0 - 5 * y1 + 4 * y2 - y3) / 2;
+        int32_t c = (y2 - y0) / 2;
+        int64_t value = (((((int64_t)a * t >> 15) + b) * t >> 15) + c) * t >> 15;
+        value += y1;
+        scratch[i] = (int16_t)std::clamp<int64_t>(value, INT16_MIN, INT16_MAX);
+    }
+    pcm.swap(scratch);
+}
+
+void DriftCompensator::Reset() {
+    has_reference_ = false;
+    backlog_ = false;
+    settled_ms_ = 0;
+    settle_sum_ms_ = 0;
+    integral_ppm_ = 0;
+    correction_ppm_ = 0;
+    owed_samples_ = 0;
+}
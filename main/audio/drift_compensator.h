@@ -0,0 +1,64 @@
+#ifndef DRIFT_COMPENSATOR_H
+#define DRIFT_COMPENSATOR_H
+
+#include <vector>
+#include <cstdint>
+
+// Largest correction, 1000 ppm is a pitch change of under 2 cents
+#define DRIFT_MAX_PPM 1000
+// The buffer level is smoothed over this long, so a late packet barely moves it
+#define DRIFT_LEVEL_TIME_CONSTANT_MS 8000
+// The level must stay free of backlog this long before it is taken as the reference
+#define DRIFT_SETTLE_MS 3000
+// More than this above the jitter buffer target, or later above the smoothed level, is a burst
+// the server sent ahead rather than drift
+#define DRIFT_BACKLOG_MARGIN_MS 120
+// ppm per ms of level error, and ppm per ms of level error per second
+#define DRIFT_KP 1.0f
+#define DRIFT_KI 0.02f
+
+/*
+ * Keeps the downlink buffer level steady while the server and the I2S clock run at slightly
+ * different rates.
+ *
+ * Update() is fed with the buffered audio each time a stream frame is decoded. TTS audio
+ * arrives in bursts and the jitter buffer target moves with the network, so neither says
+ * anything about the clocks. The compensator therefore waits until the buffer has held no
+ * backlog for DRIFT_SETTLE_MS, takes the mean level over that time as its reference, and only
+ * then runs a PI controller on the smoothed level against it: the integral part converges to
+ * the clock drift, the proportional part brings the level back. A later burst pauses the
+ * controller until it has played out.
+ *
+ * Process() plays the frame that much faster or slower by adding or removing a whole sample
+ * whenever one is due, spread over the frame with cubic interpolation, so there are no clicks.
+ */
+class DriftCompensator {
+public:
+    void Update(int buffered_ms, int target_ms, int frame_ms);
+    // pcm is replaced with the corrected frame, scratch is a buffer that is reused between calls
+    void Process(std::vector<int16_t>& pcm, std::vector<int16_t>& scratch);
+    // Called at the start of each stream, the drift is estimated from scratch
+    void Reset();
+
+    bool steady() const { return has_reference_ && !backlog_; }
+    int correction_ppm() const { return (int)correction_ppm_; }
+    int drift_ppm() const { return (int)integral_ppm_; }
+    int level_ms() const { return (int)level_ms_; }
+    uint32_t inserted_samples() const { return inserted_samples_; }
+    uint32_t dropped_samples() const { return dropped_samples_; }
+
+private:
+    bool has_reference_ = false;
+    bool backlog_ = false;
+    int settled_ms_ = 0;
+    float settle_sum_ms_ = 0;
+    float reference_ms_ = 0;
+    float level_ms_ = 0;
+    float integral_ppm_ = 0;
+    float correction_ppm_ = 0;
+    float owed_samples_ = 0;
+    uint32_t inserted_samples_ = 0;
+    uint32_t dropped_samples_ = 0;
+};
+
+#endif // DRIFT_COMPENSATOR_H
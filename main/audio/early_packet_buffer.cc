@@ -0,0 +1,117 @@
+#include "early_packet_buffer.h"
+
+#include <esp_log.h>
+
+#define TAG "EarlyPacketBuffer"
+
+EarlyPacketBuffer::EarlyPacketBuffer(size_t capacity, int max_age_ms, AudioPool<AudioStreamPacket>& pool)
+    : pool_(pool), capacity_(capacity), max_age_us_((int64_t)max_age_ms * 1000), packets_(capacity) {
+}
+
+bool EarlyPacketBuffer::Hold(std::unique_ptr<AudioStreamPacket>&& packet, uint32_t reply_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (reply_id != reply_id_) {
+        // A new reply has started, nothing of the previous one is played from here on
+        DropAll();
+        reply_id_ = reply_id;
+        open_ = false;
+    }
+    if (open_) {
+        return false;
+    }
+    // Drop what can no longer be rescued, so the newest packets always fit
+    while (count_ > 0 && (count_ >= capacity_ || packet->time_us - Slot(0)->time_us > max_age_us_)) {
+        PopFront();
+        stats_.expired_packets++;
+    }
+    if (capacity_ == 0 || max_age_us_ == 0) {
+        pool_.Release(std::move(packet));
+        stats_.expired_packets++;
+        return true;
+    }
+    Slot(count_++) = std::move(packet);
+    stats_.held_packets++;
+    return true;
+}
+
+size_t EarlyPacketBuffer::Open(uint32_t reply_id, int64_t now_us, const PacketCallback& callback) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if ((int32_t)(reply_id - reply_id_) < 0) {
+        // Packets of a newer reply are already arriving, that one opens on its own
+        return 0;
+    }
+    if (reply_id != reply_id_) {
+        DropAll();
+        reply_id_ = reply_id;
+    }
+
+    size_t rescued = 0;
+    for (size_t i = 0; i < count_; i++) {
+        auto& packet = Slot(i);
+        if (now_us - packet->time_us > max_age_us_) {
+            pool_.Release(std::move(packet));
+            stats_.expired_packets++;
+            continue;
+        }
+        callback(std::move(packet));
+        rescued++;
+    }
+    head_ = 0;
+    count_ = 0;
+    open_ = true;
+    if (rescued > 0) {
+        stats_.rescued_packets += rescued;
+        ESP_LOGI(TAG, "Rescued %u packets that arrived before speaking", (unsigned)rescued);
+    }
+    return rescued;
+}
+
+bool EarlyPacketBuffer::IsOpen(uint32_t reply_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return open_ && reply_id == reply_id_;
+}
+
+void EarlyPacketBuffer::Finish(uint32_t reply_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    finished_reply_id_ = reply_id;
+}
+
+bool EarlyPacketBuffer::IsFinished(uint32_t reply_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return finished_reply_id_ == reply_id;
+}
+
+bool EarlyPacketBuffer::IsStreaming() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return open_ && reply_id_ != finished_reply_id_;
+}
+
+void EarlyPacketBuffer::Close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    open_ = false;
+}
+
+void EarlyPacketBuffer::Clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    DropAll();
+    open_ = false;
+}
+
+EarlyPacketBufferStats EarlyPacketBuffer::GetStats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void EarlyPacketBuffer::PopFront() {
+    pool_.Release(std::move(Slot(0)));
+    head_ = (head_ + 1) % capacity_;
+    count_--;
+}
+
+void EarlyPacketBuffer::DropAll() {
+    stats_.expired_packets += count_;
+    while (count_ > 0) {
+        PopFront();
+    }
+    head_ = 0;
+}
@@ -0,0 +1,78 @@
+#ifndef EARLY_PACKET_BUFFER_H
+#define EARLY_PACKET_BUFFER_H
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <cstdint>
+
+#include "audio_pool.h"
+#include "protocol.h"
+
+struct EarlyPacketBufferStats {
+    uint32_t held_packets = 0;
+    uint32_t rescued_packets = 0;
+    uint32_t expired_packets = 0;
+};
+
+/*
+ * Gate for the downlink packets of a reply, in front of the jitter buffer.
+ *
+ * "tts start" only schedules the state change on the main task, and the decoder is reset
+ * there, so the first packets of a reply can overtake it. Until the reply is opened every
+ * packet is held here, tagged with the reply that had started when it arrived. Open() is
+ * called after the decoder reset: it hands over the held packets of that reply and then
+ * lets the later ones through, so the reset never throws away packets of the new reply.
+ *
+ * Packets of another reply, older than max_age_ms at that point, or beyond the capacity go
+ * back to the packet pool. Replies are told apart by arrival order, so on a transport that
+ * reorders audio against the JSON messages (MQTT + UDP) a straggler of the previous reply
+ * can still be counted as part of the next one.
+ */
+class EarlyPacketBuffer {
+public:
+    using PacketCallback = std::function<void(std::unique_ptr<AudioStreamPacket>&& packet)>;
+
+    EarlyPacketBuffer(size_t capacity, int max_age_ms, AudioPool<AudioStreamPacket>& pool);
+    EarlyPacketBuffer(const EarlyPacketBuffer&) = delete;
+    EarlyPacketBuffer& operator=(const EarlyPacketBuffer&) = delete;
+
+    // packet->time_us must be the arrival time. Returns false if the reply is open, the packet
+    // is left untouched and the caller hands it to the jitter buffer itself
+    bool Hold(std::unique_ptr<AudioStreamPacket>&& packet, uint32_t reply_id);
+    // Hands the packets of the reply that are recent enough to the callback, in arrival order, and
+    // opens the reply. The callback runs under the lock, so no packet can pass the held ones.
+    // An older reply than the one packets are arriving for is not opened.
+    size_t Open(uint32_t reply_id, int64_t now_us, const PacketCallback& callback);
+    bool IsOpen(uint32_t reply_id);
+    // The server has sent the whole reply ("tts stop"), may come before the reply opens
+    void Finish(uint32_t reply_id);
+    bool IsFinished(uint32_t reply_id);
+    // True while the open reply still has packets to come
+    bool IsStreaming();
+    // Hold packets again, they are dropped once another reply opens
+    void Close();
+    void Clear();
+    EarlyPacketBufferStats GetStats();
+
+private:
+    std::mutex mutex_;
+    AudioPool<AudioStreamPacket>& pool_;
+    const size_t capacity_;
+    const int64_t max_age_us_;
+    // Fixed ring of capacity_ slots, allocated up front so holding a packet never allocates
+    std::vector<std::unique_ptr<AudioStreamPacket>> packets_;
+    size_t head_ = 0;
+    size_t count_ = 0;
+    uint32_t reply_id_ = 0;
+    uint32_t finished_reply_id_ = 0;
+    bool open_ = false;
+    EarlyPacketBufferStats stats_;
+
+    std::unique_ptr<AudioStreamPacket>& Slot(size_t index) { return packets_[(head_ + index) % capacity_]; }
+    void PopFront();
+    void DropAll();
+};
+
+#endif // EARLY_PACKET_BUFFER_H
@@ -0,0 +1,46 @@
+#include "encoder_controller.h"
+
+#include <algorithm>
+
+EncoderController::EncoderController(int min_complexity, int max_complexity)
+    : min_complexity_(min_complexity), max_complexity_(std::max(min_complexity, max_complexity)),
+      complexity_(min_complexity) {
+}
+
+bool EncoderController::Update(const EncoderControllerInput& input) {
+    if (input.audio_ms == 0) {
+        return false;
+    }
+    cpu_load_percent_ = input.encode_time_us / 10 / input.audio_ms;
+
+    int target = complexity_;
+    if (input.send_failures > 0 || input.send_queue_ms >= ENCODER_CONGESTED_QUEUE_MS) {
+        // Frames are piling up, spend less time per frame and stay there for a while
+        hold_windows_ = ENCODER_CONGESTION_HOLD_WINDOWS;
+        target = complexity_ - 2;
+        last_reason_ = input.send_failures > 0 ? "send failures" : "send queue";
+    } else if (cpu_load_percent_ >= ENCODER_CPU_HIGH_PERCENT) {
+        target = complexity_ - 1;
+        last_reason_ = "cpu load";
+    } else if (hold_windows_ > 0) {
+        // A queue between the two thresholds neither adds to nor ends the congestion
+        if (input.send_queue_ms < ENCODER_CLEAR_QUEUE_MS) {
+            hold_windows_--;
+        }
+    } else if (cpu_load_percent_ < ENCODER_CPU_LOW_PERCENT) {
+        target = complexity_ + 1;
+        last_reason_ = "cpu headroom";
+    }
+
+    target = std::clamp(target, min_complexity_, max_complexity_);
+    if (target == complexity_) {
+        return false;
+    }
+    if (target > complexity_) {
+        step_up_count_++;
+    } else {
+        step_down_count_++;
+    }
+    complexity_ = target;
+    return true;
+}
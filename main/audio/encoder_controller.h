@@ -0,0 +1,61 @@
+#ifndef ENCODER_CONTROLLER_H
+#define ENCODER_CONTROLLER_H
+
+#include <cstdint>
+
+// Share of the audio duration the encoder may spend on the CPU before it steps down / may step up
+#define ENCODER_CPU_HIGH_PERCENT 50
+#define ENCODER_CPU_LOW_PERCENT 25
+// Send queue depth that counts as congestion, and the depth it must fall below before it is over
+#define ENCODER_CONGESTED_QUEUE_MS 600
+#define ENCODER_CLEAR_QUEUE_MS 200
+// Clear windows after congestion before the complexity may step up again
+#define ENCODER_CONGESTION_HOLD_WINDOWS 5
+
+struct EncoderControllerInput {
+    uint32_t encode_time_us = 0;    // CPU time spent in the encoder during the window
+    uint32_t audio_ms = 0;          // Audio encoded during the window
+    uint32_t send_queue_ms = 0;     // Peak send queue depth during the window
+    uint32_t send_failures = 0;     // Transport send failures during the window
+};
+
+/*
+ * Closed-loop Opus complexity control, evaluated once per window of encoded audio.
+ *
+ * Steps down when the encoder uses too much of the real-time budget and steps up one
+ * level at a time while there is CPU headroom.
+ *
+ * The uplink is an input too: send failures or a send queue of ENCODER_CONGESTED_QUEUE_MS
+ * step down two levels. The esp-opus-encoder wrapper has no bitrate control, so this does
+ * not shrink the packets; it frees CPU time for the network stack, which retransmits and
+ * re-encrypts on the same cores while the link is congested. Congestion only counts as over
+ * once the queue has stayed under ENCODER_CLEAR_QUEUE_MS without failures for
+ * ENCODER_CONGESTION_HOLD_WINDOWS windows, so the complexity does not climb back while
+ * the link is still marginal.
+ */
+class EncoderController {
+public:
+    EncoderController(int min_complexity, int max_complexity);
+
+    // Returns true if the complexity changed
+    bool Update(const EncoderControllerInput& input);
+
+    int complexity() const { return complexity_; }
+    int cpu_load_percent() const { return cpu_load_percent_; }
+    bool congested() const { return hold_windows_ > 0; }
+    const char* last_reason() const { return last_reason_; }
+    uint32_t step_up_count() const { return step_up_count_; }
+    uint32_t step_down_count() const { return step_down_count_; }
+
+private:
+    const int min_complexity_;
+    const int max_complexity_;
+    int complexity_;
+    int cpu_load_percent_ = 0;
+    int hold_windows_ = 0;
+    const char* last_reason_ = "initial";
+    uint32_t step_up_count_ = 0;
+    uint32_t step_down_count_ = 0;
+};
+
+#endif // ENCODER_CONTROLLER_H
@@ -0,0 +1,47 @@
+#include "endpointer.h"
+
+Endpointer::Endpointer(int hangover_ms, int min_speech_ms, int max_utterance_ms)
+    : hangover_ms_(hangover_ms),
+      min_speech_ms_(min_speech_ms),
+      max_utterance_ms_(max_utterance_ms) {
+}
+
+void Endpointer::Reset() {
+    speech_ms_ = 0;
+    silence_ms_ = 0;
+    utterance_ms_ = 0;
+    reached_ = false;
+}
+
+EndpointReason Endpointer::Process(bool speech, int frame_ms) {
+    if (reached_) {
+        return kEndpointNone;
+    }
+
+    if (speech) {
+        speech_ms_ += frame_ms;
+        silence_ms_ = 0;
+    } else {
+        silence_ms_ += frame_ms;
+    }
+    if (speech_ms_ > 0 && speech_ms_ < min_speech_ms_ && silence_ms_ >= hangover_ms_) {
+        // Too short to be an utterance, wait for the next speech
+        speech_ms_ = 0;
+        utterance_ms_ = 0;
+    }
+    // The utterance starts with the first speech frame, leading silence is up to the server
+    if (speech_ms_ == 0) {
+        return kEndpointNone;
+    }
+    utterance_ms_ += frame_ms;
+
+    if (speech_ms_ >= min_speech_ms_ && silence_ms_ >= hangover_ms_) {
+        reached_ = true;
+        return kEndpointSilence;
+    }
+    if (utterance_ms_ >= max_utterance_ms_) {
+        reached_ = true;
+        return kEndpointMaxUtterance;
+    }
+    return kEndpointNone;
+}
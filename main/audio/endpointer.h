@@ -0,0 +1,42 @@
+#ifndef ENDPOINTER_H
+#define ENDPOINTER_H
+
+#include <cstdint>
+
+enum EndpointReason {
+    kEndpointNone,
+    kEndpointSilence,       // Speech was followed by the hangover of silence
+    kEndpointMaxUtterance,  // The utterance ran for the maximum length
+};
+
+/*
+ * On-device end-of-utterance detection for the auto stop listening mode.
+ *
+ * Driven once per processed frame with the VAD state, so its decisions only depend on the
+ * audio and can be replayed from a recorded VAD trace. An endpoint needs at least
+ * min_speech_ms of speech (a cough or a click does not end the turn); it is reached after
+ * hangover_ms of silence, or max_utterance_ms after the speech started. It is reported once,
+ * until the next Reset().
+ */
+class Endpointer {
+public:
+    Endpointer(int hangover_ms, int min_speech_ms, int max_utterance_ms);
+
+    void Reset();
+    EndpointReason Process(bool speech, int frame_ms);
+
+    bool endpoint_reached() const { return reached_; }
+    // Silence at the end of the utterance when the endpoint was reached, the end of speech is that long ago
+    int trailing_silence_ms() const { return silence_ms_; }
+
+private:
+    const int hangover_ms_;
+    const int min_speech_ms_;
+    const int max_utterance_ms_;
+    int speech_ms_ = 0;
+    int silence_ms_ = 0;
+    int utterance_ms_ = 0;
+    bool reached_ = false;
+};
+
+#endif // ENDPOINTER_H
@@ -0,0 +1,56 @@
+#include "frame_assembler.h"
+
+#include <algorithm>
+#include <cstring>
+
+void FrameAssembler::Reserve(size_t samples) {
+    if (samples <= ring_.size()) {
+        return;
+    }
+    // Only happens for the first chunks or after the frame size grew: unwrap into a larger ring
+    std::vector<int16_t> ring(samples);
+    size_t first = std::min(size_, ring_.size() - read_index_);
+    memcpy(ring.data(), ring_.data() + read_index_, first * sizeof(int16_t));
+    memcpy(ring.data() + first, ring_.data(), (size_ - first) * sizeof(int16_t));
+    ring_.swap(ring);
+    read_index_ = 0;
+}
+
+void FrameAssembler::Push(const int16_t* data, size_t samples, const FrameCallback& callback) {
+    const size_t frame_samples = frame_samples_;
+    if (frame_samples == 0 || samples == 0) {
+        return;
+    }
+    // Room for a chunk on top of anything short of a frame, so the ring stops growing after the first frames
+    Reserve(std::max(size_, frame_samples) + samples);
+
+    size_t capacity = ring_.size();
+    size_t write_index = (read_index_ + size_) % capacity;
+    size_t first = std::min(samples, capacity - write_index);
+    memcpy(ring_.data() + write_index, data, first * sizeof(int16_t));
+    memcpy(ring_.data(), data + first, (samples - first) * sizeof(int16_t));
+    size_ += samples;
+
+    while (size_ >= frame_samples) {
+        frame_.resize(frame_samples);
+        first = std::min(frame_samples, capacity - read_index_);
+        memcpy(frame_.data(), ring_.data() + read_index_, first * sizeof(int16_t));
+        memcpy(frame_.data() + first, ring_.data(), (frame_samples - first) * sizeof(int16_t));
+        read_index_ = (read_index_ + frame_samples) % capacity;
+        size_ -= frame_samples;
+        callback(std::move(frame_));
+    }
+}
+
+void FrameAssembler::Push(std::vector<int16_t>&& data, const FrameCallback& callback) {
+    if (size_ == 0 && data.size() == frame_samples_) {
+        callback(std::move(data));
+        return;
+    }
+    Push(data.data(), data.size(), callback);
+}
+
+void FrameAssembler::Reset() {
+    read_index_ = 0;
+    size_ = 0;
+}
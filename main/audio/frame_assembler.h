@@ -0,0 +1,41 @@
+#ifndef FRAME_ASSEMBLER_H
+#define FRAME_ASSEMBLER_H
+
+#include <atomic>
+#include <vector>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+
+/*
+ * Cuts a stream of chunks (AFE fetch size, codec reads) into frames of the encoder duration.
+ *
+ * Chunks are appended to a ring and every complete frame is copied out once into a frame
+ * buffer that is handed to the callback by rvalue. The callback may swap it with a recycled
+ * buffer of its own, so after the first frames neither side allocates, and nothing is shifted
+ * when a frame is consumed. Any chunk / frame size ratio works, and the frame size can be
+ * changed from another task; it takes effect at the next Push().
+ */
+class FrameAssembler {
+public:
+    using FrameCallback = std::function<void(std::vector<int16_t>&& frame)>;
+
+    void SetFrameSamples(size_t frame_samples) { frame_samples_ = frame_samples; }
+    size_t frame_samples() const { return frame_samples_; }
+
+    void Push(const int16_t* data, size_t samples, const FrameCallback& callback);
+    // A chunk that is exactly one frame while nothing is buffered is passed through without a copy
+    void Push(std::vector<int16_t>&& data, const FrameCallback& callback);
+    void Reset();
+
+private:
+    std::atomic<size_t> frame_samples_{0};
+    std::vector<int16_t> ring_;
+    size_t read_index_ = 0;
+    size_t size_ = 0;
+    std::vector<int16_t> frame_;
+
+    void Reserve(size_t samples);
+};
+
+#endif // FRAME_ASSEMBLER_H
@@ -0,0 +1,182 @@
+#include "jitter_buffer.h"
+
+#include <esp_log.h>
+#include <algorithm>
+#include <cstdlib>
+
+#define TAG "JitterBuffer"
+
+static size_t RoundUpToPowerOfTwo(size_t n) {
+    size_t size = 1;
+    while (size < n) {
+        size <<= 1;
+    }
+    return size;
+}
+
+JitterBuffer::JitterBuffer(size_t capacity, AudioPool<AudioStreamPacket>& pool)
+    : pool_(pool), capacity_(capacity), slots_(RoundUpToPowerOfTwo(capacity)), slot_mask_(slots_.size() - 1) {
+}
+
+bool JitterBuffer::Push(std::unique_ptr<AudioStreamPacket>&& packet, int64_t now_ms) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (packet->sequence != 0) {
+        sequenced_transport_ = true;
+    } else if (!sequenced_transport_) {
+        packet->sequence = ++arrival_sequence_;
+    }
+    if (packet->frame_duration > 0) {
+        frame_duration_ = packet->frame_duration;
+    }
+    uint32_t sequence = packet->sequence;
+
+    if (count_ == 0 && !playing_) {
+        // Start of a burst, the gap before it says nothing about the network jitter
+        has_transit_ = false;
+        buffering_since_ms_ = now_ms;
+        // Resync after an underrun, the frames in between were already heard as silence
+        if (!synced_ || (int32_t)(sequence - next_sequence_) > 0) {
+            next_sequence_ = sequence;
+            synced_ = true;
+        }
+    }
+    UpdateJitter(sequence, now_ms);
+
+    int32_t offset = (int32_t)(sequence - next_sequence_);
+    if (offset < 0) {
+        // Before the first frame is played, a reordered packet can still move the start back
+        if (played_ || (int32_t)(highest_sequence_ - sequence) >= (int32_t)capacity_) {
+            late_packets_++;
+            pool_.Release(std::move(packet));
+            return false;
+        }
+        next_sequence_ = sequence;
+        offset = 0;
+    }
+    if (offset >= (int32_t)capacity_) {
+        dropped_packets_++;
+        pool_.Release(std::move(packet));
+        return false;
+    }
+
+    auto& slot = slots_[sequence & slot_mask_];
+    if (slot) {
+        late_packets_++;
+        pool_.Release(std::move(packet));
+        return false;
+    }
+    if (count_ == 0 || (int32_t)(sequence - highest_sequence_) > 0) {
+        highest_sequence_ = sequence;
+    }
+    slot = std::move(packet);
+    count_++;
+    return true;
+}
+
+JitterBufferResult JitterBuffer::Pop(std::unique_ptr<AudioStreamPacket>& packet, int64_t now_ms) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (count_ == 0) {
+        if (playing_) {
+            playing_ = false;
+            if (!finished_) {
+                underruns_++;
+            }
+        }
+        return kJitterBufferEmpty;
+    }
+
+    if (!playing_) {
+        // Start playing at the target depth, or once the oldest packet has waited that long
+        if (count_ < target_depth_ && now_ms - buffering_since_ms_ < (int64_t)(target_depth_ * frame_duration_)) {
+            return kJitterBufferWait;
+        }
+        playing_ = true;
+        gap_since_ms_ = -1;
+    }
+
+    auto& slot = slots_[next_sequence_ & slot_mask_];
+    if (slot) {
+        packet = std::move(slot);
+        count_--;
+        next_sequence_++;
+        played_ = true;
+        gap_since_ms_ = -1;
+        return kJitterBufferPacket;
+    }
+
+    // The next packet is missing, give it one frame to show up unless enough later packets are here
+    if (gap_since_ms_ < 0) {
+        gap_since_ms_ = now_ms;
+    }
+    if (count_ < target_depth_ && now_ms - gap_since_ms_ < frame_duration_) {
+        return kJitterBufferWait;
+    }
+    ESP_LOGD(TAG, "Concealing lost packet %lu", (unsigned long)next_sequence_);
+    next_sequence_++;
+    played_ = true;
+    gap_since_ms_ = -1;
+    concealed_frames_++;
+    return kJitterBufferConceal;
+}
+
+void JitterBuffer::Finish() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    finished_ = true;
+}
+
+void JitterBuffer::Reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& slot : slots_) {
+        if (slot) {
+            pool_.Release(std::move(slot));
+        }
+    }
+    count_ = 0;
+    synced_ = false;
+    played_ = false;
+    playing_ = false;
+    finished_ = false;
+    sequenced_transport_ = false;
+    gap_since_ms_ = -1;
+    has_transit_ = false;
+}
+
+bool JitterBuffer::empty() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return count_ == 0;
+}
+
+size_t JitterBuffer::size() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return count_;
+}
+
+JitterBufferStats JitterBuffer::GetStats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    JitterBufferStats stats;
+    stats.depth = count_;
+    stats.target_depth = target_depth_;
+    stats.jitter_ms = jitter_q4_ >> 4;
+    stats.late_packets = late_packets_;
+    stats.dropped_packets = dropped_packets_;
+    stats.concealed_frames = concealed_frames_;
+    stats.underruns = underruns_;
+    return stats;
+}
+
+void JitterBuffer::UpdateJitter(uint32_t sequence, int64_t now_ms) {
+    if (has_transit_) {
+        // D = (Rj - Ri) - (Sj - Si), from the sequence distance so it holds across the 2^32 wrap
+        int64_t expected_ms = (int64_t)(int32_t)(sequence - last_sequence_) * frame_duration_;
+        int64_t d = std::min<int64_t>(std::abs(now_ms - last_arrival_ms_ - expected_ms), JITTER_BUFFER_MAX_DEPTH * frame_duration_);
+        // J += (|D| - J) / 16, kept scaled by 16
+        jitter_q4_ += d - ((jitter_q4_ + 8) >> 4);
+    }
+    last_sequence_ = sequence;
+    last_arrival_ms_ = now_ms;
+    has_transit_ = true;
+
+    // Cover twice the jitter on top of the frame being played
+    size_t target = 1 + (2 * (jitter_q4_ >> 4) + frame_duration_ - 1) / frame_duration_;
+    target_depth_ = std::clamp<size_t>(target, JITTER_BUFFER_MIN_DEPTH, JITTER_BUFFER_MAX_DEPTH);
+}
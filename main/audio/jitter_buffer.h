@@ -0,0 +1,93 @@
+#ifndef JITTER_BUFFER_H
+#define JITTER_BUFFER_H
+
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+
+#include "audio_pool.h"
+#include "protocol.h"
+
+#define JITTER_BUFFER_MIN_DEPTH 2
+#define JITTER_BUFFER_MAX_DEPTH 8
+
+struct JitterBufferStats {
+    size_t depth = 0;
+    size_t target_depth = 0;
+    uint32_t jitter_ms = 0;
+    uint32_t late_packets = 0;
+    uint32_t dropped_packets = 0;
+    uint32_t concealed_frames = 0;
+    uint32_t underruns = 0;
+};
+
+enum JitterBufferResult {
+    kJitterBufferEmpty,     // Nothing buffered
+    kJitterBufferWait,      // Still buffering, or waiting for a missing packet
+    kJitterBufferPacket,    // The next packet in sequence order
+    kJitterBufferConceal,   // The next packet is lost, the caller should conceal one frame
+};
+
+/*
+ * Reorders downlink packets by sequence number and releases them at a depth that follows
+ * the measured inter-arrival jitter (RFC 3550 estimator).
+ *
+ * Packets without a sequence number (TCP transports) are numbered in arrival order. Once a
+ * transport has sent sequence numbers, 0 is just the number after the wrap.
+ * Late and duplicate packets go straight back to the packet pool.
+ *
+ * Slots are indexed by the sequence number masked to a power of two, so consecutive
+ * sequence numbers keep distinct slots across the 2^32 wrap.
+ */
+class JitterBuffer {
+public:
+    JitterBuffer(size_t capacity, AudioPool<AudioStreamPacket>& pool);
+    JitterBuffer(const JitterBuffer&) = delete;
+    JitterBuffer& operator=(const JitterBuffer&) = delete;
+
+    // Returns false if the packet was late, duplicated or did not fit
+    bool Push(std::unique_ptr<AudioStreamPacket>&& packet, int64_t now_ms);
+    JitterBufferResult Pop(std::unique_ptr<AudioStreamPacket>& packet, int64_t now_ms);
+    // The sender has sent the whole stream, running empty from here on is its end, not an underrun
+    void Finish();
+    // Drop all packets and start a new stream, the jitter estimate is kept
+    void Reset();
+    bool empty();
+    size_t size();
+    JitterBufferStats GetStats();
+
+private:
+    std::mutex mutex_;
+    AudioPool<AudioStreamPacket>& pool_;
+    const size_t capacity_;
+    std::vector<std::unique_ptr<AudioStreamPacket>> slots_;
+    const uint32_t slot_mask_;
+    size_t count_ = 0;
+    bool synced_ = false;
+    bool played_ = false;
+    bool playing_ = false;
+    bool finished_ = false;
+    bool sequenced_transport_ = false;
+    uint32_t next_sequence_ = 0;
+    uint32_t highest_sequence_ = 0;
+    uint32_t arrival_sequence_ = 0;
+    int frame_duration_ = 60;
+    int64_t buffering_since_ms_ = 0;
+    int64_t gap_since_ms_ = -1;
+
+    bool has_transit_ = false;
+    uint32_t last_sequence_ = 0;
+    int64_t last_arrival_ms_ = 0;
+    int32_t jitter_q4_ = 0;
+    size_t target_depth_ = JITTER_BUFFER_MIN_DEPTH;
+
+    uint32_t late_packets_ = 0;
+    uint32_t dropped_packets_ = 0;
+    uint32_t concealed_frames_ = 0;
+    uint32_t underruns_ = 0;
+
+    void UpdateJitter(uint32_t sequence, int64_t now_ms);
+};
+
+#endif // JITTER_BUFFER_H
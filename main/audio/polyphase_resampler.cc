@@ -0,0 +1,122 @@
+#include "polyphase_resampler.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+template <int Up, int Down>
+struct Bank {
+    static constexpr polyphase::FilterBank<Up, Down> kFilter = polyphase::MakeFilterBank<Up, Down>();
+    static_assert(kFilter.max_abs_sum < 65536, "filter gain could overflow the int32 accumulator");
+};
+
+struct PolyphaseRatio {
+    int input_sample_rate;
+    int output_sample_rate;
+    int up;
+    int down;
+    int taps_per_phase;
+    const int16_t* taps;
+};
+
+#define POLYPHASE_RATIO(input, output, up, down) \
+    { input, output, up, down, Bank<up, down>::kFilter.kTapsPerPhase, Bank<up, down>::kFilter.taps.data() }
+
+const PolyphaseRatio kRatios[] = {
+    POLYPHASE_RATIO(16000, 24000, 3, 2),
+    POLYPHASE_RATIO(24000, 16000, 2, 3),
+    POLYPHASE_RATIO(16000, 48000, 3, 1),
+    POLYPHASE_RATIO(24000, 48000, 2, 1),
+    POLYPHASE_RATIO(48000, 16000, 1, 3),
+    POLYPHASE_RATIO(44100, 16000, 160, 441),
+};
+
+#undef POLYPHASE_RATIO
+
+const PolyphaseRatio* FindRatio(int input_sample_rate, int output_sample_rate) {
+    for (const auto& ratio : kRatios) {
+        if (ratio.input_sample_rate == input_sample_rate && ratio.output_sample_rate == output_sample_rate) {
+            return &ratio;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace
+
+bool PolyphaseResampler::IsSupported(int input_sample_rate, int output_sample_rate) {
+    return FindRatio(input_sample_rate, output_sample_rate) != nullptr;
+}
+
+bool PolyphaseResampler::Configure(int input_sample_rate, int output_sample_rate) {
+    auto ratio = FindRatio(input_sample_rate, output_sample_rate);
+    if (ratio == nullptr) {
+        return false;
+    }
+    input_sample_rate_ = input_sample_rate;
+    output_sample_rate_ = output_sample_rate;
+    up_ = ratio->up;
+    down_ = ratio->down;
+    taps_per_phase_ = ratio->taps_per_phase;
+    taps_ = ratio->taps;
+    Reset();
+    return true;
+}
+
+void PolyphaseResampler::Reset() {
+    position_ = 0;
+    work_.assign(taps_per_phase_ > 0 ? taps_per_phase_ - 1 : 0, 0);
+}
+
+int PolyphaseResampler::GetOutputSamples(int input_samples) const {
+    int end = input_samples * up_;
+    if (position_ >= end) {
+        return 0;
+    }
+    return (end - position_ + down_ - 1) / down_;
+}
+
+int PolyphaseResampler::Process(const int16_t* input, int input_samples, int16_t* output) {
+    if (taps_ == nullptr || input_samples <= 0) {
+        return 0;
+    }
+
+    const int history = taps_per_phase_ - 1;
+    work_.resize(history + input_samples);
+    memcpy(work_.data() + history, input, input_samples * sizeof(int16_t));
+
+    const int16_t* samples = work_.data() + history;
+    const int taps_per_phase = taps_per_phase_;
+    const int end = input_samples * up_;
+    int position = position_;
+    int count = 0;
+    // Walk the output positions with an integer sample index and phase instead of dividing each time
+    int index = position / up_;
+    int phase = position % up_;
+    const int index_step = down_ / up_;
+    const int phase_step = down_ % up_;
+    while (position < end) {
+        const int16_t* x = samples + index;
+        const int16_t* h = taps_ + phase * taps_per_phase;
+        int32_t acc = 1 << 14;
+        for (int k = 0; k < taps_per_phase; k++) {
+            acc += h[k] * x[-k];
+        }
+        output[count++] = (int16_t)std::clamp<int32_t>(acc >> 15, INT16_MIN, INT16_MAX);
+
+        position += down_;
+        index += index_step;
+        phase += phase_step;
+        if (phase >= up_) {
+            phase -= up_;
+            index++;
+        }
+    }
+    position_ = position - end;
+
+    // Keep the newest samples as history for the next block
+    memmove(work_.data(), work_.data() + input_samples, history * sizeof(int16_t));
+    work_.resize(history);
+    return count;
+}
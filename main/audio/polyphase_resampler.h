@@ -0,0 +1,143 @@
+#ifndef POLYPHASE_RESAMPLER_H
+#define POLYPHASE_RESAMPLER_H
+
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Filter length in input samples of the lower rate, the transition band shrinks as it grows
+#define POLYPHASE_FILTER_ZERO_CROSSINGS 16
+// Passband edge as a fraction of the lower Nyquist frequency
+#define POLYPHASE_FILTER_PASSBAND 0.9
+
+/*
+ * Windowed-sinc filter bank for an up / down ratio, built by the compiler.
+ *
+ * The prototype low-pass has up * taps_per_phase taps and is stored phase-major in Q15:
+ * taps[p * taps_per_phase + k] = h[p + k * up]. Each phase is normalized to unity DC gain,
+ * so a constant input comes out unchanged.
+ */
+namespace polyphase {
+
+constexpr double kPi = 3.14159265358979323846;
+
+constexpr double Sin(double x) {
+    long long turns = (long long)(x / (2 * kPi) + (x >= 0 ? 0.5 : -0.5));
+    x -= turns * 2 * kPi;
+    double term = x;
+    double sum = x;
+    for (int i = 1; i < 12; i++) {
+        term *= -x * x / ((2 * i) * (2 * i + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr double Cos(double x) {
+    return Sin(x + kPi / 2);
+}
+
+constexpr int32_t Abs(int32_t value) {
+    return value < 0 ? -value : value;
+}
+
+constexpr int TapsPerPhase(int up, int down) {
+    int longest = up > down ? up : down;
+    return (POLYPHASE_FILTER_ZERO_CROSSINGS * longest + up - 1) / up;
+}
+
+template <int Up, int Down>
+struct FilterBank {
+    static constexpr int kTapsPerPhase = TapsPerPhase(Up, Down);
+    std::array<int16_t, Up * kTapsPerPhase> taps{};
+    // Largest sum of |tap| over a phase; below 65536 an int32 accumulator cannot overflow
+    int32_t max_abs_sum = 0;
+};
+
+template <int Up, int Down>
+constexpr FilterBank<Up, Down> MakeFilterBank() {
+    FilterBank<Up, Down> bank;
+    constexpr int T = FilterBank<Up, Down>::kTapsPerPhase;
+    constexpr int N = Up * T;
+    // Cycles per sample at the upsampled rate
+    const double cutoff = POLYPHASE_FILTER_PASSBAND * 0.5 / (Up > Down ? Up : Down);
+    const double center = (N - 1) / 2.0;
+
+    for (int p = 0; p < Up; p++) {
+        double h[T] = {};
+        double sum = 0;
+        for (int k = 0; k < T; k++) {
+            int n = p + k * Up;
+            double x = n - center;
+            double sinc = x == 0 ? 2 * cutoff : Sin(2 * kPi * cutoff * x) / (kPi * x);
+            double window = 0.42 - 0.5 * Cos(2 * kPi * n / (N - 1)) + 0.08 * Cos(4 * kPi * n / (N - 1));
+            h[k] = sinc * window;
+            sum += h[k];
+        }
+
+        // Round to Q15 and put the rounding error on the largest tap so the phase sums to exactly 1.0
+        int32_t total = 0;
+        int largest = 0;
+        for (int k = 0; k < T; k++) {
+            double scaled = h[k] / sum * 32768;
+            int32_t q = (int32_t)(scaled + (scaled >= 0 ? 0.5 : -0.5));
+            bank.taps[p * T + k] = (int16_t)q;
+            total += q;
+            if (Abs(q) > Abs(bank.taps[p * T + largest])) {
+                largest = k;
+            }
+        }
+        bank.taps[p * T + largest] = (int16_t)(bank.taps[p * T + largest] + 32768 - total);
+
+        int32_t abs_sum = 0;
+        for (int k = 0; k < T; k++) {
+            abs_sum += Abs(bank.taps[p * T + k]);
+        }
+        if (abs_sum > bank.max_abs_sum) {
+            bank.max_abs_sum = abs_sum;
+        }
+    }
+    return bank;
+}
+
+} // namespace polyphase
+
+/*
+ * Fixed-point polyphase resampler for the ratios the boards use.
+ *
+ * Only the output phases that are actually needed are computed, with int16 taps and an int32
+ * accumulator. The input is copied behind the filter history before any output is written,
+ * so output may point at the same buffer as input (in-place) when it is no longer than input,
+ * which holds for every downsampling ratio.
+ *
+ * GetOutputSamples() is exact for the next Process() call, it accounts for the fractional
+ * position carried over from the previous block.
+ */
+class PolyphaseResampler {
+public:
+    // Returns false if there is no filter bank for this ratio
+    bool Configure(int input_sample_rate, int output_sample_rate);
+    static bool IsSupported(int input_sample_rate, int output_sample_rate);
+
+    int GetOutputSamples(int input_samples) const;
+    int Process(const int16_t* input, int input_samples, int16_t* output);
+    void Reset();
+
+    int input_sample_rate() const { return input_sample_rate_; }
+    int output_sample_rate() const { return output_sample_rate_; }
+
+private:
+    int input_sample_rate_ = 0;
+    int output_sample_rate_ = 0;
+    int up_ = 1;
+    int down_ = 1;
+    int taps_per_phase_ = 0;
+    const int16_t* taps_ = nullptr;
+    // Position of the next output sample in the upsampled domain, relative to the next input sample
+    int position_ = 0;
+    // The last taps_per_phase_ - 1 input samples, followed by the block being processed
+    std::vector<int16_t> work_;
+};
+
+#endif // POLYPHASE_RESAMPLER_H
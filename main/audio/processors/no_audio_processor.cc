@@ -6,6 +6,12 @@
 void NoAudioProcessor::Initialize(AudioCodec* codec, int frame_duration_ms, srmodel_list_t* models_list) {
     codec_ = codec;
     frame_samples_ = frame_duration_ms * 16000 / 1000;
+    frame_assembler_.SetFrameSamples(frame_samples_);
+}
+
+void NoAudioProcessor::SetFrameDuration(int frame_duration_ms) {
+    frame_samples_ = frame_duration_ms * 16000 / 1000;
+    frame_assembler_.SetFrameSamples(frame_samples_);
 }
 
 void NoAudioProcessor::Feed(std::vector<int16_t>&& data) {
@@ -14,15 +20,15 @@ void NoAudioProcessor::Feed(std::vector<int16_t>&& data) {
     }
 
     if (codec_->input_channels() == 2) {
-        // If input channels is 2, we need to fetch the left channel data
-        auto mono_data = std::vector<int16_t>(data.size() / 2);
-        for (size_t i = 0, j = 0; i < mono_data.size(); ++i, j += 2) {
-            mono_data[i] = data[j];
+        // If input channels is 2, we need to fetch the left channel data (in place)
+        size_t mono_samples = data.size() / 2;
+        for (size_t i = 0, j = 0; i < mono_samples; ++i, j += 2) {
+            data[i] = data[j];
         }
-        output_callback_(std::move(mono_data));
-    } else {
-        output_callback_(std::move(data));
+        data.resize(mono_samples);
     }
+    // The feed size is one frame, but a frame duration change can leave a partial frame behind
+    frame_assembler_.Push(std::move(data), output_callback_);
 }
 
 void NoAudioProcessor::Start() {
@@ -0,0 +1,196 @@
+#include "shared_afe.h"
+
+#include <esp_log.h>
+#include <esp_heap_caps.h>
+#include <esp_nsn_models.h>
+
+#include <sstream>
+#include <cstring>
+
+#define TAG "SharedAfe"
+
+SharedAfe::SharedAfe() {
+    event_group_ = xEventGroupCreate();
+}
+
+SharedAfe::~SharedAfe() {
+    if (afe_data_ != nullptr) {
+        afe_iface_->destroy(afe_data_);
+    }
+    vEventGroupDelete(event_group_);
+}
+
+bool SharedAfe::Initialize(AudioCodec* codec, srmodel_list_t* models_list) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (afe_data_ != nullptr) {
+        return true;
+    }
+
+    models_ = models_list != nullptr ? models_list : esp_srmodel_init("model");
+    if (models_ == nullptr || models_->num == -1) {
+        ESP_LOGE(TAG, "Failed to initialize models");
+        return false;
+    }
+    for (int i = 0; i < models_->num; i++) {
+        if (strstr(models_->model_name[i], ESP_WN_PREFIX) != NULL) {
+            wakenet_model_ = models_->model_name[i];
+            auto words = esp_srmodel_get_wake_words(models_, wakenet_model_);
+            // split by ";" to get all wake words
+            std::stringstream ss(words);
+            std::string word;
+            while (std::getline(ss, word, ';')) {
+                wake_words_.push_back(word);
+            }
+        }
+    }
+
+    int ref_num = codec->input_reference() ? 1 : 0;
+    std::string input_format;
+    for (int i = 0; i < codec->input_channels() - ref_num; i++) {
+        input_format.push_back('M');
+    }
+    for (int i = 0; i < ref_num; i++) {
+        input_format.push_back('R');
+    }
+
+    // The wake word settings, plus the VAD / NS of the voice communication pipeline
+    afe_config_t* afe_config = afe_config_init(input_format.c_str(), models_, AFE_TYPE_SR, AFE_MODE_HIGH_PERF);
+    reference_aec_ = codec->input_reference();
+    afe_config->aec_init = reference_aec_;
+    afe_config->aec_mode = AEC_MODE_SR_HIGH_PERF;
+    afe_config->vad_init = true;
+    afe_config->vad_mode = VAD_MODE_0;
+    afe_config->vad_min_noise_ms = 100;
+    char* vad_model_name = esp_srmodel_filter(models_, ESP_VADN_PREFIX, NULL);
+    if (vad_model_name != nullptr) {
+        afe_config->vad_model_name = vad_model_name;
+    }
+    char* ns_model_name = esp_srmodel_filter(models_, ESP_NSNET_PREFIX, NULL);
+    if (ns_model_name != nullptr) {
+        afe_config->ns_init = true;
+        afe_config->ns_model_name = ns_model_name;
+        afe_config->afe_ns_mode = AFE_NS_MODE_NET;
+    } else {
+        afe_config->ns_init = false;
+    }
+    afe_config->agc_init = false;
+    afe_config->afe_perferred_core = 1;
+    afe_config->afe_perferred_priority = 1;
+    afe_config->memory_alloc_mode = AFE_MEMORY_ALLOC_MORE_PSRAM;
+
+    size_t psram_before = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+    size_t internal_before = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    afe_iface_ = esp_afe_handle_from_config(afe_config);
+    afe_data_ = afe_iface_->create_from_config(afe_config);
+    ESP_LOGI(TAG, "Shared AFE uses %u KB PSRAM, %u KB internal RAM",
+        (unsigned)((psram_before - heap_caps_get_free_size(MALLOC_CAP_SPIRAM)) / 1024),
+        (unsigned)((internal_before - heap_caps_get_free_size(MALLOC_CAP_INTERNAL)) / 1024));
+
+    // WakeNet only runs while the wake word mode is enabled
+    if (wakenet_model_ != nullptr) {
+        afe_iface_->disable_wakenet(afe_data_);
+    }
+
+    xTaskCreate([](void* arg) {
+        auto this_ = (SharedAfe*)arg;
+        this_->FetchTask();
+        vTaskDelete(NULL);
+    }, "audio_afe", 4096, this, 3, nullptr);
+    return true;
+}
+
+void SharedAfe::SetHandler(SharedAfeMode mode, FetchHandler handler) {
+    std::lock_guard<std::mutex> lock(handler_mutex_);
+    if (mode == kSharedAfeModeWakeWord) {
+        wake_word_handler_ = handler;
+    } else {
+        voice_communication_handler_ = handler;
+    }
+}
+
+void SharedAfe::Feed(const int16_t* data) {
+    if (afe_data_ == nullptr) {
+        return;
+    }
+    afe_iface_->feed(afe_data_, data);
+}
+
+size_t SharedAfe::GetFeedSize() {
+    if (afe_data_ == nullptr) {
+        return 0;
+    }
+    return afe_iface_->get_feed_chunksize(afe_data_);
+}
+
+void SharedAfe::EnableMode(SharedAfeMode mode, bool enable) {
+    if (afe_data_ == nullptr) {
+        return;
+    }
+    if (mode == kSharedAfeModeWakeWord && wakenet_model_ != nullptr) {
+        if (enable) {
+            afe_iface_->enable_wakenet(afe_data_);
+        } else {
+            afe_iface_->disable_wakenet(afe_data_);
+        }
+    }
+    if (enable) {
+        xEventGroupSetBits(event_group_, mode);
+    } else {
+        xEventGroupClearBits(event_group_, mode);
+        if (!IsRunning()) {
+            afe_iface_->reset_buffer(afe_data_);
+        }
+    }
+}
+
+bool SharedAfe::IsModeEnabled(SharedAfeMode mode) const {
+    return xEventGroupGetBits(event_group_) & mode;
+}
+
+bool SharedAfe::IsRunning() const {
+    return xEventGroupGetBits(event_group_) & (kSharedAfeModeWakeWord | kSharedAfeModeVoiceCommunication);
+}
+
+void SharedAfe::EnableDeviceAec(bool enable) {
+    if (afe_data_ == nullptr) {
+        return;
+    }
+    if (enable) {
+#if CONFIG_USE_DEVICE_AEC
+        afe_iface_->disable_vad(afe_data_);
+        afe_iface_->enable_aec(afe_data_);
+#else
+        ESP_LOGE(TAG, "Device AEC is not supported");
+#endif
+    } else {
+        // The wake word keeps its own AEC on the reference channel
+        if (!reference_aec_) {
+            afe_iface_->disable_aec(afe_data_);
+        }
+        afe_iface_->enable_vad(afe_data_);
+    }
+}
+
+void SharedAfe::FetchTask() {
+    ESP_LOGI(TAG, "Shared AFE task started, feed size: %d fetch size: %d",
+        afe_iface_->get_feed_chunksize(afe_data_), afe_iface_->get_fetch_chunksize(afe_data_));
+
+    while (true) {
+        xEventGroupWaitBits(event_group_, kSharedAfeModeWakeWord | kSharedAfeModeVoiceCommunication,
+            pdFALSE, pdFALSE, portMAX_DELAY);
+
+        auto res = afe_iface_->fetch_with_delay(afe_data_, portMAX_DELAY);
+        if (res == nullptr || res->ret_value == ESP_FAIL) {
+            continue;
+        }
+
+        EventBits_t bits = xEventGroupGetBits(event_group_);
+        std::lock_guard<std::mutex> lock(handler_mutex_);
+        if ((bits & kSharedAfeModeWakeWord) && wake_word_handler_) {
+            wake_word_handler_(res);
+        }
+        if ((bits & kSharedAfeModeVoiceCommunication) && voice_communication_handler_) {
+            voice_communication_handler_(res);
+        }
+    }
+}
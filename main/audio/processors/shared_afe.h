@@ -0,0 +1,73 @@
+#ifndef SHARED_AFE_H
+#define SHARED_AFE_H
+
+#include <esp_afe_sr_models.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/event_groups.h>
+#include <model_path.h>
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <mutex>
+
+#include "audio_codec.h"
+
+enum SharedAfeMode {
+    kSharedAfeModeWakeWord = 0x01,
+    kSharedAfeModeVoiceCommunication = 0x02,
+};
+
+/*
+ * One ESP-SR AFE pipeline (AFE_TYPE_SR) serving both the wake word and voice communication.
+ *
+ * Normally AfeWakeWord and AfeAudioProcessor each create an AFE, with its own feed / fetch tasks
+ * and PSRAM buffers. With CONFIG_USE_SHARED_AFE both are thin front ends of this object, and
+ * going from idle to listening only flips mode bits: the AEC / NS / VAD state keeps running
+ * instead of a second AFE warming up.
+ *
+ * Every fetch result is handed to the handler of each enabled mode. WakeNet only runs while
+ * the wake word mode is enabled. When no mode is enabled the fetch task sleeps and the
+ * buffered input is dropped.
+ */
+class SharedAfe {
+public:
+    using FetchHandler = std::function<void(afe_fetch_result_t* result)>;
+
+    SharedAfe();
+    ~SharedAfe();
+
+    // Safe to call from both front ends, only the first call creates the AFE
+    bool Initialize(AudioCodec* codec, srmodel_list_t* models_list);
+    bool has_wake_word() const { return wakenet_model_ != nullptr; }
+    const std::vector<std::string>& wake_words() const { return wake_words_; }
+
+    void Feed(const int16_t* data);
+    size_t GetFeedSize();
+    void EnableMode(SharedAfeMode mode, bool enable);
+    bool IsModeEnabled(SharedAfeMode mode) const;
+    bool IsRunning() const;
+    void EnableDeviceAec(bool enable);
+    // Waits for a running handler to return, so it must not be called from a handler.
+    // A front end clears its handler with nullptr before it is destroyed.
+    void SetHandler(SharedAfeMode mode, FetchHandler handler);
+
+private:
+    std::mutex mutex_;
+    EventGroupHandle_t event_group_ = nullptr;
+    srmodel_list_t* models_ = nullptr;
+    const esp_afe_sr_iface_t* afe_iface_ = nullptr;
+    esp_afe_sr_data_t* afe_data_ = nullptr;
+    char* wakenet_model_ = nullptr;
+    bool reference_aec_ = false;
+    std::vector<std::string> wake_words_;
+    // Held by the fetch task while it calls the handlers
+    std::mutex handler_mutex_;
+    FetchHandler wake_word_handler_;
+    FetchHandler voice_communication_handler_;
+
+    void FetchTask();
+};
+
+#endif // SHARED_AFE_H
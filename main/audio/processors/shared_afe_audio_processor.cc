@@ -0,0 +1,76 @@
+#include "shared_afe_audio_processor.h"
+#include <esp_log.h>
+
+#define TAG "SharedAfeAudioProcessor"
+
+SharedAfeAudioProcessor::SharedAfeAudioProcessor(std::shared_ptr<SharedAfe> afe)
+    : afe_(afe) {
+}
+
+SharedAfeAudioProcessor::~SharedAfeAudioProcessor() {
+    // The other front end may keep the AFE running, make sure it no longer calls into this one
+    afe_->SetHandler(kSharedAfeModeVoiceCommunication, nullptr);
+}
+
+void SharedAfeAudioProcessor::Initialize(AudioCodec* codec, int frame_duration_ms, srmodel_list_t* models_list) {
+    frame_assembler_.SetFrameSamples(frame_duration_ms * 16000 / 1000);
+    afe_->SetHandler(kSharedAfeModeVoiceCommunication, [this](afe_fetch_result_t* res) {
+        OnFetch(res);
+    });
+    if (!afe_->Initialize(codec, models_list)) {
+        ESP_LOGE(TAG, "Failed to initialize shared AFE");
+    }
+}
+
+void SharedAfeAudioProcessor::SetFrameDuration(int frame_duration_ms) {
+    frame_assembler_.SetFrameSamples(frame_duration_ms * 16000 / 1000);
+}
+
+size_t SharedAfeAudioProcessor::GetFeedSize() {
+    return afe_->GetFeedSize();
+}
+
+void SharedAfeAudioProcessor::Feed(std::vector<int16_t>&& data) {
+    afe_->Feed(data.data());
+}
+
+void SharedAfeAudioProcessor::Start() {
+    afe_->EnableMode(kSharedAfeModeVoiceCommunication, true);
+}
+
+void SharedAfeAudioProcessor::Stop() {
+    afe_->EnableMode(kSharedAfeModeVoiceCommunication, false);
+}
+
+bool SharedAfeAudioProcessor::IsRunning() {
+    return afe_->IsModeEnabled(kSharedAfeModeVoiceCommunication);
+}
+
+void SharedAfeAudioProcessor::OnOutput(std::function<void(std::vector<int16_t>&& data)> callback) {
+    output_callback_ = callback;
+}
+
+void SharedAfeAudioProcessor::OnVadStateChange(std::function<void(bool speaking)> callback) {
+    vad_state_change_callback_ = callback;
+}
+
+void SharedAfeAudioProcessor::EnableDeviceAec(bool enable) {
+    afe_->EnableDeviceAec(enable);
+}
+
+void SharedAfeAudioProcessor::OnFetch(afe_fetch_result_t* res) {
+    // VAD state change
+    if (vad_state_change_callback_) {
+        if (res->vad_state == VAD_SPEECH && !is_speaking_) {
+            is_speaking_ = true;
+            vad_state_change_callback_(true);
+        } else if (res->vad_state == VAD_SILENCE && is_speaking_) {
+            is_speaking_ = false;
+            vad_state_change_callback_(false);
+        }
+    }
+
+    if (output_callback_) {
+        frame_assembler_.Push(res->data, res->data_size / sizeof(int16_t), output_callback_);
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef SHARED_AFE_AUDIO_PROCESSOR_H
+#define SHARED_AFE_AUDIO_PROCESSOR_H
+
+#include <memory>
+#include <vector>
+#include <functional>
+
+#include "audio_processor.h"
+#include "audio_codec.h"
+#include "frame_assembler.h"
+#include "shared_afe.h"
+
+// Voice communication front end of the shared AFE, see SharedAfe
+class SharedAfeAudioProcessor : public AudioProcessor {
+public:
+    explicit SharedAfeAudioProcessor(std::shared_ptr<SharedAfe> afe);
+    ~SharedAfeAudioProcessor();
+
+    void Initialize(AudioCodec* codec, int frame_duration_ms, srmodel_list_t* models_list) override;
+    void SetFrameDuration(int frame_duration_ms) override;
+    void Feed(std::vector<int16_t>&& data) override;
+    void Start() override;
+    void Stop() override;
+    bool IsRunning() override;
+    void OnOutput(std::function<void(std::vector<int16_t>&& data)> callback) override;
+    void OnVadStateChange(std::function<void(bool speaking)> callback) override;
+    size_t GetFeedSize() override;
+    void EnableDeviceAec(bool enable) override;
+
+private:
+    std::shared_ptr<SharedAfe> afe_;
+    std::function<void(std::vector<int16_t>&& data)> output_callback_;
+    std::function<void(bool speaking)> vad_state_change_callback_;
+    bool is_speaking_ = false;
+    FrameAssembler frame_assembler_;
+
+    void OnFetch(afe_fetch_result_t* res);
+};
+
+#endif // SHARED_AFE_AUDIO_PROCESSOR_H
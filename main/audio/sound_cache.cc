@@ -0,0 +1,179 @@
+#include "sound_cache.h"
+
+#include <esp_log.h>
+#include <esp_heap_caps.h>
+#include <cstring>
+
+#define TAG "SoundCache"
+
+static uint32_t ReadLe32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+PcmSound::PcmSound(size_t samples, int sample_rate) : sample_rate(sample_rate) {
+    data = (int16_t*)heap_caps_malloc(samples * sizeof(int16_t), MALLOC_CAP_SPIRAM);
+    if (data != nullptr) {
+        this->samples = samples;
+    }
+}
+
+PcmSound::~PcmSound() {
+    if (data != nullptr) {
+        heap_caps_free(data);
+    }
+}
+
+std::shared_ptr<const OggSound> SoundCache::Get(const std::string_view& ogg) {
+    if (ogg.size() < 27) {
+        return nullptr;
+    }
+    uint32_t first_page_crc = ReadLe32(reinterpret_cast<const uint8_t*>(ogg.data()) + 22);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& sound = sounds_[{ogg.data(), ogg.size()}];
+    if (sound && sound->first_page_crc == first_page_crc) {
+        return sound;
+    }
+
+    // First play, or the asset data behind this address has changed
+    if (sound && sound->pcm) {
+        pcm_bytes_ -= sound->pcm->samples * sizeof(int16_t);
+    }
+    sound = std::make_shared<OggSound>();
+    sound->first_page_crc = first_page_crc;
+    if (!Parse(ogg, *sound)) {
+        sounds_.erase({ogg.data(), ogg.size()});
+        return nullptr;
+    }
+    ESP_LOGI(TAG, "Indexed sound: %u packets, %d Hz, %d channels, %u bytes",
+        (unsigned)sound->packets.size(), sound->sample_rate, sound->channels, (unsigned)ogg.size());
+    return sound;
+}
+
+std::shared_ptr<PcmSound> SoundCache::GetPcm(const std::string_view& ogg, int sample_rate) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = sounds_.find({ogg.data(), ogg.size()});
+    if (it == sounds_.end() || !it->second->pcm) {
+        return nullptr;
+    }
+    if (it->second->pcm->sample_rate != sample_rate) {
+        ESP_LOGW(TAG, "Output sample rate changed to %d, dropping cached PCM", sample_rate);
+        ClearPcmLocked();
+        return nullptr;
+    }
+    return it->second->pcm;
+}
+
+bool SoundCache::PutPcm(const std::string_view& ogg, std::shared_ptr<PcmSound> pcm) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = sounds_.find({ogg.data(), ogg.size()});
+    if (it == sounds_.end() || it->second->pcm) {
+        return false;
+    }
+    size_t bytes = pcm->samples * sizeof(int16_t);
+    if (pcm_bytes_ + bytes > pcm_budget_) {
+        ESP_LOGW(TAG, "PCM cache budget exceeded: %u + %u > %u bytes", (unsigned)pcm_bytes_, (unsigned)bytes, (unsigned)pcm_budget_);
+        return false;
+    }
+    it->second->pcm = std::move(pcm);
+    pcm_bytes_ += bytes;
+    return true;
+}
+
+void SoundCache::ClearPcm() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ClearPcmLocked();
+}
+
+void SoundCache::ClearPcmLocked() {
+    for (auto& [key, sound] : sounds_) {
+        sound->pcm.reset();
+    }
+    pcm_bytes_ = 0;
+}
+
+bool SoundCache::Parse(const std::string_view& ogg, OggSound& sound) {
+    const uint8_t* buf = reinterpret_cast<const uint8_t*>(ogg.data());
+    size_t size = ogg.size();
+    size_t offset = 0;
+
+    auto find_page = [&](size_t start)->size_t {
+        for (size_t i = start; i + 4 <= size; ++i) {
+            if (buf[i] == 'O' && buf[i+1] == 'g' && buf[i+2] == 'g' && buf[i+3] == 'S') return i;
+        }
+        return static_cast<size_t>(-1);
+    };
+
+    bool seen_head = false;
+    bool seen_tags = false;
+
+    while (true) {
+        size_t pos = find_page(offset);
+        if (pos == static_cast<size_t>(-1)) break;
+        offset = pos;
+        if (offset + 27 > size) break;
+
+        const uint8_t* page = buf + offset;
+        uint8_t page_segments = page[26];
+        size_t seg_table_off = offset + 27;
+        if (seg_table_off + page_segments > size) break;
+
+        size_t body_size = 0;
+        for (size_t i = 0; i < page_segments; ++i) body_size += page[27 + i];
+
+        size_t body_off = seg_table_off + page_segments;
+        if (body_off + body_size > size) break;
+
+        // Parse packets using lacing
+        size_t cur = body_off;
+        size_t seg_idx = 0;
+        while (seg_idx < page_segments) {
+            size_t pkt_len = 0;
+            size_t pkt_start = cur;
+            bool continued = false;
+            do {
+                uint8_t l = page[27 + seg_idx++];
+                pkt_len += l;
+                cur += l;
+                continued = (l == 255);
+            } while (continued && seg_idx < page_segments);
+
+            if (pkt_len == 0) continue;
+            const uint8_t* pkt_ptr = buf + pkt_start;
+
+            if (!seen_head) {
+                // OpusHead: [0-7] "OpusHead", [8] version, [9] channel_count, [10-11] pre_skip,
+                // [12-15] input_sample_rate, [16-17] output_gain, [18] mapping_family
+                if (pkt_len >= 19 && std::memcmp(pkt_ptr, "OpusHead", 8) == 0) {
+                    seen_head = true;
+                    sound.channels = pkt_ptr[9];
+                    sound.sample_rate = ReadLe32(pkt_ptr + 12);
+                }
+                continue;
+            }
+            if (!seen_tags) {
+                // Expect OpusTags in second packet
+                if (pkt_len >= 8 && std::memcmp(pkt_ptr, "OpusTags", 8) == 0) {
+                    seen_tags = true;
+                }
+                continue;
+            }
+
+            // Audio packet (Opus)
+            if (pkt_len > UINT16_MAX) {
+                ESP_LOGW(TAG, "Skipping oversized packet of %u bytes", (unsigned)pkt_len);
+                continue;
+            }
+            sound.packets.push_back({ (uint32_t)pkt_start, (uint16_t)pkt_len });
+        }
+
+        offset = body_off + body_size;
+    }
+
+    if (!seen_head) {
+        ESP_LOGE(TAG, "No OpusHead found");
+        return false;
+    }
+    sound.packets.shrink_to_fit();
+    return true;
+}
@@ -0,0 +1,72 @@
+#ifndef SOUND_CACHE_H
+#define SOUND_CACHE_H
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <string_view>
+#include <cstdint>
+
+struct OggPacketRef {
+    uint32_t offset;
+    uint16_t length;
+};
+
+// Fully decoded sound at the codec output rate, kept in PSRAM
+struct PcmSound {
+    PcmSound(size_t samples, int sample_rate);
+    ~PcmSound();
+    PcmSound(const PcmSound&) = delete;
+    PcmSound& operator=(const PcmSound&) = delete;
+
+    int16_t* data = nullptr;
+    size_t samples = 0;
+    int sample_rate = 0;
+};
+
+struct OggSound {
+    int sample_rate = 16000;
+    int channels = 1;
+    uint32_t first_page_crc = 0;
+    std::vector<OggPacketRef> packets;
+    std::shared_ptr<PcmSound> pcm;  // Only accessed under the cache mutex, use GetPcm()
+};
+
+/*
+ * Opus packet index of the Ogg sounds played by AudioService::PlaySound.
+ *
+ * Each sound is parsed once, later calls only walk the (offset, length) list, which points
+ * into the original rodata or memory-mapped asset data. That data must stay mapped while
+ * the sound is cached; an entry whose first page CRC no longer matches is parsed again.
+ *
+ * Short latency-critical sounds can also keep their decoded PCM, within a byte budget.
+ * Playback holds a reference, so dropping the cache never frees PCM that is being played.
+ * The same goes for the index: a sound that is parsed again replaces the entry, and the
+ * caller keeps using the old one until it drops its reference.
+ */
+class SoundCache {
+public:
+    // Returns nullptr if the data is not an Ogg Opus stream
+    std::shared_ptr<const OggSound> Get(const std::string_view& ogg);
+
+    // Decoded PCM of a sound, only if it was decoded for this output sample rate.
+    // A different rate means the codec changed, and every cached PCM is dropped.
+    std::shared_ptr<PcmSound> GetPcm(const std::string_view& ogg, int sample_rate);
+    // Returns false if the sound is not indexed or the PCM does not fit in the budget
+    bool PutPcm(const std::string_view& ogg, std::shared_ptr<PcmSound> pcm);
+    void ClearPcm();
+    void SetPcmBudget(size_t bytes) { pcm_budget_ = bytes; }
+    size_t pcm_bytes() const { return pcm_bytes_; }
+
+private:
+    std::mutex mutex_;
+    size_t pcm_budget_ = 0;
+    size_t pcm_bytes_ = 0;
+    std::map<std::pair<const char*, size_t>, std::shared_ptr<OggSound>> sounds_;
+
+    static bool Parse(const std::string_view& ogg, OggSound& sound);
+    void ClearPcmLocked();
+};
+
+#endif // SOUND_CACHE_H
@@ -0,0 +1,140 @@
+#include "time_stretcher.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+int TimeStretcher::FindPeriod(const int16_t* x, int min_period, int max_period, int match) const {
+    // Nearly silent: any period works, take the shortest to keep the change fine-grained
+    int64_t energy = 0;
+    for (int i = 0; i < match + max_period; i += 2) {
+        energy += (int32_t)x[i] * x[i];
+    }
+    if (energy < (int64_t)TIME_STRETCH_SILENCE_LEVEL * TIME_STRETCH_SILENCE_LEVEL * ((match + max_period) / 2)) {
+        return min_period;
+    }
+
+    // Coarse search on every other period and every other sample, then refine around the best
+    auto score = [x, match](int period) -> float {
+        int64_t cross = 0;
+        int64_t shifted_energy = 0;
+        for (int i = 0; i < match; i += 2) {
+            int32_t a = x[i];
+            int32_t b = x[i + period];
+            cross += a * b;
+            shifted_energy += b * b;
+        }
+        if (cross <= 0 || shifted_energy == 0) {
+            return 0;
+        }
+        return (float)cross * cross / shifted_energy;
+    };
+    int best_period = 0;
+    float best_score = 0;
+    for (int period = min_period; period <= max_period; period += 2) {
+        float s = score(period);
+        if (s > best_score) {
+            best_score = s;
+            best_period = period;
+        }
+    }
+    if (best_period == 0) {
+        return 0;
+    }
+    int coarse = best_period;
+    for (int period = std::max(min_period, coarse - 1); period <= std::min(max_period, coarse + 1); period++) {
+        float s = score(period);
+        if (s > best_score) {
+            best_score = s;
+            best_period = period;
+        }
+    }
+
+    // Normalized correlation over all samples of the chosen period
+    int64_t cross = 0;
+    int64_t energy_a = 0;
+    int64_t energy_b = 0;
+    for (int i = 0; i < match; i++) {
+        int32_t a = x[i];
+        int32_t b = x[i + best_period];
+        cross += a * b;
+        energy_a += a * a;
+        energy_b += b * b;
+    }
+    if (cross <= 0) {
+        return 0;
+    }
+    // cross / sqrt(energy_a * energy_b) >= threshold, squared to stay away from the square root
+    float threshold = TIME_STRETCH_MIN_CORRELATION_PERCENT / 100.0f;
+    if ((float)cross * cross < threshold * threshold * energy_a * energy_b) {
+        return 0;
+    }
+    return best_period;
+}
+
+void TimeStretcher::Process(std::vector<int16_t>& pcm, int sample_rate, TimeStretchMode mode, std::vector<int16_t>& scratch) {
+    if (mode == kTimeStretchNone) {
+        return;
+    }
+    const int samples = pcm.size();
+    const int min_period = sample_rate * TIME_STRETCH_MIN_PERIOD_MS / 1000;
+    const int max_period = sample_rate * TIME_STRETCH_MAX_PERIOD_MS / 1000;
+    const int match = sample_rate * TIME_STRETCH_MATCH_MS / 1000;
+    // Samples to remove or add for the speed limit
+    int budget;
+    if (mode == kTimeStretchAccelerate) {
+        budget = samples - samples * 100 / TIME_STRETCH_MAX_SPEED_PERCENT;
+    } else {
+        budget = samples * 100 / TIME_STRETCH_MIN_SPEED_PERCENT - samples;
+    }
+    if (budget < min_period || samples < 2 * max_period + match) {
+        return;
+    }
+
+    const int16_t* x = pcm.data();
+    scratch.clear();
+    scratch.reserve(samples + budget);
+    int position = 0;
+    int changed = 0;
+    while (changed + min_period <= budget && position + max_period + std::max(max_period, match) <= samples) {
+        int period = FindPeriod(x + position, min_period, std::min(max_period, budget - changed), match);
+        if (period == 0) {
+            stats_.rejected_segments++;
+            // Move on by half a comparison window and try again
+            int step = match / 2;
+            scratch.insert(scratch.end(), x + position, x + position + step);
+            position += step;
+            continue;
+        }
+
+        // Cross-fade from one period into the next (accelerate) or back into the previous one (expand)
+        const int16_t* from;
+        const int16_t* to;
+        if (mode == kTimeStretchAccelerate) {
+            from = x + position;
+            to = x + position + period;
+        } else {
+            scratch.insert(scratch.end(), x + position, x + position + period);
+            from = x + position + period;
+            to = x + position;
+        }
+        for (int i = 0; i < period; i++) {
+            int32_t w = (i << 15) / period;
+            scratch.push_back((int16_t)((from[i] * (32768 - w) + to[i] * w) >> 15));
+        }
+        position += mode == kTimeStretchAccelerate ? 2 * period : period;
+        changed += period;
+    }
+    if (changed == 0) {
+        return;
+    }
+    scratch.insert(scratch.end(), x + position, x + samples);
+
+    if (mode == kTimeStretchAccelerate) {
+        stats_.accelerated_frames++;
+        stats_.removed_samples += changed;
+    } else {
+        stats_.expanded_frames++;
+        stats_.added_samples += changed;
+    }
+    pcm.swap(scratch);
+}
@@ -0,0 +1,57 @@
+#ifndef TIME_STRETCHER_H
+#define TIME_STRETCHER_H
+
+#include <vector>
+#include <cstdint>
+
+// Fastest and slowest playback speed
+#define TIME_STRETCH_MAX_SPEED_PERCENT 115
+#define TIME_STRETCH_MIN_SPEED_PERCENT 87
+// Pitch periods searched, and the length of the waveform compared for each candidate
+#define TIME_STRETCH_MIN_PERIOD_MS 2.5
+#define TIME_STRETCH_MAX_PERIOD_MS 12.5
+#define TIME_STRETCH_MATCH_MS 10
+// A period is only removed or repeated where the waveform is this similar (percent normalized
+// correlation), or where it is nearly silent
+#define TIME_STRETCH_MIN_CORRELATION_PERCENT 60
+#define TIME_STRETCH_SILENCE_LEVEL 64
+
+enum TimeStretchMode {
+    kTimeStretchNone,
+    kTimeStretchAccelerate,     // Shorten the frame, to drain the buffer
+    kTimeStretchExpand,         // Lengthen the frame, to ride through a gap
+};
+
+struct TimeStretchStats {
+    uint32_t accelerated_frames = 0;
+    uint32_t expanded_frames = 0;
+    uint32_t removed_samples = 0;
+    uint32_t added_samples = 0;
+    uint32_t rejected_segments = 0;
+};
+
+/*
+ * Time-scale modification of decoded frames without a pitch change (WSOLA).
+ *
+ * Every frame is processed on its own, so there is no added delay and switching between
+ * modes is seamless: the search finds the pitch period whose next period best matches the
+ * waveform, and one period is removed (accelerate) or repeated (expand) with a linear
+ * cross-fade, at as many points of the frame as the speed allows. Segments that are neither
+ * periodic nor quiet, like onsets and fricatives, are left alone, so a frame may change less
+ * than asked. Integer arithmetic except for one division per candidate period.
+ */
+class TimeStretcher {
+public:
+    // pcm is replaced with the processed frame, scratch is a buffer that is reused between calls
+    void Process(std::vector<int16_t>& pcm, int sample_rate, TimeStretchMode mode, std::vector<int16_t>& scratch);
+
+    const TimeStretchStats& stats() const { return stats_; }
+
+private:
+    TimeStretchStats stats_;
+
+    // Returns the best period at position, or 0 if the segment should not be touched
+    int FindPeriod(const int16_t* x, int min_period, int max_period, int match) const;
+};
+
+#endif // TIME_STRETCHER_H
@@ -0,0 +1,71 @@
+#include "shared_afe_wake_word.h"
+
+#include <esp_log.h>
+
+#define TAG "SharedAfeWakeWord"
+
+SharedAfeWakeWord::SharedAfeWakeWord(std::shared_ptr<SharedAfe> afe)
+    : afe_(afe) {
+}
+
+SharedAfeWakeWord::~SharedAfeWakeWord() {
+    // The other front end may keep the AFE running, make sure it no longer calls into this one
+    afe_->SetHandler(kSharedAfeModeWakeWord, nullptr);
+}
+
+bool SharedAfeWakeWord::Initialize(AudioCodec* codec, srmodel_list_t* models_list) {
+    afe_->SetHandler(kSharedAfeModeWakeWord, [this](afe_fetch_result_t* res) {
+        OnFetch(res);
+    });
+    if (!afe_->Initialize(codec, models_list)) {
+        return false;
+    }
+    if (!afe_->has_wake_word()) {
+        // The AFE was created by the audio processor before the wakenet model was available
+        ESP_LOGE(TAG, "Shared AFE has no wakenet model");
+        return false;
+    }
+    return true;
+}
+
+void SharedAfeWakeWord::OnWakeWordDetected(std::function<void(const std::string& wake_word)> callback) {
+    wake_word_detected_callback_ = callback;
+}
+
+void SharedAfeWakeWord::Start() {
+    afe_->EnableMode(kSharedAfeModeWakeWord, true);
+}
+
+void SharedAfeWakeWord::Stop() {
+    afe_->EnableMode(kSharedAfeModeWakeWord, false);
+}
+
+void SharedAfeWakeWord::Feed(const std::vector<int16_t>& data) {
+    afe_->Feed(data.data());
+}
+
+size_t SharedAfeWakeWord::GetFeedSize() {
+    return afe_->GetFeedSize();
+}
+
+void SharedAfeWakeWord::OnFetch(afe_fetch_result_t* res) {
+    // Store the wake word data for voice recognition, like who is speaking
+    recorder_.Store(res->data, res->data_size / sizeof(int16_t));
+
+    if (res->wakeup_state == WAKENET_DETECTED) {
+        Stop();
+        last_detected_wake_word_ = afe_->wake_words()[res->wakenet_model_index - 1];
+
+        if (wake_word_detected_callback_) {
+            wake_word_detected_callback_(last_detected_wake_word_);
+        }
+    }
+}
+
+void SharedAfeWakeWord::EncodeWakeWordData(int frame_duration_ms) {
+    recorder_.Encode(frame_duration_ms);
+}
+
+bool SharedAfeWakeWord::GetWakeWordOpus(std::vector<uint8_t>& opus) {
+    return recorder_.GetOpus(opus);
+}
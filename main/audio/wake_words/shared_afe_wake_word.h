@@ -0,0 +1,39 @@
+#ifndef SHARED_AFE_WAKE_WORD_H
+#define SHARED_AFE_WAKE_WORD_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <functional>
+
+#include "audio_codec.h"
+#include "wake_word.h"
+#include "wake_word_recorder.h"
+#include "processors/shared_afe.h"
+
+// Wake word front end of the shared AFE, see SharedAfe
+class SharedAfeWakeWord : public WakeWord {
+public:
+    explicit SharedAfeWakeWord(std::shared_ptr<SharedAfe> afe);
+    ~SharedAfeWakeWord();
+
+    bool Initialize(AudioCodec* codec, srmodel_list_t* models_list);
+    void Feed(const std::vector<int16_t>& data);
+    void OnWakeWordDetected(std::function<void(const std::string& wake_word)> callback);
+    void Start();
+    void Stop();
+    size_t GetFeedSize();
+    void EncodeWakeWordData(int frame_duration_ms);
+    bool GetWakeWordOpus(std::vector<uint8_t>& opus);
+    const std::string& GetLastDetectedWakeWord() const { return last_detected_wake_word_; }
+
+private:
+    std::shared_ptr<SharedAfe> afe_;
+    std::function<void(const std::string& wake_word)> wake_word_detected_callback_;
+    std::string last_detected_wake_word_;
+    WakeWordRecorder recorder_;
+
+    void OnFetch(afe_fetch_result_t* res);
+};
+
+#endif // SHARED_AFE_WAKE_WORD_H
@@ -0,0 +1,177 @@
+#include "wake_word_recorder.h"
+
+#include <esp_log.h>
+#include <esp_heap_caps.h>
+#include <esp_timer.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#define TAG "WakeWordRecorder"
+
+WakeWordRecorder::WakeWordRecorder() {
+    capacity_ = WAKE_WORD_SAMPLE_RATE / 1000 * WAKE_WORD_PCM_DURATION_MS;
+    frame_duration_ms_ = CONFIG_OPUS_FRAME_DURATION_MS;
+#if CONFIG_WAKE_WORD_INCREMENTAL_ENCODE
+    incremental_ = true;
+#else
+    incremental_ = false;
+#endif
+}
+
+WakeWordRecorder::~WakeWordRecorder() {
+    if (encode_task_ != nullptr) {
+        vTaskDelete(encode_task_);
+    }
+    if (encode_task_stack_ != nullptr) {
+        heap_caps_free(encode_task_stack_);
+    }
+    if (encode_task_buffer_ != nullptr) {
+        heap_caps_free(encode_task_buffer_);
+    }
+    if (pcm_ != nullptr) {
+        heap_caps_free(pcm_);
+    }
+}
+
+void WakeWordRecorder::AllocateRing() {
+    pcm_ = (int16_t*)heap_caps_malloc(capacity_ * sizeof(int16_t), MALLOC_CAP_SPIRAM);
+    assert(pcm_ != nullptr);
+}
+
+void WakeWordRecorder::StartEncodeTask() {
+    encode_task_stack_ = (StackType_t*)heap_caps_malloc(WAKE_WORD_ENCODE_TASK_STACK_SIZE, MALLOC_CAP_SPIRAM);
+    assert(encode_task_stack_ != nullptr);
+    encode_task_buffer_ = (StaticTask_t*)heap_caps_malloc(sizeof(StaticTask_t), MALLOC_CAP_INTERNAL);
+    assert(encode_task_buffer_ != nullptr);
+    encode_task_ = xTaskCreateStatic([](void* arg) {
+        auto this_ = (WakeWordRecorder*)arg;
+        this_->EncodeTask();
+        vTaskDelete(NULL);
+    }, "encode_wake_word", WAKE_WORD_ENCODE_TASK_STACK_SIZE, this, 2, encode_task_stack_, encode_task_buffer_);
+}
+
+void WakeWordRecorder::Store(const int16_t* data, size_t samples) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (pcm_ == nullptr) {
+        AllocateRing();
+        if (incremental_) {
+            StartEncodeTask();
+        }
+    }
+    if (samples > capacity_) {
+        data += samples - capacity_;
+        samples = capacity_;
+    }
+    size_t first = std::min(samples, capacity_ - write_index_);
+    memcpy(pcm_ + write_index_, data, first * sizeof(int16_t));
+    memcpy(pcm_, data + first, (samples - first) * sizeof(int16_t));
+    write_index_ = (write_index_ + samples) % capacity_;
+    size_ = std::min(size_ + samples, capacity_);
+    pending_ = std::min(pending_ + samples, capacity_);
+    if (incremental_ && pending_ >= FrameSamples()) {
+        cv_.notify_all();
+    }
+}
+
+void WakeWordRecorder::Encode(int frame_duration_ms) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    opus_.clear();
+    if (!incremental_ || frame_duration_ms != frame_duration_ms_) {
+        // Nothing encoded yet, or encoded with another frame duration: start over from the whole window
+        window_opus_.clear();
+        pending_ = size_;
+        frame_duration_ms_ = frame_duration_ms;
+    }
+    ESP_LOGI(TAG, "Wake word window: %u packets ready, %u ms to encode", (unsigned)window_opus_.size(),
+        (unsigned)(pending_ * 1000 / WAKE_WORD_SAMPLE_RATE));
+    opus_.swap(window_opus_);
+    flushing_ = true;
+    if (encode_task_ == nullptr) {
+        StartEncodeTask();
+    }
+    cv_.notify_all();
+}
+
+bool WakeWordRecorder::GetOpus(std::vector<uint8_t>& opus) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this]() {
+        return !opus_.empty();
+    });
+    opus.swap(opus_.front());
+    opus_.pop_front();
+    return !opus.empty();
+}
+
+void WakeWordRecorder::EncodeTask() {
+    std::vector<int16_t> frame;
+    std::vector<uint8_t> opus;
+    int64_t flush_start_time = 0;
+    int flush_packets = 0;
+
+    while (true) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this]() {
+            return flushing_ || (incremental_ && pending_ >= FrameSamples());
+        });
+        if (flushing_ && flush_start_time == 0) {
+            flush_start_time = esp_timer_get_time();
+        }
+
+        const size_t frame_samples = FrameSamples();
+        if (pending_ < frame_samples) {
+            // Only a partial frame is left, the encoder would not emit it either
+            ESP_LOGI(TAG, "Encode wake word opus %d packets in %ld ms", flush_packets,
+                (long)((esp_timer_get_time() - flush_start_time) / 1000));
+            opus_.emplace_back();
+            flushing_ = false;
+            size_ = 0;
+            pending_ = 0;
+            window_opus_.clear();
+            cv_.notify_all();
+            lock.unlock();
+
+            if (encoder_) {
+                encoder_->ResetState();
+            }
+            flush_start_time = 0;
+            flush_packets = 0;
+            continue;
+        }
+
+        const int frame_duration_ms = frame_duration_ms_;
+        size_t start = (write_index_ + capacity_ - pending_) % capacity_;
+        size_t first = std::min(frame_samples, capacity_ - start);
+        frame.resize(frame_samples);
+        memcpy(frame.data(), pcm_ + start, first * sizeof(int16_t));
+        memcpy(frame.data() + first, pcm_, (frame_samples - first) * sizeof(int16_t));
+        pending_ -= frame_samples;
+        lock.unlock();
+
+        if (!encoder_ || encoder_->duration_ms() != frame_duration_ms) {
+            encoder_ = std::make_unique<OpusEncoderWrapper>(WAKE_WORD_SAMPLE_RATE, 1, frame_duration_ms);
+            encoder_->SetComplexity(0); // 0 is the fastest
+        }
+        opus.clear();
+        if (!encoder_->Encode(std::move(frame), opus)) {
+            continue;
+        }
+
+        lock.lock();
+        if (frame_duration_ms != frame_duration_ms_) {
+            // The window is being encoded again with the new frame duration
+            continue;
+        }
+        if (flushing_) {
+            opus_.emplace_back(std::move(opus));
+            flush_packets++;
+            cv_.notify_all();
+        } else {
+            window_opus_.emplace_back(std::move(opus));
+            while (window_opus_.size() > capacity_ / frame_samples) {
+                window_opus_.pop_front();
+            }
+        }
+    }
+}
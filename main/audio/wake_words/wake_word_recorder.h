@@ -0,0 +1,77 @@
+#ifndef WAKE_WORD_RECORDER_H
+#define WAKE_WORD_RECORDER_H
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <opus_encoder.h>
+
+#include <deque>
+#include <memory>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+
+// Audio kept before the wake word is detected, at 16 kHz mono
+#define WAKE_WORD_PCM_DURATION_MS 2000
+#define WAKE_WORD_SAMPLE_RATE 16000
+#define WAKE_WORD_ENCODE_TASK_STACK_SIZE (4096 * 7)
+
+/*
+ * Keeps the audio around the wake word so it can be sent to the server after detection.
+ *
+ * The detection task writes its chunks into a fixed ring in PSRAM, nothing is allocated per chunk.
+ * One encoder task turns the ring into Opus packets:
+ * - by default it only runs after detection, and encodes the whole window at once;
+ * - with CONFIG_WAKE_WORD_INCREMENTAL_ENCODE it encodes every frame as soon as it is complete and
+ *   keeps the packets of the last window, so after detection they can be sent right away while
+ *   only the last partial frame is left to encode.
+ *
+ * A rolling window starts at an arbitrary packet of a continuous stream; the decoder on the server
+ * settles within the first frame.
+ *
+ * Nothing is allocated until it is needed: the ring comes with the first stored chunk, and the
+ * encoder task and its PSRAM stack with it in incremental mode, or with the first detection otherwise.
+ */
+class WakeWordRecorder {
+public:
+    WakeWordRecorder();
+    ~WakeWordRecorder();
+
+    // Called by the detection task for every chunk it looks at
+    void Store(const int16_t* data, size_t samples);
+    // Called once the wake word is detected, makes the window available through GetOpus()
+    void Encode(int frame_duration_ms);
+    // Blocks until the next packet is ready, returns false after the last one
+    bool GetOpus(std::vector<uint8_t>& opus);
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    int16_t* pcm_ = nullptr;
+    size_t capacity_ = 0;
+    size_t write_index_ = 0;
+    size_t size_ = 0;
+    // Samples at the end of the ring that are not encoded yet
+    size_t pending_ = 0;
+    int frame_duration_ms_;
+    bool incremental_;
+    bool flushing_ = false;
+    // Packets of the current window (incremental mode), and the packets handed out by GetOpus()
+    std::deque<std::vector<uint8_t>> window_opus_;
+    std::deque<std::vector<uint8_t>> opus_;
+
+    TaskHandle_t encode_task_ = nullptr;
+    StaticTask_t* encode_task_buffer_ = nullptr;
+    StackType_t* encode_task_stack_ = nullptr;
+    std::unique_ptr<OpusEncoderWrapper> encoder_;
+
+    size_t FrameSamples() const { return WAKE_WORD_SAMPLE_RATE / 1000 * frame_duration_ms_; }
+    // Both are called with mutex_ held
+    void AllocateRing();
+    void StartEncodeTask();
+    void EncodeTask();
+};
+
+#endif // WAKE_WORD_RECORDER_H
@@ -35,7 +35,8 @@ public:
             .auto_clear_before_cb = false,
             .intr_priority = 0,
         };
-        ESP_ERROR_CHECK(i2s_new_channel(&chan_cfg, &tx_handle_, &rx_handle_));
+        tx_chan_cfg_ = chan_cfg;
+        rx_chan_cfg_ = chan_cfg;
     
         i2s_std_config_t std_cfg = {
             .clk_cfg = {
@@ -73,8 +74,10 @@ public:
                 }
             }
         };
-        ESP_ERROR_CHECK(i2s_channel_init_std_mode(tx_handle_, &std_cfg));
-        ESP_ERROR_CHECK(i2s_channel_init_std_mode(rx_handle_, &std_cfg));
+        // Kept so the channels can be recreated with the low latency DMA sizes
+        tx_std_cfg_ = std_cfg;
+        rx_std_cfg_ = std_cfg;
+        CreateChannels();
         ESP_LOGI(TAG, "Duplex channels created");
     }
 };
@@ -1,4 +1,5 @@
 #include "k10_audio_codec.h"
+#include "audio_gain.h"
 
 #include <esp_log.h>
 #include <driver/i2c_master.h>
@@ -15,6 +16,7 @@ K10AudioCodec::K10AudioCodec(void* i2c_master_handle, int input_sample_rate, int
     input_channels_ = input_reference_ ? 2 : 1; // 输入通道数
     input_sample_rate_ = input_sample_rate;
     output_sample_rate_ = output_sample_rate;
+    output_native_slots_ = 2; // 每个样本写两次
 
     CreateDuplexChannels(mclk, bclk, ws, dout, din);
 
@@ -199,27 +201,28 @@ int K10AudioCodec::Read(int16_t* dest, int samples) {
 
 int K10AudioCodec::Write(const int16_t* data, int samples) {
     if (output_enabled_) {
-        std::vector<int32_t> buffer(samples * 2);  // Allocate buffer for 2x samples
+        write_buffer_.resize(samples * 2);  // 2x samples
 
-        // Apply volume adjustment (same as before)
-        int32_t volume_factor = pow(double(output_volume_) / 100.0, 2) * 65536;
+        // Scale into the upper half, then repeat each sample for slow playback (assuming mono audio)
+        int32_t* buffer = write_buffer_.data();
+        ScaleToInt32(data, buffer + samples, samples, output_volume_factor());
         for (int i = 0; i < samples; i++) {
-            int64_t temp = int64_t(data[i]) * volume_factor;
-            if (temp > INT32_MAX) {
-            buffer[i * 2] = INT32_MAX;
-            } else if (temp < INT32_MIN) {
-            buffer[i * 2] = INT32_MIN;
-            } else {
-            buffer[i * 2] = static_cast<int32_t>(temp);
-            }
-
-            // Repeat each sample for slow playback (assuming mono audio)
-            buffer[i * 2 + 1] = buffer[i * 2];
+            buffer[i * 2] = buffer[samples + i];
+            buffer[i * 2 + 1] = buffer[samples + i];
         }
 
         size_t bytes_written;
-        ESP_ERROR_CHECK(i2s_channel_write(tx_handle_, buffer.data(), samples * 2 * sizeof(int32_t), &bytes_written, portMAX_DELAY));
+        ESP_ERROR_CHECK(i2s_channel_write(tx_handle_, buffer, samples * 2 * sizeof(int32_t), &bytes_written, portMAX_DELAY));
         return bytes_written / sizeof(int32_t);
     }
     return samples;
 }
+
+int K10AudioCodec::WriteNative(const int32_t* data, int words) {
+    if (output_enabled_) {
+        size_t bytes_written;
+        ESP_ERROR_CHECK(i2s_channel_write(tx_handle_, data, words * sizeof(int32_t), &bytes_written, portMAX_DELAY));
+        return bytes_written / sizeof(int32_t);
+    }
+    return words;
+}
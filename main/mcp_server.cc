@@ -135,6 +135,22 @@ void McpServer::AddUserOnlyTools() {
             return board.GetSystemInfoJson();
         });
 
+    AddUserOnlyTool("self.get_audio_statistics",
+        "Get the audio pipeline statistics: frame counters, per-stage latency histograms, queue high-water marks and jitter buffer state.\n"
+        "Args:\n"
+        "  `reset`: Reset the statistics after reading them.",
+        PropertyList({
+            Property("reset", kPropertyTypeBoolean, false)
+        }),
+        [this](const PropertyList& properties) -> ReturnValue {
+            auto& audio_service = Application::GetInstance().GetAudioService();
+            auto json = audio_service.GetStatisticsJson();
+            if (properties["reset"].value<bool>()) {
+                audio_service.ResetStatistics();
+            }
+            return json;
+        });
+
     AddUserOnlyTool("self.reboot", "Reboot the system",
         PropertyList(),
         [this](const PropertyList& properties) -> ReturnValue {
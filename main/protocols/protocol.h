@@ -11,6 +11,8 @@ struct AudioStreamPacket {
     int sample_rate = 0;
     int frame_duration = 0;
     uint32_t timestamp = 0;
+    uint32_t sequence = 0;  // 0 if the transport has no sequence number
+    int64_t time_us = 0;    // Local time the packet was encoded or received, for latency statistics
     std::vector<uint8_t> payload;
 };
 
@@ -51,6 +53,14 @@ public:
     inline int server_frame_duration() const {
         return server_frame_duration_;
     }
+    // The server accepted uplink silence suppression in its hello
+    inline bool server_dtx() const {
+        return server_dtx_;
+    }
+    // The server accepted on-device end of utterance detection in its hello
+    inline bool server_endpoint() const {
+        return server_endpoint_;
+    }
     inline const std::string& session_id() const {
         return session_id_;
     }
@@ -67,7 +77,8 @@ public:
     virtual bool OpenAudioChannel() = 0;
     virtual void CloseAudioChannel() = 0;
     virtual bool IsAudioChannelOpened() const = 0;
-    virtual bool SendAudio(std::unique_ptr<AudioStreamPacket> packet) = 0;
+    // The packet stays owned by the caller, so it can be recycled after sending
+    virtual bool SendAudio(const AudioStreamPacket& packet) = 0;
     virtual void SendWakeWordDetected(const std::string& wake_word);
     virtual void SendStartListening(ListeningMode mode);
     virtual void SendStopListening();
@@ -85,6 +96,8 @@ protected:
 
     int server_sample_rate_ = 24000;
     int server_frame_duration_ = 60;
+    bool server_dtx_ = false;
+    bool server_endpoint_ = false;
     bool error_occurred_ = false;
     std::string session_id_;
     std::chrono::time_point<std::chrono::steady_clock> last_incoming_time_;
@@ -0,0 +1,117 @@
+/*
+ * AudioMixer::MixToInt32() against the two-pass path it replaces, Mix() followed by
+ * ScaleToInt32() and one copy of each word per slot: both must give the same I2S words for
+ * a lone source, a ducked mix with its gain ramp, saturating sums and every volume range.
+ */
+#include "audio_mixer.h"
+#include "audio_gain.h"
+#include "host_test.h"
+
+#include <random>
+#include <vector>
+
+#define FRAME_SAMPLES 1440
+
+static std::vector<int16_t> RandomFrame(std::mt19937& rng, int amplitude) {
+    std::uniform_int_distribution<int> dist(-amplitude, amplitude);
+    std::vector<int16_t> frame(FRAME_SAMPLES);
+    for (auto& sample : frame) {
+        sample = (int16_t)dist(rng);
+    }
+    return frame;
+}
+
+static std::vector<int32_t> MixThenScale(AudioMixer& mixer, const int16_t* const inputs[kAudioMixerSourceCount],
+    int32_t volume_factor, int slots) {
+    std::vector<int16_t> pcm(FRAME_SAMPLES);
+    mixer.Mix(inputs, FRAME_SAMPLES, pcm.data());
+    std::vector<int32_t> words(FRAME_SAMPLES);
+    ScaleToInt32(pcm.data(), words.data(), FRAME_SAMPLES, volume_factor);
+    std::vector<int32_t> output(FRAME_SAMPLES * slots);
+    for (size_t i = 0; i < FRAME_SAMPLES; i++) {
+        for (int c = 0; c < slots; c++) {
+            output[i * slots + c] = words[i];
+        }
+    }
+    return output;
+}
+
+static std::vector<int32_t> MixToWords(AudioMixer& mixer, const int16_t* const inputs[kAudioMixerSourceCount],
+    int32_t volume_factor, int slots) {
+    std::vector<int32_t> output(FRAME_SAMPLES * slots);
+    mixer.MixToInt32(inputs, FRAME_SAMPLES, output.data(), volume_factor, slots);
+    return output;
+}
+
+// Plays the same frames and gain changes through two mixers and compares every word
+static void CheckSameWords(int slots, int32_t volume_factor, int amplitude, bool with_notification) {
+    std::mt19937 rng(slots * 1000 + amplitude);
+    AudioMixer reference;
+    AudioMixer mixer;
+    for (int frame = 0; frame < 6; frame++) {
+        // Duck for the middle frames, the changes ramp over the next frame
+        int32_t speech_gain = (with_notification && frame >= 2 && frame < 4) ? AUDIO_MIXER_DUCK_GAIN : AUDIO_MIXER_UNITY_GAIN;
+        reference.SetGain(kAudioMixerSourceSpeech, speech_gain);
+        mixer.SetGain(kAudioMixerSourceSpeech, speech_gain);
+
+        auto speech = RandomFrame(rng, amplitude);
+        auto notification = RandomFrame(rng, amplitude);
+        const int16_t* inputs[kAudioMixerSourceCount] = {
+            speech.data(),
+            (with_notification && frame >= 2 && frame < 5) ? notification.data() : nullptr,
+        };
+        auto expected = MixThenScale(reference, inputs, volume_factor, slots);
+        auto actual = MixToWords(mixer, inputs, volume_factor, slots);
+        size_t mismatches = 0;
+        for (size_t i = 0; i < expected.size(); i++) {
+            mismatches += expected[i] != actual[i];
+        }
+        CHECK_EQ(mismatches, 0u);
+    }
+}
+
+static void LoneSpeechMatches() {
+    for (int slots : {1, 2}) {
+        for (int32_t volume_factor : {0, VolumeToFactor(30), VolumeToFactor(80), 65536, 90000}) {
+            CheckSameWords(slots, volume_factor, INT16_MAX, false);
+        }
+    }
+}
+
+static void DuckedMixMatches() {
+    for (int slots : {1, 2}) {
+        for (int32_t volume_factor : {VolumeToFactor(60), 65536, 90000}) {
+            CheckSameWords(slots, volume_factor, 8000, true);
+        }
+    }
+}
+
+static void SaturatedMixMatches() {
+    // Two full-scale sources overflow 16 bits before the volume is applied
+    for (int slots : {1, 2}) {
+        for (int32_t volume_factor : {VolumeToFactor(70), 65536, 90000}) {
+            CheckSameWords(slots, volume_factor, INT16_MAX, true);
+        }
+    }
+}
+
+static void SilentSourcesGiveSilence() {
+    AudioMixer mixer;
+    const int16_t* inputs[kAudioMixerSourceCount] = { nullptr, nullptr };
+    for (int slots : {1, 2}) {
+        auto words = MixToWords(mixer, inputs, 65536, slots);
+        size_t nonzero = 0;
+        for (int32_t word : words) {
+            nonzero += word != 0;
+        }
+        CHECK_EQ(nonzero, 0u);
+    }
+}
+
+int main() {
+    RUN_TEST(LoneSpeechMatches);
+    RUN_TEST(DuckedMixMatches);
+    RUN_TEST(SaturatedMixMatches);
+    RUN_TEST(SilentSourcesGiveSilence);
+    return HostTestResult();
+}
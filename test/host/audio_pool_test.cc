@@ -0,0 +1,127 @@
+#include "audio_pool.h"
+#include "audio_queue.h"
+#include "jitter_buffer.h"
+#include "counting_allocator.h"
+#include "host_test.h"
+
+static void TestRecycles() {
+    AudioPool<AudioStreamPacket> pool(2);
+    auto a = pool.Acquire();
+    auto* raw = a.get();
+    a->payload.assign(100, 1);
+    pool.Release(std::move(a));
+    auto b = pool.Acquire();
+    CHECK(b.get() == raw);
+    CHECK(b->payload.capacity() >= 100);
+    CHECK_EQ(pool.exhausted_count(), 0u);
+}
+
+static void TestExhaustion() {
+    AudioPool<AudioStreamPacket> pool(1);
+    auto a = pool.Acquire();
+    auto b = pool.Acquire();
+    CHECK(b != nullptr);
+    CHECK_EQ(pool.exhausted_count(), 1u);
+    pool.Release(std::move(a));
+    // The pool is full again, the surplus object is freed
+    HeapAllocationScope scope;
+    pool.Release(std::move(b));
+    CHECK(pool.Acquire() != nullptr);
+    CHECK_EQ(pool.exhausted_count(), 1u);
+    CHECK_EQ(scope.allocations(), 0u);
+}
+
+static void FillPayload(AudioStreamPacket& packet, size_t bytes, uint8_t value) {
+    // Like Protocol: assign into the recycled buffer
+    packet.payload.resize(bytes);
+    std::fill(packet.payload.begin(), packet.payload.end(), value);
+}
+
+/*
+ * The pipeline in steady state: a TTS burst filling the jitter buffer, the send queue
+ * backed up by a network stall, and frames flowing through both. With the pool sized from
+ * the queue capacities, nothing touches the heap once every buffer has grown to the
+ * largest frame.
+ */
+static void TestSteadyStateHasNoAllocations() {
+    constexpr size_t kJitterCapacity = 40;
+    constexpr size_t kSendCapacity = 120;
+    constexpr size_t kInFlight = 4;
+    constexpr size_t kMaxPayload = 240;
+    AudioPool<AudioStreamPacket> pool(kJitterCapacity + kSendCapacity + kInFlight);
+    JitterBuffer jitter_buffer(kJitterCapacity, pool);
+    AudioQueue<std::unique_ptr<AudioStreamPacket>> send_queue(kSendCapacity);
+    std::vector<uint8_t> decode_payload;
+
+    uint32_t sequence = 1;
+    int64_t now_ms = 0;
+    auto run = [&](int bursts) {
+        for (int burst = 0; burst < bursts; burst++) {
+            // Downlink burst up to the jitter buffer capacity, then played out
+            for (size_t i = 0; i < kJitterCapacity; i++) {
+                auto packet = pool.Acquire();
+                packet->sequence = sequence++;
+                packet->frame_duration = 60;
+                FillPayload(*packet, kMaxPayload - (i % 7) * 20, (uint8_t)i);
+                jitter_buffer.Push(std::move(packet), now_ms);
+            }
+            // Uplink stalls until the send queue is full
+            for (size_t i = 0; i < kSendCapacity; i++) {
+                auto packet = pool.Acquire();
+                FillPayload(*packet, kMaxPayload - (i % 5) * 30, (uint8_t)i);
+                if (!send_queue.Push(std::move(packet))) {
+                    pool.Release(std::move(packet));
+                }
+            }
+            std::unique_ptr<AudioStreamPacket> packet;
+            for (size_t i = 0; i < kJitterCapacity; i++) {
+                now_ms += 60;
+                if (jitter_buffer.Pop(packet, now_ms) == kJitterBufferPacket) {
+                    decode_payload.assign(packet->payload.begin(), packet->payload.end());
+                    pool.Release(std::move(packet));
+                }
+            }
+            while (send_queue.Pop(packet)) {
+                pool.Release(std::move(packet));
+            }
+        }
+    };
+
+    // Warm up, every pooled buffer grows to its largest frame
+    run(3);
+    CHECK_EQ(pool.exhausted_count(), 0u);
+    HeapAllocationScope scope;
+    run(50);
+    CHECK_EQ(scope.allocations(), 0u);
+    CHECK_EQ(pool.exhausted_count(), 0u);
+}
+
+static void TestUndersizedPoolAllocates() {
+    // The former fixed 16 packet pool against the same burst
+    AudioPool<AudioStreamPacket> pool(16);
+    AudioQueue<std::unique_ptr<AudioStreamPacket>> send_queue(120);
+    auto burst = [&]() {
+        for (int i = 0; i < 120; i++) {
+            auto packet = pool.Acquire();
+            FillPayload(*packet, 200, 0);
+            send_queue.Push(std::move(packet));
+        }
+        std::unique_ptr<AudioStreamPacket> packet;
+        while (send_queue.Pop(packet)) {
+            pool.Release(std::move(packet));
+        }
+    };
+    burst();
+    HeapAllocationScope scope;
+    burst();
+    CHECK(scope.allocations() > 0);
+    CHECK(pool.exhausted_count() > 0);
+}
+
+int main() {
+    RUN_TEST(TestRecycles);
+    RUN_TEST(TestExhaustion);
+    RUN_TEST(TestSteadyStateHasNoAllocations);
+    RUN_TEST(TestUndersizedPoolAllocates);
+    return HostTestResult();
+}
@@ -0,0 +1,104 @@
+/*
+ * AudioQueue against the std::deque + std::mutex queue it replaced, in the two ways the
+ * audio tasks use it: push / pop on one task, and a producer and a consumer task handing
+ * frames over through a small queue.
+ */
+#include "audio_queue.h"
+#include "host_test.h"
+
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+struct Frame {
+    uint32_t sequence = 0;
+};
+
+class MutexQueue {
+public:
+    explicit MutexQueue(size_t capacity) : capacity_(capacity) {}
+
+    bool Push(std::unique_ptr<Frame>&& item) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (queue_.size() >= capacity_) {
+            return false;
+        }
+        queue_.push_back(std::move(item));
+        return true;
+    }
+
+    bool Pop(std::unique_ptr<Frame>& item) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (queue_.empty()) {
+            return false;
+        }
+        item = std::move(queue_.front());
+        queue_.pop_front();
+        return true;
+    }
+
+private:
+    std::mutex mutex_;
+    std::deque<std::unique_ptr<Frame>> queue_;
+    size_t capacity_;
+};
+
+template <typename Queue>
+static double SingleTaskNsPerItem(uint32_t items) {
+    Queue queue(40);
+    auto frame = std::make_unique<Frame>();
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < items; i++) {
+        frame->sequence = i;
+        queue.Push(std::move(frame));
+        queue.Pop(frame);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    CHECK_EQ(frame->sequence, items - 1);
+    return std::chrono::duration<double, std::nano>(elapsed).count() / items;
+}
+
+template <typename Queue>
+static double TwoTaskNsPerItem(uint32_t items) {
+    Queue queue(40);
+    auto start = std::chrono::steady_clock::now();
+    std::thread producer([&queue, items]() {
+        for (uint32_t i = 0; i < items; i++) {
+            auto frame = std::make_unique<Frame>();
+            frame->sequence = i;
+            while (!queue.Push(std::move(frame))) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    uint32_t received = 0;
+    bool in_order = true;
+    std::unique_ptr<Frame> frame;
+    while (received < items) {
+        if (queue.Pop(frame)) {
+            in_order = in_order && frame->sequence == received;
+            received++;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    CHECK(in_order);
+    return std::chrono::duration<double, std::nano>(elapsed).count() / items;
+}
+
+int main() {
+    constexpr uint32_t kItems = 2000000;
+    double ring_single = SingleTaskNsPerItem<AudioQueue<std::unique_ptr<Frame>>>(kItems);
+    double mutex_single = SingleTaskNsPerItem<MutexQueue>(kItems);
+    double ring_two = TwoTaskNsPerItem<AudioQueue<std::unique_ptr<Frame>>>(kItems);
+    double mutex_two = TwoTaskNsPerItem<MutexQueue>(kItems);
+
+    std::printf("%-28s %12s %12s\n", "ns per item", "AudioQueue", "deque+mutex");
+    std::printf("%-28s %12.1f %12.1f\n", "push + pop, one task", ring_single, mutex_single);
+    std::printf("%-28s %12.1f %12.1f\n", "producer -> consumer", ring_two, mutex_two);
+    return HostTestResult();
+}
@@ -0,0 +1,163 @@
+#include "audio_queue.h"
+#include "host_test.h"
+
+#include <memory>
+#include <thread>
+
+static void TestFifoAndCapacity() {
+    // Not a power of two, the ring has 8 slots but only 5 may be used
+    AudioQueue<int> queue(5);
+    CHECK_EQ(queue.capacity(), 5u);
+    for (int round = 0; round < 10; round++) {
+        for (int i = 0; i < 5; i++) {
+            int item = round * 10 + i;
+            CHECK(queue.Push(std::move(item)));
+        }
+        int extra = -1;
+        CHECK(!queue.Push(std::move(extra)));
+        CHECK_EQ(queue.size(), 5u);
+        for (int i = 0; i < 5; i++) {
+            int item = -1;
+            CHECK(queue.Pop(item));
+            CHECK_EQ(item, round * 10 + i);
+        }
+        int item = -1;
+        CHECK(!queue.Pop(item));
+        CHECK(queue.empty());
+    }
+}
+
+static void TestPopReleasesSlot() {
+    AudioQueue<std::shared_ptr<int>> queue(2);
+    auto value = std::make_shared<int>(1);
+    auto copy = value;
+    CHECK(queue.Push(std::move(copy)));
+    std::shared_ptr<int> popped;
+    CHECK(queue.Pop(popped));
+    popped.reset();
+    // The queue must not keep a reference in the slot it popped from
+    CHECK_EQ(value.use_count(), 1);
+}
+
+static void TestRequestClear() {
+    AudioQueue<int> queue(8);
+    for (int i = 0; i < 4; i++) {
+        int item = i;
+        queue.Push(std::move(item));
+    }
+    queue.RequestClear();
+    // Pushed after the request, must survive it
+    for (int i = 4; i < 6; i++) {
+        int item = i;
+        queue.Push(std::move(item));
+    }
+    int item = -1;
+    for (int i = 0; i < 4; i++) {
+        CHECK(queue.PopCleared(item));
+        CHECK_EQ(item, i);
+    }
+    CHECK(!queue.PopCleared(item));
+    CHECK(queue.Pop(item));
+    CHECK_EQ(item, 4);
+    CHECK(queue.Pop(item));
+    CHECK_EQ(item, 5);
+    // A mark that was already passed by Pop() hands nothing back
+    CHECK(!queue.PopCleared(item));
+    int next = 6;
+    queue.Push(std::move(next));
+    CHECK(!queue.PopCleared(item));
+    CHECK(queue.Pop(item));
+    CHECK_EQ(item, 6);
+}
+
+static void TestRequestClearPartlyPopped() {
+    AudioQueue<int> queue(8);
+    for (int i = 0; i < 4; i++) {
+        int item = i;
+        queue.Push(std::move(item));
+    }
+    queue.RequestClear();
+    int item = -1;
+    // The consumer popped one item before it saw the request
+    CHECK(queue.Pop(item));
+    CHECK_EQ(item, 0);
+    for (int i = 1; i < 4; i++) {
+        CHECK(queue.PopCleared(item));
+        CHECK_EQ(item, i);
+    }
+    CHECK(!queue.PopCleared(item));
+    CHECK(queue.empty());
+}
+
+static void TestConcurrentProducerConsumer() {
+    constexpr uint32_t kItems = 1000000;
+    AudioQueue<uint32_t> queue(40);
+    std::thread producer([&queue]() {
+        for (uint32_t i = 0; i < kItems; i++) {
+            uint32_t item = i;
+            while (!queue.Push(std::move(item))) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    uint32_t expected = 0;
+    bool in_order = true;
+    while (expected < kItems) {
+        uint32_t item;
+        if (queue.Pop(item)) {
+            in_order = in_order && item == expected;
+            expected++;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    CHECK(in_order);
+    CHECK(queue.empty());
+}
+
+static void TestConcurrentClear() {
+    // Clears requested by a third task never lose or duplicate an item
+    constexpr uint32_t kItems = 200000;
+    AudioQueue<uint32_t> queue(16);
+    std::atomic<bool> done{false};
+    std::thread producer([&queue]() {
+        for (uint32_t i = 0; i < kItems; i++) {
+            uint32_t item = i;
+            while (!queue.Push(std::move(item))) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    std::thread clearer([&queue, &done]() {
+        while (!done) {
+            queue.RequestClear();
+            std::this_thread::yield();
+        }
+    });
+    uint32_t expected = 0;
+    bool in_order = true;
+    while (expected < kItems) {
+        uint32_t item;
+        if (queue.PopCleared(item) || queue.Pop(item)) {
+            in_order = in_order && item == expected;
+            expected++;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    done = true;
+    producer.join();
+    clearer.join();
+    CHECK(in_order);
+}
+
+int main() {
+    RUN_TEST(TestFifoAndCapacity);
+    RUN_TEST(TestPopReleasesSlot);
+    RUN_TEST(TestRequestClear);
+    RUN_TEST(TestRequestClearPartlyPopped);
+    RUN_TEST(TestConcurrentProducerConsumer);
+    RUN_TEST(TestConcurrentClear);
+    return HostTestResult();
+}
@@ -0,0 +1,189 @@
+/*
+ * AudioService end to end on the host: the WAV codec captures at device speed, the main loop
+ * below plays the protocol side (drains the send queue, feeds server frames to the jitter
+ * buffer one frame duration apart) and the service's own tasks do the rest.
+ *
+ * Reports mic to send queue and decode queue to speaker latency from the service's histograms,
+ * host CPU time per frame of each worker, and heap allocations per frame once warmed up.
+ * Opus is replaced by a PCM passthrough (stubs/opus_encoder.h), so codec cost is not included.
+ *
+ *   audio_service_benchmark [--seconds N] [--speed X] [--frame-duration MS] [--input mic.wav] [--output speaker.wav]
+ */
+#include "audio_service.h"
+#include "wav_audio_codec.h"
+#include "host_clock.h"
+#include "counting_allocator.h"
+#include "host_test.h"
+
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#define SERVER_SAMPLE_RATE 24000
+#define SERVER_FRAME_DURATION_MS 60
+#define MAIN_LOOP_INTERVAL_MS 5
+#define WARMUP_MS 4000
+
+struct Options {
+    int seconds = 12;
+    double speed = 4;
+    int frame_duration = 60;
+    int input_sample_rate = 16000;
+    int output_sample_rate = 24000;
+    std::string input;
+    std::string output;
+};
+
+static bool ParseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string name = argv[i];
+        const char* value = argv[i + 1];
+        if (name == "--seconds") {
+            options.seconds = atoi(value);
+        } else if (name == "--speed") {
+            options.speed = atof(value);
+        } else if (name == "--frame-duration") {
+            options.frame_duration = atoi(value);
+        } else if (name == "--input-rate") {
+            options.input_sample_rate = atoi(value);
+        } else if (name == "--output-rate") {
+            options.output_sample_rate = atoi(value);
+        } else if (name == "--input") {
+            options.input = value;
+        } else if (name == "--output") {
+            options.output = value;
+        } else {
+            return false;
+        }
+    }
+    return (argc % 2) == 1 && options.seconds > 0 && options.speed > 0;
+}
+
+static double AverageMs(const LatencyHistogram& histogram) {
+    return histogram.count > 0 ? histogram.total_us / 1000.0 / histogram.count : 0;
+}
+
+static void PrintLatency(const char* name, const LatencyHistogram& histogram) {
+    std::printf("  %-24s %8u frames  avg %7.2f ms  max %7.2f ms\n", name, (unsigned)histogram.count,
+        AverageMs(histogram), histogram.max_us / 1000.0);
+}
+
+// One server frame of a 330 Hz tone, as the host "Opus" payload (raw PCM)
+static void FillServerFrame(AudioStreamPacket& packet, uint32_t sequence) {
+    int samples = SERVER_SAMPLE_RATE * SERVER_FRAME_DURATION_MS / 1000;
+    packet.payload.resize(samples * sizeof(int16_t));
+    int16_t* pcm = reinterpret_cast<int16_t*>(packet.payload.data());
+    for (int i = 0; i < samples; i++) {
+        uint64_t n = (uint64_t)sequence * samples + i;
+        pcm[i] = (int16_t)(6000 * std::sin(2 * M_PI * 330 * n / SERVER_SAMPLE_RATE));
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        std::fprintf(stderr, "usage: %s [--seconds N] [--speed X] [--frame-duration MS] [--input-rate HZ] "
+            "[--output-rate HZ] [--input mic.wav] [--output speaker.wav]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    HostClockSetSpeed(options.speed);
+
+    WavAudioCodec codec(options.input_sample_rate, options.output_sample_rate);
+    if (!options.input.empty() && !codec.OpenInput(options.input)) {
+        std::fprintf(stderr, "Cannot read %s as 16-bit mono %d Hz WAV\n", options.input.c_str(), options.input_sample_rate);
+        return EXIT_FAILURE;
+    }
+    if (!options.output.empty() && !codec.OpenOutput(options.output)) {
+        std::fprintf(stderr, "Cannot write %s\n", options.output.c_str());
+        return EXIT_FAILURE;
+    }
+
+    AudioService service;
+    service.Initialize(&codec);
+    service.SetFrameDuration(options.frame_duration);
+    service.Start();
+    service.EnableVoiceProcessing(true);
+
+    const int64_t start_us = esp_timer_get_time();
+    const int64_t end_us = start_us + (int64_t)options.seconds * 1000000;
+    int64_t next_server_frame_us = start_us;
+    uint32_t sequence = 1;
+    uint32_t sent_packets = 0;
+    uint64_t sent_bytes = 0;
+    bool measuring = false;
+    std::unique_ptr<HeapAllocationScope> allocations;
+    uint32_t measured_sent_packets = 0;
+    int64_t measure_start_us = 0;
+
+    // The main task: drain the send queue and receive one server frame per frame duration
+    while (true) {
+        int64_t now = esp_timer_get_time();
+        if (now >= end_us) {
+            break;
+        }
+        if (!measuring && now - start_us >= WARMUP_MS * 1000) {
+            service.ResetStatistics();
+            measure_start_us = now;
+            measured_sent_packets = sent_packets;
+            allocations = std::make_unique<HeapAllocationScope>();
+            measuring = true;
+        }
+        while (auto packet = service.PopPacketFromSendQueue()) {
+            sent_packets++;
+            sent_bytes += packet->payload.size();
+            service.RecyclePacket(std::move(packet));
+        }
+        while (next_server_frame_us <= now) {
+            auto packet = service.AcquirePacket();
+            packet->sample_rate = SERVER_SAMPLE_RATE;
+            packet->frame_duration = SERVER_FRAME_DURATION_MS;
+            packet->timestamp = 0;
+            packet->sequence = sequence;
+            FillServerFrame(*packet, sequence++);
+            service.PushPacketToJitterBuffer(std::move(packet));
+            next_server_frame_us += SERVER_FRAME_DURATION_MS * 1000;
+        }
+        std::this_thread::sleep_for(HostClockHostDuration(MAIN_LOOP_INTERVAL_MS * 1000));
+    }
+    uint64_t allocation_count = allocations ? allocations->allocations() : 0;
+    DebugStatistics stats = service.GetDebugStatistics();
+    double measured_s = (esp_timer_get_time() - measure_start_us) / 1e6;
+    uint32_t uplink_packets = sent_packets - measured_sent_packets;
+
+    service.Stop();
+    HostTaskJoinAll();
+
+    uint32_t frames = stats.encode_count + stats.decode_count;
+    std::printf("AudioService on the host, %d s at %.1fx speed, uplink %d ms frames at %d Hz, downlink %d Hz to %d Hz\n",
+        options.seconds, options.speed, options.frame_duration, options.input_sample_rate, SERVER_SAMPLE_RATE,
+        options.output_sample_rate);
+    std::printf("Latency (device time):\n");
+    PrintLatency("capture -> encode", stats.capture_to_encode);
+    PrintLatency("encode -> send", stats.encode_to_send);
+    std::printf("  %-24s %15s  avg %7.2f ms\n", "mic -> send queue", "", AverageMs(stats.capture_to_encode) + AverageMs(stats.encode_to_send));
+    PrintLatency("receive -> decode", stats.receive_to_decode);
+    PrintLatency("decode -> output", stats.decode_to_output);
+    std::printf("  %-24s %15s  avg %7.2f ms\n", "decode queue -> speaker", "", AverageMs(stats.receive_to_decode) + AverageMs(stats.decode_to_output));
+    std::printf("Throughput over %.1f s:\n", measured_s);
+    std::printf("  uplink   %6.1f packets/s, encode %7.1f host us/frame\n", uplink_packets / measured_s,
+        stats.encode_count > 0 ? stats.encode_time_us / options.speed / stats.encode_count : 0.0);
+    std::printf("  downlink %6.1f frames/s,  decode %7.1f host us/frame, mix %7.1f host us/frame\n",
+        stats.decode_count / measured_s,
+        stats.decode_count > 0 ? stats.decode_time_us / options.speed / stats.decode_count : 0.0,
+        stats.playback_count > 0 ? stats.mix_time_us / options.speed / stats.playback_count : 0.0);
+    std::printf("  late mic reads %u, total sent %u packets / %llu bytes\n", (unsigned)codec.late_reads(),
+        (unsigned)sent_packets, (unsigned long long)sent_bytes);
+    std::printf("Heap: %llu allocations in %u frames (%.3f per frame), pool exhausted %u times\n",
+        (unsigned long long)allocation_count, (unsigned)frames, frames > 0 ? (double)allocation_count / frames : 0.0,
+        (unsigned)service.GetPoolExhaustedCount());
+
+    // Both directions keep up with real time and run without the heap once warmed up
+    double expected_uplink = measured_s * 1000 / options.frame_duration;
+    double expected_downlink = measured_s * 1000 / SERVER_FRAME_DURATION_MS;
+    CHECK(uplink_packets >= expected_uplink * 0.9);
+    CHECK(stats.decode_count >= expected_downlink * 0.9);
+    CHECK(stats.playback_count >= expected_downlink * 0.9);
+    CHECK_EQ(allocation_count, 0ull);
+    return HostTestResult();
+}
@@ -0,0 +1,144 @@
+/*
+ * Full-duplex model of the Opus worker layout: one codec task serving both directions (the
+ * former OpusCodecTask) against separate encode and decode tasks.
+ *
+ * Opus does not run on the host, so each frame is a busy loop of a fixed CPU cost, at 1/10
+ * of the real time scale. The device reports the real per-worker cost in the statistics
+ * (encode_time_ms / decode_time_ms) and the real latencies in the capture_to_encode and
+ * receive_to_decode histograms.
+ */
+#include "host_test.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+// 60 ms frames, encode 18 ms and decode 6 ms per frame, all scaled by 1/10
+#define FRAME_PERIOD_US 6000
+#define ENCODE_COST_US 1800
+#define DECODE_COST_US 600
+#define FRAMES 300
+
+struct JobQueue {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<Clock::time_point> jobs;
+    bool closed = false;
+};
+
+static void Spin(int cost_us) {
+    auto end = Clock::now() + std::chrono::microseconds(cost_us);
+    while (Clock::now() < end) {
+    }
+}
+
+static void Produce(JobQueue& queue, int frames, int offset_us, bool paced, JobQueue& wakeup) {
+    auto start = Clock::now() + std::chrono::microseconds(offset_us);
+    for (int i = 0; i < frames; i++) {
+        // A paced frame is due at its period, even if this thread gets to run later
+        auto ready = start + std::chrono::microseconds((int64_t)i * FRAME_PERIOD_US);
+        if (paced) {
+            std::this_thread::sleep_until(ready);
+        } else {
+            ready = Clock::now();
+        }
+        {
+            std::lock_guard<std::mutex> lock(wakeup.mutex);
+            queue.jobs.push_back(ready);
+        }
+        wakeup.cv.notify_all();
+    }
+}
+
+struct Result {
+    std::vector<double> encode_latency_ms;
+    std::vector<double> decode_latency_ms;
+    double seconds = 0;
+};
+
+// One worker per (queue, cost) pair; a worker with two pairs decodes first, like OpusCodecTask did
+static void Worker(JobQueue& wakeup, std::vector<std::pair<JobQueue*, int>> inputs, std::vector<std::vector<double>*> latencies,
+    size_t total) {
+    size_t done = 0;
+    while (done < total) {
+        std::unique_lock<std::mutex> lock(wakeup.mutex);
+        wakeup.cv.wait(lock, [&]() {
+            return std::any_of(inputs.begin(), inputs.end(), [](auto& input) { return !input.first->jobs.empty(); });
+        });
+        for (size_t i = 0; i < inputs.size(); i++) {
+            auto& jobs = inputs[i].first->jobs;
+            if (jobs.empty()) {
+                continue;
+            }
+            auto ready = jobs.front();
+            jobs.pop_front();
+            lock.unlock();
+            Spin(inputs[i].second);
+            latencies[i]->push_back(std::chrono::duration<double, std::milli>(Clock::now() - ready).count());
+            done++;
+            lock.lock();
+        }
+    }
+}
+
+static Result Run(bool split, bool paced) {
+    JobQueue wakeup;
+    JobQueue encode_jobs;
+    JobQueue decode_jobs;
+    Result result;
+    auto start = Clock::now();
+    std::vector<std::thread> threads;
+    if (split) {
+        threads.emplace_back(Worker, std::ref(wakeup), std::vector<std::pair<JobQueue*, int>>{ { &encode_jobs, ENCODE_COST_US } },
+            std::vector<std::vector<double>*>{ &result.encode_latency_ms }, FRAMES);
+        threads.emplace_back(Worker, std::ref(wakeup), std::vector<std::pair<JobQueue*, int>>{ { &decode_jobs, DECODE_COST_US } },
+            std::vector<std::vector<double>*>{ &result.decode_latency_ms }, FRAMES);
+    } else {
+        threads.emplace_back(Worker, std::ref(wakeup),
+            std::vector<std::pair<JobQueue*, int>>{ { &decode_jobs, DECODE_COST_US }, { &encode_jobs, ENCODE_COST_US } },
+            std::vector<std::vector<double>*>{ &result.decode_latency_ms, &result.encode_latency_ms }, FRAMES * 2);
+    }
+    std::thread mic(Produce, std::ref(encode_jobs), FRAMES, 0, paced, std::ref(wakeup));
+    // Downlink frames arrive while the uplink frame of the same period is being encoded
+    std::thread network(Produce, std::ref(decode_jobs), FRAMES, ENCODE_COST_US / 4, paced, std::ref(wakeup));
+    mic.join();
+    network.join();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return result;
+}
+
+static void PrintLatency(const char* name, std::vector<double> latency_ms) {
+    std::sort(latency_ms.begin(), latency_ms.end());
+    double sum = 0;
+    for (double l : latency_ms) {
+        sum += l;
+    }
+    std::printf("  %-8s avg %6.2f ms  p99 %6.2f ms  max %6.2f ms\n", name, sum / latency_ms.size(),
+        latency_ms[latency_ms.size() * 99 / 100], latency_ms.back());
+}
+
+int main() {
+    // On a single core host the split can only interleave the two workers, like on ESP32-C3
+    std::printf("%u hardware threads\n", std::thread::hardware_concurrency());
+    for (bool split : { false, true }) {
+        auto paced = Run(split, true);
+        auto saturated = Run(split, false);
+        CHECK_EQ(paced.encode_latency_ms.size(), (size_t)FRAMES);
+        CHECK_EQ(paced.decode_latency_ms.size(), (size_t)FRAMES);
+        std::printf("%s\n", split ? "Split encode / decode tasks" : "Single codec task");
+        std::printf(" per-frame latency at the real frame rate (1/10 scale):\n");
+        PrintLatency("encode", paced.encode_latency_ms);
+        PrintLatency("decode", paced.decode_latency_ms);
+        std::printf(" full-duplex throughput, both queues full: %.0f frame pairs/s\n", FRAMES / saturated.seconds);
+    }
+    return HostTestResult();
+}
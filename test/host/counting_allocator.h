@@ -0,0 +1,22 @@
+#ifndef COUNTING_ALLOCATOR_H
+#define COUNTING_ALLOCATOR_H
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Global operator new / delete that count heap allocations, linked into the tests that
+ * check a path runs without touching the heap once it is warmed up.
+ */
+uint64_t HeapAllocationCount();
+
+class HeapAllocationScope {
+public:
+    HeapAllocationScope() : start_(HeapAllocationCount()) {}
+    uint64_t allocations() const { return HeapAllocationCount() - start_; }
+
+private:
+    uint64_t start_;
+};
+
+#endif // COUNTING_ALLOCATOR_H
@@ -0,0 +1,66 @@
+/*
+ * Decoder and resampler slots per stream: switching between streams keeps each stream's
+ * state, and ResetState() starts every stream over, resampler history included, so a new
+ * reply never begins with the tail of the previous one.
+ */
+#include "decoder_cache.h"
+#include "host_test.h"
+
+#include <vector>
+
+#define OUTPUT_SAMPLE_RATE 24000
+#define FRAME_MS 60
+
+static std::vector<int16_t> Resample(DecoderSlot& slot, const std::vector<int16_t>& input) {
+    std::vector<int16_t> output(slot.resampler->GetOutputSamples(input.size()));
+    slot.resampler->Process(input.data(), input.size(), output.data());
+    return output;
+}
+
+static bool IsSilent(const std::vector<int16_t>& pcm) {
+    for (int16_t sample : pcm) {
+        if (sample != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void SlotsPerStream() {
+    DecoderCache cache(2, true);
+    cache.SetOutputSampleRate(OUTPUT_SAMPLE_RATE);
+    DecoderSlot& stream = cache.Get(OUTPUT_SAMPLE_RATE, FRAME_MS);
+    DecoderSlot& sound = cache.Get(16000, FRAME_MS);
+    CHECK(stream.resampler == nullptr);
+    CHECK(sound.resampler != nullptr);
+    CHECK(&cache.Get(OUTPUT_SAMPLE_RATE, FRAME_MS) == &stream);
+    CHECK(&cache.Get(16000, FRAME_MS) == &sound);
+    CHECK_EQ(cache.misses(), 2u);
+    CHECK_EQ(cache.hits(), 2u);
+}
+
+static void ResetClearsResamplerHistory() {
+    // 16 kHz has a polyphase bank, 22.05 kHz goes through the fallback resampler
+    for (bool allow_polyphase : {true, false}) {
+        for (int sample_rate : {16000, 22050}) {
+            DecoderCache cache(2, allow_polyphase);
+            cache.SetOutputSampleRate(OUTPUT_SAMPLE_RATE);
+            std::vector<int16_t> loud(sample_rate * FRAME_MS / 1000, 10000);
+            std::vector<int16_t> silence(loud.size(), 0);
+
+            // Without a reset the next block carries on from the loud one
+            CHECK(!IsSilent(Resample(cache.Get(sample_rate, FRAME_MS), loud)));
+            CHECK(!IsSilent(Resample(cache.Get(sample_rate, FRAME_MS), silence)));
+
+            Resample(cache.Get(sample_rate, FRAME_MS), loud);
+            cache.ResetState();
+            CHECK(IsSilent(Resample(cache.Get(sample_rate, FRAME_MS), silence)));
+        }
+    }
+}
+
+int main() {
+    RUN_TEST(SlotsPerStream);
+    RUN_TEST(ResetClearsResamplerHistory);
+    return HostTestResult();
+}
@@ -0,0 +1,141 @@
+/*
+ * Clock drift simulation for the playback drift compensator: one Update() per decoded frame,
+ * like CompensateDrift calls it. The buffer level moves by the difference between the server
+ * clock and the corrected DAC clock, and is reported in whole frames like
+ * GetBufferedStreamMs does.
+ */
+#include "drift_compensator.h"
+#include "host_test.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#define FRAME_MS 60
+#define TARGET_MS (3 * FRAME_MS)
+
+struct DriftSimulation {
+    DriftCompensator compensator;
+    double level_ms = 4 * FRAME_MS;
+    double drift_ppm = 0;
+    int target_ms = TARGET_MS;
+
+    int Buffered() const { return (int)(level_ms / FRAME_MS) * FRAME_MS; }
+
+    void Step() {
+        compensator.Update(Buffered(), target_ms, FRAME_MS);
+        level_ms += FRAME_MS * (drift_ppm - compensator.correction_ppm()) / 1000000;
+    }
+
+    void Run(int seconds) {
+        for (int i = 0; i < seconds * 1000 / FRAME_MS; i++) {
+            Step();
+        }
+    }
+};
+
+static void BurstIsNotTakenAsDrift() {
+    DriftSimulation sim;
+    // The first seconds of the reply arrive at once and play out, then the server paces
+    sim.level_ms = 3000;
+    while (sim.level_ms > 4 * FRAME_MS) {
+        sim.compensator.Update(sim.Buffered(), sim.target_ms, FRAME_MS);
+        CHECK_EQ(sim.compensator.correction_ppm(), 0);
+        CHECK(!sim.compensator.steady());
+        sim.level_ms -= FRAME_MS;
+    }
+    sim.Run(120);
+    CHECK(sim.compensator.steady());
+    // Only the last burst frame counts towards the reference
+    CHECK(std::abs(sim.compensator.drift_ppm()) < 10);
+    CHECK(std::abs(sim.compensator.correction_ppm()) < 10);
+}
+
+static void ConvergesToClockDrift() {
+    for (double drift : {300.0, -300.0, 800.0}) {
+        DriftSimulation sim;
+        sim.drift_ppm = drift;
+        sim.Run(DRIFT_SETTLE_MS / 1000);
+        CHECK(sim.compensator.steady());
+        sim.Run(1200);
+
+        // The level moves in whole frames, so the correction hunts around the drift and the
+        // level swings by a frame or two
+        double min_level = sim.level_ms;
+        double max_level = sim.level_ms;
+        const int frames = 1800 * 1000 / FRAME_MS;
+        for (int i = 0; i < frames; i++) {
+            sim.Step();
+            min_level = std::min(min_level, sim.level_ms);
+            max_level = std::max(max_level, sim.level_ms);
+        }
+        CHECK(sim.compensator.steady());
+        // Without the correction the level would have moved by up to 2.4 seconds
+        CHECK(min_level > 2 * FRAME_MS);
+        CHECK(max_level < 6 * FRAME_MS);
+    }
+}
+
+static void ResetStartsOver() {
+    DriftSimulation sim;
+    sim.drift_ppm = 500;
+    sim.Run(600);
+    CHECK(sim.compensator.drift_ppm() > 300);
+
+    // The next reply starts without the previous reply's correction
+    sim.compensator.Reset();
+    CHECK(!sim.compensator.steady());
+    CHECK_EQ(sim.compensator.drift_ppm(), 0);
+    CHECK_EQ(sim.compensator.correction_ppm(), 0);
+    sim.drift_ppm = 0;
+    for (int i = 0; i < DRIFT_SETTLE_MS / FRAME_MS; i++) {
+        sim.Step();
+        CHECK_EQ(sim.compensator.correction_ppm(), 0);
+    }
+}
+
+static void TargetChangeIsNotDrift() {
+    DriftSimulation sim;
+    sim.Run(10);
+    CHECK(sim.compensator.steady());
+    // The adaptive jitter target moves, the clocks do not
+    for (int target : {FRAME_MS, 2 * FRAME_MS, 8 * FRAME_MS}) {
+        sim.target_ms = target;
+        sim.Run(30);
+        CHECK(sim.compensator.steady());
+        CHECK_EQ(sim.compensator.correction_ppm(), 0);
+    }
+}
+
+static void BacklogPausesCorrection() {
+    DriftSimulation sim;
+    sim.drift_ppm = 300;
+    sim.Run(600);
+    int drift = sim.compensator.drift_ppm();
+    CHECK(drift > 200);
+
+    // The next sentence arrives in one burst and plays out
+    sim.level_ms += 10 * FRAME_MS;
+    while (sim.level_ms > 8 * FRAME_MS) {
+        sim.compensator.Update(sim.Buffered(), sim.target_ms, FRAME_MS);
+        CHECK(!sim.compensator.steady());
+        CHECK_EQ(sim.compensator.correction_ppm(), 0);
+        CHECK_EQ(sim.compensator.drift_ppm(), drift);
+        sim.level_ms -= FRAME_MS;
+    }
+
+    // Carries on with the estimate of this stream
+    sim.level_ms -= 3 * FRAME_MS;
+    sim.Step();
+    CHECK(sim.compensator.steady());
+    CHECK(sim.compensator.correction_ppm() > 200);
+}
+
+int main() {
+    RUN_TEST(BurstIsNotTakenAsDrift);
+    RUN_TEST(ConvergesToClockDrift);
+    RUN_TEST(ResetStartsOver);
+    RUN_TEST(TargetChangeIsNotDrift);
+    RUN_TEST(BacklogPausesCorrection);
+    return HostTestResult();
+}
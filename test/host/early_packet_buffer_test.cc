@@ -0,0 +1,173 @@
+/*
+ * The downlink gate in front of the jitter buffer: packets of a reply are held until the reply
+ * is opened (after the decoder reset), then handed over in arrival order ahead of any later
+ * packet; packets of an earlier reply never get through.
+ */
+#include "early_packet_buffer.h"
+#include "host_test.h"
+
+#include <atomic>
+#include <thread>
+
+#define MAX_AGE_MS 500
+
+static std::unique_ptr<AudioStreamPacket> MakePacket(AudioPool<AudioStreamPacket>& pool, uint32_t sequence, int64_t time_us) {
+    auto packet = pool.Acquire();
+    packet->sequence = sequence;
+    packet->time_us = time_us;
+    return packet;
+}
+
+static void TestHoldUntilOpen() {
+    AudioPool<AudioStreamPacket> pool(16);
+    EarlyPacketBuffer buffer(8, MAX_AGE_MS, pool);
+    for (uint32_t i = 1; i <= 3; i++) {
+        CHECK(buffer.Hold(MakePacket(pool, i, i * 1000), 1));
+    }
+    CHECK(!buffer.IsOpen(1));
+    std::vector<uint32_t> released;
+    size_t rescued = buffer.Open(1, 10000, [&](std::unique_ptr<AudioStreamPacket>&& packet) {
+        released.push_back(packet->sequence);
+        pool.Release(std::move(packet));
+    });
+    CHECK_EQ(rescued, 3u);
+    CHECK((released == std::vector<uint32_t>{ 1, 2, 3 }));
+    CHECK(buffer.IsOpen(1));
+
+    // Once open the packet is left to the caller
+    auto packet = MakePacket(pool, 4, 11000);
+    CHECK(!buffer.Hold(std::move(packet), 1));
+    CHECK(packet != nullptr && packet->sequence == 4);
+    CHECK_EQ(buffer.GetStats().rescued_packets, 3u);
+}
+
+static void TestNewReplyDropsPrevious() {
+    AudioPool<AudioStreamPacket> pool(16);
+    EarlyPacketBuffer buffer(8, MAX_AGE_MS, pool);
+    buffer.Open(1, 0, [](std::unique_ptr<AudioStreamPacket>&&) {});
+    buffer.Close();
+    // The tail of reply 1 after the device stopped speaking, then reply 2 starts
+    CHECK(buffer.Hold(MakePacket(pool, 10, 1000), 1));
+    CHECK(buffer.Hold(MakePacket(pool, 11, 2000), 1));
+    CHECK(buffer.Hold(MakePacket(pool, 20, 3000), 2));
+    CHECK(!buffer.IsOpen(1));
+
+    // A late open of reply 1 must not let reply 2 through without its decoder reset
+    size_t released = 0;
+    auto count = [&](std::unique_ptr<AudioStreamPacket>&& packet) {
+        CHECK_EQ(packet->sequence, 20u);
+        released++;
+        pool.Release(std::move(packet));
+    };
+    CHECK_EQ(buffer.Open(1, 4000, count), 0u);
+    CHECK(!buffer.IsOpen(2));
+    CHECK_EQ(buffer.Open(2, 4000, count), 1u);
+    CHECK_EQ(released, 1u);
+    CHECK_EQ(buffer.GetStats().expired_packets, 2u);
+}
+
+static void TestOpenWithoutPackets() {
+    AudioPool<AudioStreamPacket> pool(4);
+    EarlyPacketBuffer buffer(8, MAX_AGE_MS, pool);
+    CHECK(buffer.Hold(MakePacket(pool, 1, 0), 1));
+    // Reply 2 starts before any of its packets arrived, reply 1 is dropped
+    CHECK_EQ(buffer.Open(2, 1000, [](std::unique_ptr<AudioStreamPacket>&&) {}), 0u);
+    CHECK(buffer.IsOpen(2));
+    auto packet = MakePacket(pool, 2, 2000);
+    CHECK(!buffer.Hold(std::move(packet), 2));
+    pool.Release(std::move(packet));
+}
+
+static void TestAgeAndCapacity() {
+    AudioPool<AudioStreamPacket> pool(32);
+    EarlyPacketBuffer buffer(4, MAX_AGE_MS, pool);
+    for (uint32_t i = 1; i <= 6; i++) {
+        buffer.Hold(MakePacket(pool, i, i * 100000), 1);
+    }
+    // Only the newest four (3 to 6) fit, and at open time only those younger than MAX_AGE_MS play
+    std::vector<uint32_t> released;
+    buffer.Open(1, 6 * 100000 + 250000, [&](std::unique_ptr<AudioStreamPacket>&& packet) {
+        released.push_back(packet->sequence);
+        pool.Release(std::move(packet));
+    });
+    CHECK((released == std::vector<uint32_t>{ 4, 5, 6 }));
+    CHECK_EQ(buffer.GetStats().expired_packets, 3u);
+
+    EarlyPacketBuffer disabled(4, 0, pool);
+    CHECK(disabled.Hold(MakePacket(pool, 1, 0), 1));
+    CHECK_EQ(disabled.GetStats().held_packets, 0u);
+    CHECK_EQ(disabled.Open(1, 0, [](std::unique_ptr<AudioStreamPacket>&&) {}), 0u);
+    auto packet = MakePacket(pool, 2, 0);
+    CHECK(!disabled.Hold(std::move(packet), 1));
+    pool.Release(std::move(packet));
+}
+
+static void TestStreamingUntilFinished() {
+    AudioPool<AudioStreamPacket> pool(16);
+    EarlyPacketBuffer buffer(8, MAX_AGE_MS, pool);
+    auto release = [&](std::unique_ptr<AudioStreamPacket>&& packet) { pool.Release(std::move(packet)); };
+    CHECK(!buffer.IsStreaming());
+    buffer.Open(1, 0, release);
+    CHECK(buffer.IsStreaming());
+    buffer.Finish(1);
+    CHECK(!buffer.IsStreaming());
+
+    // A short reply can be finished before the main task opens it
+    CHECK(buffer.Hold(MakePacket(pool, 1, 1000), 2));
+    buffer.Finish(2);
+    buffer.Open(2, 2000, release);
+    CHECK(buffer.IsOpen(2));
+    CHECK(!buffer.IsStreaming());
+
+    // The next reply streams again, and closing ends it as well
+    buffer.Open(3, 3000, release);
+    CHECK(buffer.IsStreaming());
+    buffer.Close();
+    CHECK(!buffer.IsStreaming());
+}
+
+static void TestOpenWhilePacketsArrive() {
+    // The network task keeps receiving while the main task opens the reply: every packet ends
+    // up in the jitter buffer once, in arrival order, like AudioService::PushIncomingPacket
+    const uint32_t kPackets = 20000;
+    AudioPool<AudioStreamPacket> pool(64);
+    EarlyPacketBuffer buffer(kPackets, 1000000000, pool);
+    std::mutex jitter_mutex;
+    std::vector<uint32_t> jitter_buffer;
+    auto push = [&](std::unique_ptr<AudioStreamPacket>&& packet) {
+        std::lock_guard<std::mutex> lock(jitter_mutex);
+        jitter_buffer.push_back(packet->sequence);
+        pool.Release(std::move(packet));
+    };
+    std::atomic<uint32_t> received{0};
+    std::thread network([&]() {
+        for (uint32_t i = 1; i <= kPackets; i++) {
+            auto packet = MakePacket(pool, i, 0);
+            if (!buffer.Hold(std::move(packet), 1)) {
+                push(std::move(packet));
+            }
+            received = i;
+        }
+    });
+    while (received < kPackets / 2) {
+        std::this_thread::yield();
+    }
+    buffer.Open(1, 0, push);
+    network.join();
+
+    bool in_order = jitter_buffer.size() == kPackets;
+    for (size_t i = 0; in_order && i < jitter_buffer.size(); i++) {
+        in_order = jitter_buffer[i] == i + 1;
+    }
+    CHECK(in_order);
+}
+
+int main() {
+    RUN_TEST(TestHoldUntilOpen);
+    RUN_TEST(TestNewReplyDropsPrevious);
+    RUN_TEST(TestOpenWithoutPackets);
+    RUN_TEST(TestAgeAndCapacity);
+    RUN_TEST(TestStreamingUntilFinished);
+    RUN_TEST(TestOpenWhilePacketsArrive);
+    return HostTestResult();
+}
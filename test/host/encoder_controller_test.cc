@@ -0,0 +1,192 @@
+/*
+ * Opus complexity controller: one window per call, with the encode time expressed as a
+ * share of the audio duration like UpdateEncoderController measures it.
+ */
+#include "encoder_controller.h"
+#include "host_test.h"
+
+#include <algorithm>
+#include <cstring>
+
+#define WINDOW_MS 1000
+
+static EncoderControllerInput Window(int cpu_percent, uint32_t send_queue_ms = 0, uint32_t send_failures = 0) {
+    EncoderControllerInput input;
+    input.audio_ms = WINDOW_MS;
+    input.encode_time_us = cpu_percent * WINDOW_MS * 10;
+    input.send_queue_ms = send_queue_ms;
+    input.send_failures = send_failures;
+    return input;
+}
+
+static void StepsUpWithHeadroomToMaximum() {
+    EncoderController controller(0, 3);
+    CHECK_EQ(controller.complexity(), 0);
+    for (int i = 0; i < 10; i++) {
+        controller.Update(Window(10));
+    }
+    CHECK_EQ(controller.complexity(), 3);
+    CHECK_EQ(controller.step_up_count(), 3u);
+    CHECK_EQ(controller.cpu_load_percent(), 10);
+}
+
+static void StepsDownUnderLoadToMinimum() {
+    EncoderController controller(1, 4);
+    for (int i = 0; i < 3; i++) {
+        controller.Update(Window(0));
+    }
+    CHECK_EQ(controller.complexity(), 4);
+    CHECK(controller.Update(Window(ENCODER_CPU_HIGH_PERCENT)));
+    CHECK_EQ(controller.complexity(), 3);
+    for (int i = 0; i < 10; i++) {
+        controller.Update(Window(80));
+    }
+    CHECK_EQ(controller.complexity(), 1);
+    CHECK_EQ(controller.step_down_count(), 3u);
+}
+
+static void HoldsBetweenThresholds() {
+    EncoderController controller(0, 5);
+    controller.Update(Window(0));
+    CHECK_EQ(controller.complexity(), 1);
+    for (int i = 0; i < 10; i++) {
+        CHECK(!controller.Update(Window(ENCODER_CPU_LOW_PERCENT)));
+        CHECK(!controller.Update(Window(ENCODER_CPU_HIGH_PERCENT - 1)));
+    }
+    CHECK_EQ(controller.complexity(), 1);
+}
+
+static void FixedRangeNeverChanges() {
+    EncoderController fixed(2, 2);
+    EncoderController inverted(3, 0);
+    for (int i = 0; i < 5; i++) {
+        CHECK(!fixed.Update(Window(0)));
+        CHECK(!fixed.Update(Window(90)));
+        CHECK(!inverted.Update(Window(0)));
+        CHECK(!inverted.Update(Window(90)));
+    }
+    CHECK_EQ(fixed.complexity(), 2);
+    CHECK_EQ(inverted.complexity(), 3);
+}
+
+static void EmptyWindowIsIgnored() {
+    EncoderController controller(0, 5);
+    CHECK(!controller.Update(EncoderControllerInput()));
+    CHECK_EQ(controller.complexity(), 0);
+}
+
+static void SendFailuresStepDownAndHoldOff() {
+    EncoderController controller(0, 5);
+    for (int i = 0; i < 5; i++) {
+        controller.Update(Window(0));
+    }
+    CHECK_EQ(controller.complexity(), 5);
+    CHECK(controller.Update(Window(0, 0, 1)));
+    CHECK_EQ(controller.complexity(), 3);
+    CHECK(controller.congested());
+    CHECK(strcmp(controller.last_reason(), "send failures") == 0);
+    // Plenty of CPU headroom, still no step up until the hold has run out
+    for (int i = 0; i < ENCODER_CONGESTION_HOLD_WINDOWS; i++) {
+        CHECK(!controller.Update(Window(0)));
+    }
+    CHECK(!controller.congested());
+    CHECK(controller.Update(Window(0)));
+    CHECK_EQ(controller.complexity(), 4);
+}
+
+static void QueueBetweenThresholdsKeepsCongestion() {
+    EncoderController controller(0, 5);
+    for (int i = 0; i < 5; i++) {
+        controller.Update(Window(0));
+    }
+    CHECK(controller.Update(Window(0, ENCODER_CONGESTED_QUEUE_MS)));
+    CHECK_EQ(controller.complexity(), 3);
+    CHECK(strcmp(controller.last_reason(), "send queue") == 0);
+    // Draining but not short yet: neither a further step down nor the end of the congestion
+    for (int i = 0; i < 20; i++) {
+        CHECK(!controller.Update(Window(0, ENCODER_CLEAR_QUEUE_MS)));
+    }
+    CHECK(controller.congested());
+    CHECK_EQ(controller.complexity(), 3);
+}
+
+/*
+ * Synthetic congestion: the encoder sends a fixed bitrate over a link whose capacity drops
+ * below it for a while and then recovers. The send queue grows, overflows into send
+ * failures, and drains again like AudioService's send queue.
+ */
+static void SyntheticCongestion() {
+    const int MIN_COMPLEXITY = 0;
+    const int MAX_COMPLEXITY = 5;
+    const int BITRATE_KBPS = 16;
+    const int QUEUE_CAPACITY_MS = 2400;
+    const int CPU_PERCENT_PER_LEVEL = 4;
+    EncoderController controller(MIN_COMPLEXITY, MAX_COMPLEXITY);
+
+    int queue_ms = 0;
+    int window = 0;
+    // Queued audio and send failures after one window over a link of the given capacity
+    auto run_window = [&](int link_kbps) {
+        int sent_ms = WINDOW_MS * link_kbps / BITRATE_KBPS;
+        int peak_ms = std::max(queue_ms, queue_ms + WINDOW_MS - sent_ms);
+        uint32_t failures = 0;
+        if (peak_ms > QUEUE_CAPACITY_MS) {
+            failures = (peak_ms - QUEUE_CAPACITY_MS) / 60;
+            peak_ms = QUEUE_CAPACITY_MS;
+        }
+        queue_ms = std::max(0, std::min(peak_ms, queue_ms + WINDOW_MS - sent_ms));
+        controller.Update(Window(controller.complexity() * CPU_PERCENT_PER_LEVEL, peak_ms, failures));
+        window++;
+    };
+
+    // A good link: step up to the maximum, one level per window
+    for (int i = 0; i < 10; i++) {
+        run_window(32);
+    }
+    CHECK_EQ(controller.complexity(), MAX_COMPLEXITY);
+    CHECK(!controller.congested());
+    uint32_t step_downs = controller.step_down_count();
+
+    // The link drops to half the bitrate: the queue grows 500 ms per window and overflows
+    int first_congested_window = -1;
+    for (int i = 0; i < 15; i++) {
+        run_window(BITRATE_KBPS / 2);
+        if (first_congested_window < 0 && controller.congested()) {
+            first_congested_window = window;
+        }
+        if (first_congested_window >= 0) {
+            CHECK(controller.congested());
+        }
+    }
+    CHECK(first_congested_window > 0);
+    CHECK_EQ(controller.complexity(), MIN_COMPLEXITY);
+    CHECK(controller.step_down_count() - step_downs <= (MAX_COMPLEXITY - MIN_COMPLEXITY + 1) / 2);
+
+    // The link recovers, the queue drains; no step up while it is still long
+    int clear_window = -1;
+    for (int i = 0; i < 30; i++) {
+        int before = controller.complexity();
+        run_window(24);
+        if (controller.complexity() > before) {
+            CHECK(queue_ms < ENCODER_CLEAR_QUEUE_MS);
+            if (clear_window < 0) {
+                clear_window = window;
+            }
+        }
+    }
+    CHECK(clear_window > 0);
+    CHECK_EQ(controller.complexity(), MAX_COMPLEXITY);
+    CHECK(!controller.congested());
+}
+
+int main() {
+    RUN_TEST(StepsUpWithHeadroomToMaximum);
+    RUN_TEST(StepsDownUnderLoadToMinimum);
+    RUN_TEST(HoldsBetweenThresholds);
+    RUN_TEST(FixedRangeNeverChanges);
+    RUN_TEST(EmptyWindowIsIgnored);
+    RUN_TEST(SendFailuresStepDownAndHoldOff);
+    RUN_TEST(QueueBetweenThresholdsKeepsCongestion);
+    RUN_TEST(SyntheticCongestion);
+    return HostTestResult();
+}
@@ -0,0 +1,174 @@
+/*
+ * FrameAssembler cutting chunk streams into frames: any chunk / frame size ratio, a frame
+ * size change mid-stream, the single-frame pass-through, Reset(), and no heap use once warm
+ * when the consumer recycles the frame buffers like AudioService does with its task pool.
+ */
+#include "frame_assembler.h"
+#include "counting_allocator.h"
+#include "host_test.h"
+
+#include <random>
+
+static std::vector<int16_t> MakeStream(size_t samples) {
+    std::vector<int16_t> stream(samples);
+    for (size_t i = 0; i < samples; i++) {
+        stream[i] = (int16_t)(i * 7919 + 13);
+    }
+    return stream;
+}
+
+// Pushes the stream in chunks of the given sizes, in turn, and collects every frame
+static std::vector<int16_t> Assemble(FrameAssembler& assembler, const std::vector<int16_t>& stream,
+        const std::vector<size_t>& chunk_sizes, std::vector<size_t>& frame_sizes) {
+    std::vector<int16_t> output;
+    size_t offset = 0;
+    for (size_t i = 0; offset < stream.size(); i++) {
+        size_t size = std::min(chunk_sizes[i % chunk_sizes.size()], stream.size() - offset);
+        assembler.Push(stream.data() + offset, size, [&](std::vector<int16_t>&& frame) {
+            frame_sizes.push_back(frame.size());
+            output.insert(output.end(), frame.begin(), frame.end());
+        });
+        offset += size;
+    }
+    return output;
+}
+
+static void TestChunkFrameRatios() {
+    const size_t frame_sizes[] = { 1, 320, 512, 960, 1440, 4096 };
+    const std::vector<size_t> chunk_patterns[] = { { 512 }, { 960 }, { 1 }, { 160, 7, 2048, 512, 1 }, { 5000 } };
+    auto stream = MakeStream(48000);
+    for (size_t frame_samples : frame_sizes) {
+        for (const auto& chunks : chunk_patterns) {
+            FrameAssembler assembler;
+            assembler.SetFrameSamples(frame_samples);
+            std::vector<size_t> sizes;
+            auto output = Assemble(assembler, stream, chunks, sizes);
+            // Every frame is whole, in order, and only the last partial frame is held back
+            CHECK_EQ(output.size(), stream.size() / frame_samples * frame_samples);
+            CHECK(std::equal(output.begin(), output.end(), stream.begin()));
+            for (size_t size : sizes) {
+                CHECK_EQ(size, frame_samples);
+            }
+        }
+    }
+}
+
+static void TestRandomChunks() {
+    std::mt19937 random(1234);
+    std::uniform_int_distribution<size_t> chunk(1, 3000);
+    std::vector<size_t> chunks(64);
+    for (auto& size : chunks) {
+        size = chunk(random);
+    }
+    auto stream = MakeStream(96000);
+    FrameAssembler assembler;
+    assembler.SetFrameSamples(960);
+    std::vector<size_t> sizes;
+    auto output = Assemble(assembler, stream, chunks, sizes);
+    CHECK_EQ(output.size(), stream.size() / 960 * 960);
+    CHECK(std::equal(output.begin(), output.end(), stream.begin()));
+}
+
+static void TestFrameSizeChange() {
+    // 60 ms frames, then 20 ms, then 40 ms, at 16 kHz, with AFE sized chunks
+    auto stream = MakeStream(16000 * 3);
+    FrameAssembler assembler;
+    std::vector<int16_t> output;
+    std::vector<size_t> sizes;
+    auto collect = [&](std::vector<int16_t>&& frame) {
+        sizes.push_back(frame.size());
+        output.insert(output.end(), frame.begin(), frame.end());
+    };
+    size_t offset = 0;
+    for (size_t frame_samples : { 960, 320, 640 }) {
+        assembler.SetFrameSamples(frame_samples);
+        for (size_t end = offset + 16000; offset + 512 <= end; offset += 512) {
+            assembler.Push(stream.data() + offset, 512, collect);
+        }
+    }
+    // Nothing is lost or repeated across the changes, samples held back join the next frame
+    CHECK(std::equal(output.begin(), output.end(), stream.begin()));
+    CHECK(offset - output.size() < 640);
+    CHECK_EQ(sizes.front(), 960u);
+    CHECK_EQ(sizes.back(), 640u);
+    size_t changes = 0;
+    for (size_t i = 1; i < sizes.size(); i++) {
+        changes += sizes[i] != sizes[i - 1];
+    }
+    CHECK_EQ(changes, 2u);
+}
+
+static void TestSingleFramePassThrough() {
+    FrameAssembler assembler;
+    assembler.SetFrameSamples(960);
+    auto chunk = MakeStream(960);
+    const int16_t* data = chunk.data();
+    const int16_t* received = nullptr;
+    assembler.Push(std::move(chunk), [&](std::vector<int16_t>&& frame) {
+        received = frame.data();
+    });
+    CHECK(received == data);
+
+    // With samples buffered the chunk is framed behind them
+    auto stream = MakeStream(960 * 3);
+    std::vector<int16_t> output;
+    auto collect = [&](std::vector<int16_t>&& frame) {
+        output.insert(output.end(), frame.begin(), frame.end());
+    };
+    assembler.Push(stream.data(), 100, collect);
+    assembler.Push(std::vector<int16_t>(stream.begin() + 100, stream.begin() + 1060), collect);
+    assembler.Push(std::vector<int16_t>(stream.begin() + 1060, stream.begin() + 2880), collect);
+    CHECK(output == stream);
+}
+
+static void TestResetAndZeroFrame() {
+    auto stream = MakeStream(2000);
+    FrameAssembler assembler;
+    size_t frames = 0;
+    auto count = [&](std::vector<int16_t>&& frame) {
+        frames++;
+    };
+    assembler.Push(stream.data(), stream.size(), count);
+    CHECK_EQ(frames, 0u);
+
+    assembler.SetFrameSamples(960);
+    assembler.Push(stream.data(), 900, count);
+    assembler.Reset();
+    std::vector<int16_t> output;
+    assembler.Push(stream.data() + 900, 960, [&](std::vector<int16_t>&& frame) {
+        output = frame;
+    });
+    CHECK(std::equal(output.begin(), output.end(), stream.begin() + 900) && output.size() == 960);
+}
+
+static void TestNoAllocationWhenRecycled() {
+    auto stream = MakeStream(512 * 1000);
+    FrameAssembler assembler;
+    assembler.SetFrameSamples(960);
+    // The consumer keeps one buffer and swaps it with every frame, as the encode task pool does
+    std::vector<int16_t> pooled(960);
+    int64_t checksum = 0;
+    auto consume = [&](std::vector<int16_t>&& frame) {
+        pooled.swap(frame);
+        checksum += pooled[0];
+    };
+    for (size_t offset = 0; offset < 512 * 20; offset += 512) {
+        assembler.Push(stream.data() + offset, 512, consume);
+    }
+    HeapAllocationScope allocations;
+    for (size_t offset = 512 * 20; offset < stream.size(); offset += 512) {
+        assembler.Push(stream.data() + offset, 512, consume);
+    }
+    CHECK_EQ(allocations.allocations(), 0ull);
+    CHECK(checksum != 0);
+}
+
+int main() {
+    RUN_TEST(TestChunkFrameRatios);
+    RUN_TEST(TestRandomChunks);
+    RUN_TEST(TestFrameSizeChange);
+    RUN_TEST(TestSingleFramePassThrough);
+    RUN_TEST(TestResetAndZeroFrame);
+    RUN_TEST(TestNoAllocationWhenRecycled);
+    return HostTestResult();
+}
@@ -0,0 +1,95 @@
+/*
+ * Cost of the uplink frame duration (20 / 40 / 60 ms) on the host AudioService: packets per
+ * second, per-packet transport headers, process CPU per second of audio (all audio tasks,
+ * wakeups included) and the capture to send queue latency.
+ *
+ * The Opus shim is a PCM passthrough, so the encoder's own per-frame cost is not included;
+ * on the device a 20 ms frame also costs some Opus efficiency at the same bitrate.
+ */
+#include "audio_service.h"
+#include "wav_audio_codec.h"
+#include "host_clock.h"
+#include "host_test.h"
+
+#include <ctime>
+#include <thread>
+
+#define SPEED 8
+#define WARMUP_MS 2000
+#define MEASURE_MS 6000
+#define MAIN_LOOP_INTERVAL_MS 5
+
+// Bytes on the wire per packet besides the Opus payload
+#define WEBSOCKET_PACKET_OVERHEAD (4 + 8 + 40)  // BinaryProtocol3, masked WebSocket frame, TCP / IPv4
+#define MQTT_UDP_PACKET_OVERHEAD (16 + 28)      // AES-CTR nonce, UDP / IPv4
+
+struct DurationResult {
+    double packets_per_second = 0;
+    double cpu_ms_per_second = 0;
+    double capture_to_send_ms = 0;
+};
+
+static double ProcessCpuMs() {
+    timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static double AverageMs(const LatencyHistogram& histogram) {
+    return histogram.count > 0 ? histogram.total_us / 1000.0 / histogram.count : 0;
+}
+
+static DurationResult RunUplink(int frame_duration) {
+    WavAudioCodec codec(16000, 24000);
+    AudioService service;
+    service.Initialize(&codec);
+    service.SetFrameDuration(frame_duration);
+    service.Start();
+    service.EnableVoiceProcessing(true);
+
+    int64_t start_us = esp_timer_get_time();
+    int64_t measure_us = start_us + WARMUP_MS * 1000;
+    int64_t end_us = measure_us + MEASURE_MS * 1000;
+    uint32_t packets = 0;
+    double cpu_start_ms = 0;
+    bool measuring = false;
+    while (esp_timer_get_time() < end_us) {
+        if (!measuring && esp_timer_get_time() >= measure_us) {
+            service.ResetStatistics();
+            cpu_start_ms = ProcessCpuMs();
+            measuring = true;
+        }
+        while (auto packet = service.PopPacketFromSendQueue()) {
+            packets += measuring ? 1 : 0;
+            service.RecyclePacket(std::move(packet));
+        }
+        std::this_thread::sleep_for(HostClockHostDuration(MAIN_LOOP_INTERVAL_MS * 1000));
+    }
+    double cpu_ms = ProcessCpuMs() - cpu_start_ms;
+    DebugStatistics stats = service.GetDebugStatistics();
+    service.Stop();
+    HostTaskJoinAll();
+
+    DurationResult result;
+    double seconds = MEASURE_MS / 1000.0;
+    result.packets_per_second = packets / seconds;
+    // Host CPU while playing MEASURE_MS of device audio
+    result.cpu_ms_per_second = cpu_ms / seconds;
+    result.capture_to_send_ms = AverageMs(stats.capture_to_encode) + AverageMs(stats.encode_to_send);
+    return result;
+}
+
+int main() {
+    HostClockSetSpeed(SPEED);
+    std::printf("%-10s %12s %18s %18s %16s %18s\n", "frame", "packets/s", "ws overhead B/s", "udp overhead B/s",
+        "cpu ms/audio s", "capture->send ms");
+    for (int frame_duration : {20, 40, 60}) {
+        auto result = RunUplink(frame_duration);
+        std::printf("%-10d %12.1f %18.0f %18.0f %16.2f %18.2f\n", frame_duration, result.packets_per_second,
+            result.packets_per_second * WEBSOCKET_PACKET_OVERHEAD, result.packets_per_second * MQTT_UDP_PACKET_OVERHEAD,
+            result.cpu_ms_per_second, result.capture_to_send_ms);
+        double expected = 1000.0 / frame_duration;
+        CHECK(result.packets_per_second >= expected * 0.95 && result.packets_per_second <= expected * 1.05);
+    }
+    return HostTestResult();
+}
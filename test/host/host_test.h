@@ -0,0 +1,43 @@
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include <cstdio>
+#include <cstdlib>
+
+/*
+ * Minimal checks for the host tests, a failed check is reported and the test
+ * keeps running so one run shows every failure.
+ */
+inline int& HostTestFailures() {
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            HostTestFailures()++; \
+        } \
+    } while (0)
+
+#define CHECK_EQ(a, b) do { \
+        auto _a = (a); \
+        auto _b = (b); \
+        if (!(_a == _b)) { \
+            std::fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", __FILE__, __LINE__, #a, #b, \
+                (long long)_a, (long long)_b); \
+            HostTestFailures()++; \
+        } \
+    } while (0)
+
+#define RUN_TEST(test) do { \
+        int _before = HostTestFailures(); \
+        test(); \
+        std::printf("%s %s\n", HostTestFailures() == _before ? "[PASS]" : "[FAIL]", #test); \
+    } while (0)
+
+inline int HostTestResult() {
+    return HostTestFailures() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+#endif // HOST_TEST_H
@@ -0,0 +1,214 @@
+/*
+ * Loss and jitter simulation for the downlink jitter buffer: a sender emits one frame per
+ * frame duration, the network drops or delays each of them, and the decode side pops one
+ * frame per frame duration once playback has started, like OpusDecodeTask does.
+ */
+#include "jitter_buffer.h"
+#include "host_test.h"
+
+#include <algorithm>
+#include <random>
+
+#define FRAME_MS 60
+
+struct NetworkProfile {
+    double loss = 0;
+    int base_delay_ms = 20;
+    int jitter_ms = 0;
+};
+
+struct SimulationResult {
+    uint32_t lost = 0;
+    uint32_t played = 0;
+    uint32_t concealed = 0;
+    uint32_t out_of_order = 0;
+    size_t max_target_depth = 0;
+    JitterBufferStats stats;
+
+    bool operator==(const SimulationResult& other) const {
+        return lost == other.lost && played == other.played && concealed == other.concealed &&
+            out_of_order == other.out_of_order && max_target_depth == other.max_target_depth &&
+            stats.late_packets == other.stats.late_packets && stats.dropped_packets == other.stats.dropped_packets &&
+            stats.underruns == other.stats.underruns;
+    }
+};
+
+struct Arrival {
+    int64_t time_ms;
+    uint32_t sequence;
+};
+
+static SimulationResult Simulate(uint32_t first_sequence, int frames, const NetworkProfile& network, uint32_t seed,
+    bool sequenced = true) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> chance(0, 1);
+    std::uniform_int_distribution<int> jitter(0, network.jitter_ms);
+
+    SimulationResult result;
+    std::vector<Arrival> arrivals;
+    for (int i = 0; i < frames; i++) {
+        if (chance(rng) < network.loss) {
+            result.lost++;
+            continue;
+        }
+        arrivals.push_back({ (int64_t)i * FRAME_MS + network.base_delay_ms + jitter(rng), first_sequence + (uint32_t)i });
+    }
+    std::stable_sort(arrivals.begin(), arrivals.end(), [](const Arrival& a, const Arrival& b) {
+        return a.time_ms < b.time_ms;
+    });
+
+    AudioPool<AudioStreamPacket> pool(64);
+    JitterBuffer jitter_buffer(40, pool);
+    size_t next_arrival = 0;
+    int64_t next_play_ms = 0;
+    uint32_t expected = first_sequence;
+    int64_t end_ms = (int64_t)(frames + 20) * FRAME_MS + network.jitter_ms;
+    for (int64_t now_ms = 0; now_ms < end_ms; now_ms++) {
+        while (next_arrival < arrivals.size() && arrivals[next_arrival].time_ms <= now_ms) {
+            auto packet = pool.Acquire();
+            packet->sequence = sequenced ? arrivals[next_arrival].sequence : 0;
+            packet->frame_duration = FRAME_MS;
+            jitter_buffer.Push(std::move(packet), now_ms);
+            next_arrival++;
+            if (next_arrival == arrivals.size()) {
+                // "tts stop" follows the last frame
+                jitter_buffer.Finish();
+            }
+        }
+        result.max_target_depth = std::max(result.max_target_depth, jitter_buffer.GetStats().target_depth);
+        if (now_ms < next_play_ms) {
+            continue;
+        }
+        std::unique_ptr<AudioStreamPacket> packet;
+        switch (jitter_buffer.Pop(packet, now_ms)) {
+        case kJitterBufferPacket:
+            if (sequenced && packet->sequence != expected) {
+                result.out_of_order++;
+            }
+            expected = (sequenced ? packet->sequence : expected) + 1;
+            result.played++;
+            pool.Release(std::move(packet));
+            next_play_ms = now_ms + FRAME_MS;
+            break;
+        case kJitterBufferConceal:
+            expected++;
+            result.concealed++;
+            next_play_ms = now_ms + FRAME_MS;
+            break;
+        default:
+            break;
+        }
+    }
+    result.stats = jitter_buffer.GetStats();
+    return result;
+}
+
+static void TestCleanNetwork() {
+    auto result = Simulate(1, 1000, NetworkProfile(), 1);
+    CHECK_EQ(result.played, 1000u);
+    CHECK_EQ(result.concealed, 0u);
+    CHECK_EQ(result.out_of_order, 0u);
+    CHECK_EQ(result.stats.late_packets, 0u);
+    CHECK_EQ(result.stats.underruns, 0u);
+    CHECK_EQ(result.max_target_depth, (size_t)JITTER_BUFFER_MIN_DEPTH);
+}
+
+static void TestLossIsConcealed() {
+    NetworkProfile network;
+    network.loss = 0.05;
+    auto result = Simulate(1, 2000, network, 2);
+    CHECK(result.lost > 50);
+    CHECK_EQ(result.played, 2000u - result.lost);
+    // Every lost frame in the middle of the stream is concealed, a loss at the very end is not
+    CHECK(result.concealed <= result.lost);
+    CHECK(result.concealed + 2 >= result.lost);
+    CHECK_EQ(result.out_of_order, 0u);
+}
+
+static void TestJitterRaisesTargetDepth() {
+    NetworkProfile network;
+    network.jitter_ms = 150;
+    auto result = Simulate(1, 2000, network, 3);
+    CHECK(result.max_target_depth > JITTER_BUFFER_MIN_DEPTH);
+    CHECK_EQ(result.out_of_order, 0u);
+    // Reordered packets are put back in order, only a few arrive after their frame was concealed
+    CHECK(result.played >= 2000u * 97 / 100);
+    CHECK_EQ(result.played + result.stats.late_packets + result.stats.dropped_packets, 2000u);
+}
+
+static void TestSequenceWrap() {
+    // The same network run across the 2^32 wrap behaves exactly like one that does not wrap
+    NetworkProfile network;
+    network.loss = 0.03;
+    network.jitter_ms = 100;
+    auto reference = Simulate(1000, 400, network, 4);
+    auto wrapped = Simulate(0xFFFFFFFFu - 150, 400, network, 4);
+    CHECK(reference == wrapped);
+    CHECK_EQ(wrapped.out_of_order, 0u);
+    CHECK(wrapped.played > 300);
+}
+
+static void TestArrivalOrderTransport() {
+    // TCP transports have no sequence number, the frames play in arrival order
+    NetworkProfile network;
+    network.jitter_ms = 40;
+    auto result = Simulate(1, 500, network, 5, false);
+    CHECK_EQ(result.played, 500u);
+    CHECK_EQ(result.concealed, 0u);
+}
+
+static int PlayOut(AudioPool<AudioStreamPacket>& pool, JitterBuffer& jitter_buffer, int64_t& now_ms) {
+    int played = 0;
+    std::unique_ptr<AudioStreamPacket> packet;
+    JitterBufferResult result;
+    while ((result = jitter_buffer.Pop(packet, now_ms)) != kJitterBufferEmpty) {
+        if (result == kJitterBufferPacket) {
+            pool.Release(std::move(packet));
+            played++;
+        }
+        now_ms += FRAME_MS;
+    }
+    return played;
+}
+
+static void TestEndOfStreamIsNotAnUnderrun() {
+    AudioPool<AudioStreamPacket> pool(16);
+    JitterBuffer jitter_buffer(8, pool);
+    int64_t now_ms = 0;
+    uint32_t sequence = 1;
+    auto push = [&](int count) {
+        for (int i = 0; i < count; i++) {
+            auto packet = pool.Acquire();
+            packet->sequence = sequence++;
+            packet->frame_duration = FRAME_MS;
+            jitter_buffer.Push(std::move(packet), now_ms);
+        }
+    };
+
+    // Running empty in the middle of a stream is an underrun
+    push(3);
+    CHECK_EQ(PlayOut(pool, jitter_buffer, now_ms), 3);
+    CHECK_EQ(jitter_buffer.GetStats().underruns, 1u);
+
+    // Running empty after the sender finished is the end of the stream
+    push(3);
+    jitter_buffer.Finish();
+    CHECK_EQ(PlayOut(pool, jitter_buffer, now_ms), 3);
+    CHECK_EQ(jitter_buffer.GetStats().underruns, 1u);
+
+    // The next stream starts with a reset, its stalls count again
+    jitter_buffer.Reset();
+    push(3);
+    CHECK_EQ(PlayOut(pool, jitter_buffer, now_ms), 3);
+    CHECK_EQ(jitter_buffer.GetStats().underruns, 2u);
+}
+
+int main() {
+    RUN_TEST(TestCleanNetwork);
+    RUN_TEST(TestLossIsConcealed);
+    RUN_TEST(TestJitterRaisesTargetDepth);
+    RUN_TEST(TestSequenceWrap);
+    RUN_TEST(TestArrivalOrderTransport);
+    RUN_TEST(TestEndOfStreamIsNotAnUnderrun);
+    return HostTestResult();
+}
@@ -0,0 +1,131 @@
+/*
+ * A notification sound played while the server speech is playing: with PSRAM the decode task
+ * decodes it and the output task mixes it over the ducked speech, without PSRAM it goes
+ * through the decode queue and replaces the speech while it plays.
+ *
+ * The Opus shim is a PCM passthrough, so the speech and the sound are constant levels and
+ * the speaker output shows which of them were playing.
+ */
+#include "audio_service.h"
+#include "wav_audio_codec.h"
+#include "host_clock.h"
+#include "host_test.h"
+#include "ogg_test_data.h"
+
+#include <esp_heap_caps.h>
+
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+#define SPEED 4
+#define OUTPUT_SAMPLE_RATE 24000
+#define SPEECH_LEVEL 2000
+#define SOUND_LEVEL 6000
+#define SOUND_SAMPLE_RATE 16000
+#define SOUND_PACKETS 5
+#define SPEECH_MS 3000
+#define SPEECH_LEAD_FRAMES 3
+#define SOUND_AT_MS 1000
+#define MAIN_LOOP_INTERVAL_MS 5
+
+struct SpeakerLevels {
+    size_t speech = 0;      // Samples at the speech level
+    size_t sound = 0;       // Samples at the sound level
+    size_t mixed = 0;       // Samples above the speech level that are not the sound alone
+};
+
+static std::string MakeToneSound() {
+    std::vector<int16_t> frame(SOUND_SAMPLE_RATE * SOUND_FRAME_DURATION_MS / 1000, SOUND_LEVEL);
+    std::string packet(reinterpret_cast<const char*>(frame.data()), frame.size() * sizeof(int16_t));
+    return MakeOgg(SOUND_SAMPLE_RATE, std::vector<std::string>(SOUND_PACKETS, packet));
+}
+
+// Plays SPEECH_MS of speech with the sound requested SOUND_AT_MS into it, the speaker output goes to `path`
+static void PlaySoundOverSpeech(const std::string& ogg, const std::string& path) {
+    WavAudioCodec codec(16000, OUTPUT_SAMPLE_RATE);
+    codec.SetInputTone(0, 0);
+    codec.OpenOutput(path);
+    AudioService service;
+    service.Initialize(&codec);
+    service.Start();
+
+    int64_t start_us = esp_timer_get_time();
+    // The server keeps a few frames ahead, so the speech is queued when the sound is requested
+    int64_t next_frame_us = start_us - SPEECH_LEAD_FRAMES * SOUND_FRAME_DURATION_MS * 1000;
+    uint32_t sequence = 1;
+    bool sound_played = false;
+    std::vector<int16_t> speech(OUTPUT_SAMPLE_RATE * SOUND_FRAME_DURATION_MS / 1000, SPEECH_LEVEL);
+    while (true) {
+        int64_t now = esp_timer_get_time();
+        if (now - start_us >= (SPEECH_MS + 1000) * 1000) {
+            break;
+        }
+        while (next_frame_us <= now && next_frame_us - start_us < SPEECH_MS * 1000) {
+            auto packet = service.AcquirePacket();
+            packet->sample_rate = OUTPUT_SAMPLE_RATE;
+            packet->frame_duration = SOUND_FRAME_DURATION_MS;
+            packet->timestamp = 0;
+            packet->sequence = sequence++;
+            auto bytes = reinterpret_cast<const uint8_t*>(speech.data());
+            packet->payload.assign(bytes, bytes + speech.size() * sizeof(int16_t));
+            service.PushPacketToJitterBuffer(std::move(packet));
+            next_frame_us += SOUND_FRAME_DURATION_MS * 1000;
+        }
+        if (!sound_played && now - start_us >= SOUND_AT_MS * 1000) {
+            service.PlaySound(ogg);
+            sound_played = true;
+        }
+        std::this_thread::sleep_for(HostClockHostDuration(MAIN_LOOP_INTERVAL_MS * 1000));
+    }
+    service.Stop();
+    HostTaskJoinAll();
+}
+
+static SpeakerLevels MeasureSpeaker(const std::string& ogg) {
+    std::string path = "notification_sound_test_" + std::to_string(getpid()) + ".wav";
+    PlaySoundOverSpeech(ogg, path);
+
+    SpeakerLevels levels;
+    FILE* file = std::fopen(path.c_str(), "rb");
+    CHECK(file != nullptr);
+    if (file == nullptr) {
+        return levels;
+    }
+    std::fseek(file, 44, SEEK_SET);
+    int16_t sample;
+    while (std::fread(&sample, sizeof(sample), 1, file) == 1) {
+        if (sample == SPEECH_LEVEL) {
+            levels.speech++;
+        } else if (sample >= SOUND_LEVEL - 1 && sample <= SOUND_LEVEL + 1) {
+            levels.sound++;
+        } else if (sample > SPEECH_LEVEL) {
+            levels.mixed++;
+        }
+    }
+    std::fclose(file);
+    std::remove(path.c_str());
+    return levels;
+}
+
+int main() {
+    HostClockSetSpeed(SPEED);
+    std::string ogg = MakeToneSound();
+    size_t sound_samples = SOUND_PACKETS * OUTPUT_SAMPLE_RATE * SOUND_FRAME_DURATION_MS / 1000;
+
+    SpeakerLevels with_psram = MeasureSpeaker(ogg);
+    std::printf("With PSRAM:    speech %zu, sound %zu, mixed %zu samples\n", with_psram.speech, with_psram.sound, with_psram.mixed);
+    CHECK(with_psram.mixed >= sound_samples * 9 / 10);
+    CHECK(with_psram.sound < sound_samples / 10);
+
+    HostHeapSetPsramSize(0);
+    SpeakerLevels without_psram = MeasureSpeaker(ogg);
+    std::printf("Without PSRAM: speech %zu, sound %zu, mixed %zu samples\n", without_psram.speech, without_psram.sound, without_psram.mixed);
+    CHECK(without_psram.sound >= sound_samples * 9 / 10);
+    CHECK(without_psram.mixed < sound_samples / 10);
+    // Both ways every frame of speech is still played
+    CHECK(with_psram.speech >= (size_t)OUTPUT_SAMPLE_RATE * (SPEECH_MS - SOUND_PACKETS * SOUND_FRAME_DURATION_MS) / 1000 * 9 / 10);
+    CHECK(without_psram.speech >= (size_t)OUTPUT_SAMPLE_RATE * (SPEECH_MS - SOUND_PACKETS * SOUND_FRAME_DURATION_MS) / 1000 * 9 / 10);
+    return HostTestResult();
+}
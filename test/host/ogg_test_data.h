@@ -0,0 +1,49 @@
+#ifndef OGG_TEST_DATA_H
+#define OGG_TEST_DATA_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+ * Minimal Ogg Opus streams for the host tests: OpusHead, OpusTags and the given packets,
+ * each on its own page. Page CRCs are left at zero, nothing in the firmware checks them.
+ */
+inline void AppendOggPage(std::string& ogg, const std::vector<std::string>& packets) {
+    std::string page("OggS", 4);
+    page.append(22, '\0');
+    std::string lacing;
+    std::string body;
+    for (const auto& packet : packets) {
+        size_t left = packet.size();
+        while (true) {
+            uint8_t size = left >= 255 ? 255 : left;
+            lacing.push_back((char)size);
+            left -= size;
+            if (size < 255) {
+                break;
+            }
+        }
+        body += packet;
+    }
+    page.push_back((char)lacing.size());
+    ogg += page + lacing + body;
+}
+
+inline std::string MakeOgg(int sample_rate, const std::vector<std::string>& packets) {
+    std::string head("OpusHead", 8);
+    head.push_back(1);
+    head.push_back(1);
+    head.append(2, '\0');
+    for (int i = 0; i < 4; i++) {
+        head.push_back((char)((sample_rate >> (8 * i)) & 0xff));
+    }
+    head.append(3, '\0');
+    std::string ogg;
+    AppendOggPage(ogg, {head});
+    AppendOggPage(ogg, {std::string("OpusTags", 8)});
+    AppendOggPage(ogg, packets);
+    return ogg;
+}
+
+#endif // OGG_TEST_DATA_H
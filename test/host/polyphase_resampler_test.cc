@@ -0,0 +1,161 @@
+/*
+ * Polyphase resampler for every ratio it has a filter bank for: exact output counts across
+ * odd block sizes, block size independence, unity DC gain, tone quality, alias rejection
+ * when downsampling, in-place processing and Reset().
+ */
+#include "polyphase_resampler.h"
+#include "tone_analysis.h"
+#include "host_test.h"
+
+#include <algorithm>
+#include <cstdio>
+
+struct Ratio {
+    int input_sample_rate;
+    int output_sample_rate;
+};
+
+static const Ratio kRatios[] = {
+    { 16000, 24000 }, { 24000, 16000 }, { 16000, 48000 }, { 24000, 48000 }, { 48000, 16000 }, { 44100, 16000 },
+};
+
+// Blocks of varying length, including single samples and blocks shorter than the filter
+static std::vector<int16_t> ResampleInBlocks(PolyphaseResampler& resampler, const std::vector<int16_t>& input,
+        const std::vector<int>& block_sizes) {
+    std::vector<int16_t> output;
+    std::vector<int16_t> block;
+    size_t offset = 0;
+    for (size_t i = 0; offset < input.size(); i++) {
+        int size = std::min<int>(block_sizes[i % block_sizes.size()], input.size() - offset);
+        int expected = resampler.GetOutputSamples(size);
+        block.resize(expected);
+        int count = resampler.Process(input.data() + offset, size, block.data());
+        CHECK_EQ(count, expected);
+        output.insert(output.end(), block.begin(), block.begin() + count);
+        offset += size;
+    }
+    return output;
+}
+
+static std::vector<int16_t> Resample(const Ratio& ratio, const std::vector<int16_t>& input, int block_samples) {
+    PolyphaseResampler resampler;
+    CHECK(resampler.Configure(ratio.input_sample_rate, ratio.output_sample_rate));
+    return ResampleInBlocks(resampler, input, { block_samples });
+}
+
+static void TestSupportedRatios() {
+    for (const auto& ratio : kRatios) {
+        CHECK(PolyphaseResampler::IsSupported(ratio.input_sample_rate, ratio.output_sample_rate));
+    }
+    PolyphaseResampler resampler;
+    CHECK(!resampler.Configure(16000, 22050));
+    CHECK(!PolyphaseResampler::IsSupported(8000, 16000));
+    CHECK_EQ(resampler.Process(nullptr, 0, nullptr), 0);
+}
+
+static void TestOutputCountAndBlockIndependence() {
+    for (const auto& ratio : kRatios) {
+        auto input = MakeTone(ratio.input_sample_rate, 997, 12000, ratio.input_sample_rate);
+        PolyphaseResampler resampler;
+        CHECK(resampler.Configure(ratio.input_sample_rate, ratio.output_sample_rate));
+        auto odd_blocks = ResampleInBlocks(resampler, input, { 1, 7, 160, 3, 441, 2, 960, 13 });
+        auto one_block = Resample(ratio, input, input.size());
+        // One second of input is exactly one second of output, however it is split
+        CHECK_EQ(odd_blocks.size(), (size_t)ratio.output_sample_rate);
+        CHECK(odd_blocks == one_block);
+    }
+}
+
+static void TestUnityDcGain() {
+    for (const auto& ratio : kRatios) {
+        for (int16_t level : { (int16_t)12345, (int16_t)-32768, (int16_t)32767 }) {
+            std::vector<int16_t> input(ratio.input_sample_rate / 5, level);
+            auto output = Resample(ratio, input, ratio.input_sample_rate / 50);
+            // Past the filter warm-up a constant comes out unchanged
+            size_t settled = output.size() / 2;
+            int mismatches = 0;
+            for (size_t i = settled; i < output.size(); i++) {
+                mismatches += output[i] != level;
+            }
+            CHECK_EQ(mismatches, 0);
+        }
+    }
+}
+
+static void TestToneQuality() {
+    for (const auto& ratio : kRatios) {
+        int nyquist = std::min(ratio.input_sample_rate, ratio.output_sample_rate) / 2;
+        for (double frequency : { 1000.0, 3400.0, 0.8 * nyquist }) {
+            auto input = MakeTone(ratio.input_sample_rate, frequency, 16384, ratio.input_sample_rate / 2);
+            auto output = Resample(ratio, input, ratio.input_sample_rate / 50);
+            size_t skip = output.size() / 10;
+            double snr = ToneSnrDb(output.data() + skip, output.size() - skip, ratio.output_sample_rate, frequency);
+            std::printf("  %5d -> %5d Hz, %6.0f Hz tone: SNR %5.1f dB\n", ratio.input_sample_rate,
+                ratio.output_sample_rate, frequency, snr);
+            // The speech band stays clean, the top of the passband is still well above 8 bits
+            CHECK(snr >= (frequency <= 3400 ? 75 : 25));
+        }
+    }
+}
+
+static void TestAliasRejection() {
+    for (const auto& ratio : kRatios) {
+        if (ratio.output_sample_rate >= ratio.input_sample_rate) {
+            continue;
+        }
+        // Past the transition band, it would fold back to 6 kHz if the filter let it through
+        double frequency = ratio.output_sample_rate / 2 + 2000;
+        auto input = MakeTone(ratio.input_sample_rate, frequency, 32000, ratio.input_sample_rate / 2);
+        auto output = Resample(ratio, input, ratio.input_sample_rate / 50);
+        size_t skip = output.size() / 10;
+        double level = LevelDb(output.data() + skip, output.size() - skip);
+        std::printf("  %5d -> %5d Hz, %6.0f Hz tone: alias %5.1f dB\n", ratio.input_sample_rate,
+            ratio.output_sample_rate, frequency, level);
+        CHECK(level <= -60);
+    }
+}
+
+static void TestInPlaceDownsampling() {
+    for (const auto& ratio : kRatios) {
+        if (ratio.output_sample_rate > ratio.input_sample_rate) {
+            continue;
+        }
+        auto input = MakeTone(ratio.input_sample_rate, 440, 20000, ratio.input_sample_rate / 5);
+        int block = ratio.input_sample_rate / 50;
+        auto expected = Resample(ratio, input, block);
+
+        PolyphaseResampler resampler;
+        resampler.Configure(ratio.input_sample_rate, ratio.output_sample_rate);
+        std::vector<int16_t> output;
+        std::vector<int16_t> buffer;
+        for (size_t offset = 0; offset < input.size(); offset += block) {
+            buffer.assign(input.begin() + offset, input.begin() + offset + block);
+            int count = resampler.Process(buffer.data(), block, buffer.data());
+            output.insert(output.end(), buffer.begin(), buffer.begin() + count);
+        }
+        CHECK(output == expected);
+    }
+}
+
+static void TestResetForgetsHistory() {
+    for (const auto& ratio : kRatios) {
+        auto first = MakeTone(ratio.input_sample_rate, 700, 30000, ratio.input_sample_rate / 10);
+        auto second = MakeTone(ratio.input_sample_rate, 1300, 8000, ratio.input_sample_rate / 10);
+        PolyphaseResampler resampler;
+        resampler.Configure(ratio.input_sample_rate, ratio.output_sample_rate);
+        ResampleInBlocks(resampler, first, { 333 });
+        resampler.Reset();
+        CHECK(ResampleInBlocks(resampler, second, { 160 }) == Resample(ratio, second, 160));
+    }
+}
+
+int main() {
+    RUN_TEST(TestSupportedRatios);
+    RUN_TEST(TestOutputCountAndBlockIndependence);
+    RUN_TEST(TestUnityDcGain);
+    RUN_TEST(TestToneQuality);
+    RUN_TEST(TestAliasRejection);
+    RUN_TEST(TestInPlaceDownsampling);
+    RUN_TEST(TestResetForgetsHistory);
+    return HostTestResult();
+}
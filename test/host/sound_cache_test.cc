@@ -0,0 +1,69 @@
+/*
+ * Ogg Opus packet index: packets are found through the page lacing, and a sound whose
+ * asset data changed under the same address is indexed again without invalidating the
+ * entry a player still holds.
+ */
+#include "sound_cache.h"
+#include "host_test.h"
+#include "ogg_test_data.h"
+
+static std::string MakeSound(int sample_rate, int packet_count) {
+    std::vector<std::string> packets;
+    for (int i = 0; i < packet_count; i++) {
+        packets.push_back(std::string(10 + i * 100, (char)i));
+    }
+    return MakeOgg(sample_rate, packets);
+}
+
+static void IndexesPackets() {
+    SoundCache cache;
+    std::string ogg = MakeSound(24000, 4);
+    auto sound = cache.Get(ogg);
+    CHECK(sound != nullptr);
+    if (!sound) {
+        return;
+    }
+    CHECK_EQ(sound->sample_rate, 24000);
+    CHECK_EQ(sound->packets.size(), 4u);
+    for (size_t i = 0; i < sound->packets.size(); i++) {
+        const auto& ref = sound->packets[i];
+        CHECK_EQ(ref.length, 10 + i * 100);
+        CHECK_EQ((uint8_t)ogg[ref.offset], i);
+    }
+    CHECK(cache.Get(ogg) == sound);
+}
+
+static void RejectsNonOgg() {
+    SoundCache cache;
+    std::string data(100, 'x');
+    CHECK(cache.Get(data) == nullptr);
+    CHECK(cache.Get(std::string_view(data.data(), 10)) == nullptr);
+}
+
+static void ReindexKeepsHeldEntry() {
+    SoundCache cache;
+    std::string ogg = MakeSound(16000, 3);
+    auto old_sound = cache.Get(ogg);
+    CHECK(old_sound != nullptr);
+
+    // Different asset data at the same address: the first page CRC no longer matches
+    const char* address = ogg.data();
+    ogg[22] = 1;
+    CHECK(ogg.data() == address);
+    auto new_sound = cache.Get(ogg);
+    CHECK(new_sound != nullptr && new_sound != old_sound);
+    if (!old_sound || !new_sound) {
+        return;
+    }
+    CHECK_EQ(new_sound->packets.size(), 3u);
+    // The player that fetched the sound before the re-index still reads a valid entry
+    CHECK_EQ(old_sound.use_count(), 1);
+    CHECK_EQ(old_sound->packets.size(), 3u);
+}
+
+int main() {
+    RUN_TEST(IndexesPackets);
+    RUN_TEST(RejectsNonOgg);
+    RUN_TEST(ReindexKeepsHeldEntry);
+    return HostTestResult();
+}
@@ -0,0 +1,106 @@
+/*
+ * Stereo mic + reference input resampled to 16 kHz, the way ReadAudioData does it now
+ * (scratch buffer, SWAR split / merge, in-place polyphase) against the four temporary
+ * vectors and per-sample loops it replaced. Reports time and heap allocations per 30 ms read.
+ */
+#include "audio_interleave.h"
+#include "polyphase_resampler.h"
+#include "counting_allocator.h"
+#include "host_test.h"
+
+#include <chrono>
+#include <vector>
+
+#define READ_MS 30
+
+class StereoInput {
+public:
+    explicit StereoInput(int rate) {
+        mic_.Configure(rate, 16000);
+        reference_.Configure(rate, 16000);
+    }
+
+    void ReadWithTemporaries(std::vector<int16_t>& data) {
+        auto mic_channel = std::vector<int16_t>(data.size() / 2);
+        auto reference_channel = std::vector<int16_t>(data.size() / 2);
+        for (size_t i = 0, j = 0; i < mic_channel.size(); ++i, j += 2) {
+            mic_channel[i] = data[j];
+            reference_channel[i] = data[j + 1];
+        }
+        auto resampled_mic = std::vector<int16_t>(mic_.GetOutputSamples(mic_channel.size()));
+        auto resampled_reference = std::vector<int16_t>(reference_.GetOutputSamples(reference_channel.size()));
+        mic_.Process(mic_channel.data(), mic_channel.size(), resampled_mic.data());
+        reference_.Process(reference_channel.data(), reference_channel.size(), resampled_reference.data());
+        data.resize(resampled_mic.size() + resampled_reference.size());
+        for (size_t i = 0, j = 0; i < resampled_mic.size(); ++i, j += 2) {
+            data[j] = resampled_mic[i];
+            data[j + 1] = resampled_reference[i];
+        }
+    }
+
+    void ReadWithScratch(std::vector<int16_t>& data) {
+        size_t frames = data.size() / 2;
+        size_t resampled_frames = mic_.GetOutputSamples(frames);
+        scratch_.resize(frames * 2);
+        int16_t* mic = scratch_.data();
+        int16_t* reference = mic + frames;
+        DeinterleaveStereo(data.data(), mic, reference, frames);
+        mic_.Process(mic, frames, mic);
+        reference_.Process(reference, frames, reference);
+        data.resize(resampled_frames * 2);
+        InterleaveStereo(mic, reference, data.data(), resampled_frames);
+    }
+
+private:
+    PolyphaseResampler mic_;
+    PolyphaseResampler reference_;
+    std::vector<int16_t> scratch_;
+};
+
+struct ReadCost {
+    double us = 0;
+    double allocations = 0;
+};
+
+template <typename Read>
+static ReadCost Measure(int rate, int reads, Read read) {
+    StereoInput input(rate);
+    const size_t samples = rate * READ_MS / 1000 * 2;
+    std::vector<int16_t> data;
+    data.reserve(samples);
+    // Warm up so the scratch buffer and the resampler history have reached their final size
+    for (int i = 0; i < 4; i++) {
+        data.assign(samples, 0);
+        read(input, data);
+    }
+
+    HeapAllocationScope scope;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < reads; i++) {
+        data.resize(samples);
+        for (size_t j = 0; j < samples; j++) {
+            data[j] = (int16_t)(j * 7 + i);
+        }
+        read(input, data);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    CHECK_EQ(data.size(), (size_t)(16000 * READ_MS / 1000 * 2));
+    return { std::chrono::duration<double, std::micro>(elapsed).count() / reads, (double)scope.allocations() / reads };
+}
+
+int main() {
+    constexpr int kReads = 2000;
+    std::printf("%-10s %14s %14s %14s %14s\n", "rate", "old us/read", "new us/read", "old allocs", "new allocs");
+    for (int rate : {24000, 44100, 48000}) {
+        auto old_cost = Measure(rate, kReads, [](StereoInput& input, std::vector<int16_t>& data) {
+            input.ReadWithTemporaries(data);
+        });
+        auto new_cost = Measure(rate, kReads, [](StereoInput& input, std::vector<int16_t>& data) {
+            input.ReadWithScratch(data);
+        });
+        std::printf("%-10d %14.2f %14.2f %14.1f %14.1f\n", rate, old_cost.us, new_cost.us,
+            old_cost.allocations, new_cost.allocations);
+        CHECK_EQ(new_cost.allocations, 0.0);
+    }
+    return HostTestResult();
+}
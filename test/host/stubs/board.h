@@ -0,0 +1,7 @@
+#ifndef HOST_STUB_BOARD_H
+#define HOST_STUB_BOARD_H
+
+// The audio modules take their codec as a parameter, nothing uses the board singleton on the host
+class AudioCodec;
+
+#endif // HOST_STUB_BOARD_H
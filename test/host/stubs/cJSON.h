@@ -0,0 +1,19 @@
+#ifndef HOST_STUB_CJSON_H
+#define HOST_STUB_CJSON_H
+
+// No JSON on the host: the builders return null and adding to null is a no-op, as in cJSON
+typedef struct cJSON cJSON;
+typedef int cJSON_bool;
+
+cJSON* cJSON_CreateObject();
+cJSON* cJSON_CreateArray();
+cJSON* cJSON_CreateNumber(double number);
+cJSON* cJSON_CreateIntArray(const int* numbers, int count);
+cJSON* cJSON_AddNumberToObject(cJSON* object, const char* name, double number);
+cJSON* cJSON_AddStringToObject(cJSON* object, const char* name, const char* string);
+cJSON* cJSON_AddBoolToObject(cJSON* object, const char* name, cJSON_bool boolean);
+cJSON_bool cJSON_AddItemToObject(cJSON* object, const char* name, cJSON* item);
+cJSON_bool cJSON_AddItemToArray(cJSON* array, cJSON* item);
+void cJSON_Delete(cJSON* item);
+
+#endif // HOST_STUB_CJSON_H
@@ -0,0 +1,30 @@
+#ifndef HOST_STUB_DRIVER_I2S_COMMON_H
+#define HOST_STUB_DRIVER_I2S_COMMON_H
+
+#include <cstddef>
+
+#include "esp_err.h"
+
+// Channel handles stay null on the host, the calls only exist so AudioCodec links
+typedef struct i2s_channel_obj_t* i2s_chan_handle_t;
+
+typedef struct {
+    void* data;
+    size_t size;
+} i2s_event_data_t;
+
+typedef bool (*i2s_isr_callback_t)(i2s_chan_handle_t handle, i2s_event_data_t* event, void* user_ctx);
+
+typedef struct {
+    i2s_isr_callback_t on_recv;
+    i2s_isr_callback_t on_recv_q_ovf;
+    i2s_isr_callback_t on_sent;
+    i2s_isr_callback_t on_send_q_ovf;
+} i2s_event_callbacks_t;
+
+esp_err_t i2s_channel_register_event_callback(i2s_chan_handle_t handle, const i2s_event_callbacks_t* callbacks, void* user_data);
+esp_err_t i2s_channel_enable(i2s_chan_handle_t handle);
+esp_err_t i2s_channel_disable(i2s_chan_handle_t handle);
+esp_err_t i2s_del_channel(i2s_chan_handle_t handle);
+
+#endif // HOST_STUB_DRIVER_I2S_COMMON_H
@@ -0,0 +1,22 @@
+#ifndef HOST_STUB_ESP_ERR_H
+#define HOST_STUB_ESP_ERR_H
+
+#include <cstdio>
+#include <cstdlib>
+
+typedef int esp_err_t;
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_INVALID_STATE 0x103
+
+#define ESP_ERROR_CHECK(x) do { \
+        esp_err_t _err = (x); \
+        if (_err != ESP_OK) { \
+            std::fprintf(stderr, "%s:%d: ESP_ERROR_CHECK(%s) failed: %d\n", __FILE__, __LINE__, #x, _err); \
+            std::abort(); \
+        } \
+    } while (0)
+#define ESP_ERROR_CHECK_WITHOUT_ABORT(x) (x)
+
+#endif // HOST_STUB_ESP_ERR_H
@@ -0,0 +1,18 @@
+#ifndef HOST_STUB_ESP_HEAP_CAPS_H
+#define HOST_STUB_ESP_HEAP_CAPS_H
+
+#include <cstddef>
+
+#define MALLOC_CAP_INTERNAL (1 << 11)
+#define MALLOC_CAP_SPIRAM (1 << 10)
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_DMA (1 << 3)
+
+// Every capability comes from the host heap, by default the free size is the one of a board with 8 MB of PSRAM
+void* heap_caps_malloc(size_t size, unsigned caps);
+void heap_caps_free(void* ptr);
+size_t heap_caps_get_free_size(unsigned caps);
+// Host tests only: 0 gives a board without PSRAM, MALLOC_CAP_SPIRAM allocations then fail
+void HostHeapSetPsramSize(size_t bytes);
+
+#endif // HOST_STUB_ESP_HEAP_CAPS_H
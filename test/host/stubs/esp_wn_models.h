@@ -0,0 +1,8 @@
+#ifndef HOST_STUB_ESP_WN_MODELS_H
+#define HOST_STUB_ESP_WN_MODELS_H
+
+#include "esp_wn_iface.h"
+
+const esp_wn_iface_t* esp_wn_handle_from_name(const char* model_name);
+
+#endif // HOST_STUB_ESP_WN_MODELS_H
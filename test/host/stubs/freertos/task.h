@@ -0,0 +1,20 @@
+#ifndef HOST_STUB_FREERTOS_TASK_H
+#define HOST_STUB_FREERTOS_TASK_H
+
+#include "FreeRTOS.h"
+
+// Tasks are host threads, priorities and core affinity are ignored
+typedef void (*TaskFunction_t)(void*);
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char* name, uint32_t stack_depth, void* arg,
+    UBaseType_t priority, TaskHandle_t* handle);
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, uint32_t stack_depth, void* arg,
+    UBaseType_t priority, TaskHandle_t* handle, BaseType_t core_id);
+// Only a task deleting itself at the end of its function is supported
+void vTaskDelete(TaskHandle_t handle);
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount();
+// Unused stack in bytes, measured on a painted stack like FreeRTOS does (see host_freertos.cc)
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t handle);
+
+#endif // HOST_STUB_FREERTOS_TASK_H
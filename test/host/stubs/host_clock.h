@@ -0,0 +1,28 @@
+#ifndef HOST_CLOCK_H
+#define HOST_CLOCK_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+/*
+ * Device time for the FreeRTOS / esp_timer shims. It runs `speed` times faster than the
+ * host clock, so a benchmark can play minutes of audio in seconds: esp_timer_get_time(),
+ * tick counts, delays, timeouts and the paced test codec all follow it. Set the speed
+ * before any task is started.
+ */
+void HostClockSetSpeed(double speed);
+double HostClockSpeed();
+// Device time since the process started
+int64_t HostClockNowUs();
+// Host time that passes during `device_us` of device time
+std::chrono::steady_clock::duration HostClockHostDuration(int64_t device_us);
+// Host time point at which the device clock reads `device_us`
+std::chrono::steady_clock::time_point HostClockHostTimePoint(int64_t device_us);
+
+// Joins every task created through xTaskCreate*, call once the tasks have been told to stop
+void HostTaskJoinAll();
+// Deepest stack use of the joined tasks with this name, without what the host itself needs per thread
+size_t HostTaskStackUsed(const std::string& name);
+
+#endif // HOST_CLOCK_H
@@ -0,0 +1,371 @@
+/*
+ * FreeRTOS tasks and event groups, esp_timer and the device clock on host threads.
+ */
+#include "host_clock.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/event_groups.h>
+#include <esp_timer.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <pthread.h>
+
+static const auto kHostClockStart = std::chrono::steady_clock::now();
+static double host_clock_speed = 1.0;
+
+void HostClockSetSpeed(double speed) {
+    host_clock_speed = speed;
+}
+
+double HostClockSpeed() {
+    return host_clock_speed;
+}
+
+int64_t HostClockNowUs() {
+    auto elapsed = std::chrono::steady_clock::now() - kHostClockStart;
+    return (int64_t)(std::chrono::duration<double, std::micro>(elapsed).count() * host_clock_speed);
+}
+
+std::chrono::steady_clock::duration HostClockHostDuration(int64_t device_us) {
+    return std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double, std::micro>(device_us / host_clock_speed));
+}
+
+std::chrono::steady_clock::time_point HostClockHostTimePoint(int64_t device_us) {
+    return kHostClockStart + HostClockHostDuration(device_us);
+}
+
+// Tasks
+
+// Host frames are larger than Xtensa / RISC-V ones and glibc keeps the thread's TLS at the top of
+// its stack, so every task gets this much beyond its stack depth. The slack is left out of the
+// reported use by measuring an empty task (see HostTaskBaselineStackUse)
+#define HOST_TASK_STACK_SLACK (64 * 1024)
+#define HOST_TASK_STACK_PAINT 0xA5
+
+// glibc formats into an 8 KB stack buffer when it writes to an unbuffered stream, the ESP-IDF
+// log does not, so the host log is line buffered to keep that buffer out of the task stacks
+static const bool kHostLogBuffered = std::setvbuf(stderr, nullptr, _IOLBF, BUFSIZ) == 0;
+
+struct HostTask {
+    std::string name;
+    uint32_t stack_depth;
+    TaskFunction_t function;
+    void* arg;
+    uint8_t* stack = nullptr;
+    size_t stack_size = 0;
+    pthread_t thread;
+};
+
+static std::mutex tasks_mutex;
+static std::vector<HostTask*> tasks;
+// Largest stack use seen of each task name, kept once the tasks have been joined
+static std::map<std::string, size_t> task_stack_used;
+
+static void* HostTaskEntry(void* arg) {
+    auto task = static_cast<HostTask*>(arg);
+    task->function(task->arg);
+    return nullptr;
+}
+
+static void HostTaskStart(HostTask* task) {
+    task->stack_size = task->stack_depth + HOST_TASK_STACK_SLACK;
+    task->stack = static_cast<uint8_t*>(std::aligned_alloc(4096, task->stack_size));
+    std::memset(task->stack, HOST_TASK_STACK_PAINT, task->stack_size);
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstack(&attr, task->stack, task->stack_size);
+    if (pthread_create(&task->thread, &attr, HostTaskEntry, task) != 0) {
+        std::fprintf(stderr, "Failed to start task %s\n", task->name.c_str());
+        std::abort();
+    }
+    pthread_attr_destroy(&attr);
+}
+
+// The stack grows down, everything below the deepest write still has the paint
+static size_t HostTaskRawStackUse(const HostTask* task) {
+    size_t untouched = 0;
+    while (untouched < task->stack_size && task->stack[untouched] == HOST_TASK_STACK_PAINT) {
+        untouched++;
+    }
+    return task->stack_size - untouched;
+}
+
+// Stack a task that returns right away uses on this host: TLS, thread descriptor, entry frames
+static size_t HostTaskBaselineStackUse() {
+    static size_t baseline = [] {
+        HostTask task{ "baseline", 0, [](void*) {}, nullptr };
+        HostTaskStart(&task);
+        pthread_join(task.thread, nullptr);
+        size_t used = HostTaskRawStackUse(&task);
+        std::free(task.stack);
+        return used;
+    }();
+    return baseline;
+}
+
+static size_t HostTaskStackUse(const HostTask* task) {
+    size_t used = HostTaskRawStackUse(task);
+    size_t baseline = HostTaskBaselineStackUse();
+    return used > baseline ? used - baseline : 0;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char* name, uint32_t stack_depth, void* arg,
+    UBaseType_t priority, TaskHandle_t* handle) {
+    HostTaskBaselineStackUse();
+    auto task = new HostTask{ name, stack_depth, function, arg };
+    {
+        std::lock_guard<std::mutex> lock(tasks_mutex);
+        tasks.push_back(task);
+    }
+    if (handle != nullptr) {
+        *handle = task;
+    }
+    HostTaskStart(task);
+    return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, uint32_t stack_depth, void* arg,
+    UBaseType_t priority, TaskHandle_t* handle, BaseType_t core_id) {
+    return xTaskCreate(function, name, stack_depth, arg, priority, handle);
+}
+
+void vTaskDelete(TaskHandle_t handle) {
+    // The thread ends when the task function returns, which follows right after on every caller
+    if (handle != nullptr) {
+        std::fprintf(stderr, "vTaskDelete of another task is not supported on the host\n");
+        std::abort();
+    }
+}
+
+void vTaskDelay(TickType_t ticks) {
+    std::this_thread::sleep_for(HostClockHostDuration((int64_t)ticks * 1000));
+}
+
+TickType_t xTaskGetTickCount() {
+    return (TickType_t)(HostClockNowUs() / 1000);
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t handle) {
+    if (handle == nullptr) {
+        return 0;
+    }
+    size_t used = HostTaskStackUse(handle);
+    return used < handle->stack_depth ? handle->stack_depth - used : 0;
+}
+
+void HostTaskJoinAll() {
+    std::vector<HostTask*> joined;
+    {
+        std::lock_guard<std::mutex> lock(tasks_mutex);
+        joined.swap(tasks);
+    }
+    for (auto task : joined) {
+        pthread_join(task->thread, nullptr);
+        size_t& used = task_stack_used[task->name];
+        used = std::max(used, HostTaskStackUse(task));
+        std::free(task->stack);
+        delete task;
+    }
+}
+
+size_t HostTaskStackUsed(const std::string& name) {
+    auto it = task_stack_used.find(name);
+    return it != task_stack_used.end() ? it->second : 0;
+}
+
+// Event groups
+
+struct HostEventWaiter {
+    EventBits_t bits;
+    bool wait_for_all;
+    bool clear_on_exit;
+    bool released = false;
+    EventBits_t result = 0;
+};
+
+struct HostEventGroup {
+    std::mutex mutex;
+    std::condition_variable cv;
+    EventBits_t bits = 0;
+    std::vector<HostEventWaiter*> waiters;
+};
+
+static bool Satisfies(EventBits_t bits, const HostEventWaiter& waiter) {
+    return waiter.wait_for_all ? (bits & waiter.bits) == waiter.bits : (bits & waiter.bits) != 0;
+}
+
+EventGroupHandle_t xEventGroupCreate() {
+    auto group = new HostEventGroup();
+    // No allocation while waiting, the audio tasks never have more waiters on one group than this
+    group->waiters.reserve(16);
+    return group;
+}
+
+void vEventGroupDelete(EventGroupHandle_t group) {
+    delete group;
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits) {
+    std::lock_guard<std::mutex> lock(group->mutex);
+    group->bits |= bits;
+    EventBits_t clear = 0;
+    for (auto waiter : group->waiters) {
+        if (!waiter->released && Satisfies(group->bits, *waiter)) {
+            waiter->released = true;
+            waiter->result = group->bits;
+            if (waiter->clear_on_exit) {
+                clear |= waiter->bits;
+            }
+        }
+    }
+    group->bits &= ~clear;
+    group->cv.notify_all();
+    return group->bits;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits) {
+    std::lock_guard<std::mutex> lock(group->mutex);
+    EventBits_t previous = group->bits;
+    group->bits &= ~bits;
+    return previous;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group) {
+    std::lock_guard<std::mutex> lock(group->mutex);
+    return group->bits;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clear_on_exit,
+    BaseType_t wait_for_all, TickType_t ticks) {
+    std::unique_lock<std::mutex> lock(group->mutex);
+    HostEventWaiter waiter{ bits, wait_for_all != pdFALSE, clear_on_exit != pdFALSE };
+    if (Satisfies(group->bits, waiter)) {
+        EventBits_t result = group->bits;
+        if (waiter.clear_on_exit) {
+            group->bits &= ~bits;
+        }
+        return result;
+    }
+    if (ticks == 0) {
+        return group->bits;
+    }
+
+    group->waiters.push_back(&waiter);
+    if (ticks == portMAX_DELAY) {
+        group->cv.wait(lock, [&waiter] { return waiter.released; });
+    } else {
+        auto deadline = std::chrono::steady_clock::now() + HostClockHostDuration((int64_t)ticks * 1000);
+        group->cv.wait_until(lock, deadline, [&waiter] { return waiter.released; });
+    }
+    group->waiters.erase(std::find(group->waiters.begin(), group->waiters.end(), &waiter));
+    return waiter.released ? waiter.result : group->bits;
+}
+
+// esp_timer
+
+struct HostTimer {
+    esp_timer_cb_t callback;
+    void* arg;
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool thread_started = false;
+    bool armed = false;
+    bool periodic = false;
+    int64_t period_us = 0;
+    int64_t next_us = 0;
+};
+
+static void RunTimer(HostTimer* timer) {
+    std::unique_lock<std::mutex> lock(timer->mutex);
+    while (true) {
+        if (!timer->armed) {
+            timer->cv.wait(lock);
+            continue;
+        }
+        int64_t next_us = timer->next_us;
+        timer->cv.wait_until(lock, HostClockHostTimePoint(next_us));
+        if (!timer->armed || timer->next_us != next_us || HostClockNowUs() < next_us) {
+            continue;
+        }
+        if (timer->periodic) {
+            timer->next_us += timer->period_us;
+        } else {
+            timer->armed = false;
+        }
+        // The callback may stop or restart its own timer
+        lock.unlock();
+        timer->callback(timer->arg);
+        lock.lock();
+    }
+}
+
+static esp_err_t StartTimer(esp_timer_handle_t timer, uint64_t period_us, bool periodic) {
+    std::lock_guard<std::mutex> lock(timer->mutex);
+    if (timer->armed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->armed = true;
+    timer->periodic = periodic;
+    timer->period_us = period_us;
+    timer->next_us = HostClockNowUs() + period_us;
+    if (!timer->thread_started) {
+        // Timers are never deleted by the audio service, the thread lives as long as the process
+        std::thread(RunTimer, timer).detach();
+        timer->thread_started = true;
+    }
+    timer->cv.notify_all();
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* handle) {
+    auto timer = new HostTimer();
+    timer->callback = args->callback;
+    timer->arg = args->arg;
+    *handle = timer;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us) {
+    return StartTimer(timer, period_us, true);
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+    return StartTimer(timer, timeout_us, false);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+    std::lock_guard<std::mutex> lock(timer->mutex);
+    if (!timer->armed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->armed = false;
+    timer->cv.notify_all();
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+    {
+        std::lock_guard<std::mutex> lock(timer->mutex);
+        if (timer->armed || timer->thread_started) {
+            // The timer thread still holds it
+            return ESP_ERR_INVALID_STATE;
+        }
+    }
+    delete timer;
+    return ESP_OK;
+}
+
+int64_t esp_timer_get_time() {
+    return HostClockNowUs();
+}
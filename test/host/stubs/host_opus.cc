@@ -0,0 +1,97 @@
+/*
+ * PCM passthrough in place of libopus, see opus_encoder.h.
+ */
+#include <opus_encoder.h>
+#include <opus_decoder.h>
+#include <opus_resampler.h>
+
+#include <algorithm>
+#include <cstring>
+
+OpusEncoderWrapper::OpusEncoderWrapper(int sample_rate, int channels, int duration_ms)
+    : sample_rate_(sample_rate), duration_ms_(duration_ms), frame_size_(sample_rate / 1000 * channels * duration_ms) {
+}
+
+OpusEncoderWrapper::~OpusEncoderWrapper() {
+}
+
+void OpusEncoderWrapper::SetDtx(bool enable) {
+}
+
+void OpusEncoderWrapper::SetComplexity(int complexity) {
+    complexity_ = complexity;
+}
+
+void OpusEncoderWrapper::Encode(std::vector<int16_t>&& pcm, std::function<void(std::vector<uint8_t>&& opus)> handler) {
+    std::vector<uint8_t> opus;
+    if (Encode(std::move(pcm), opus)) {
+        handler(std::move(opus));
+    }
+}
+
+bool OpusEncoderWrapper::Encode(std::vector<int16_t>&& pcm, std::vector<uint8_t>& opus) {
+    if ((int)pcm.size() != frame_size_) {
+        return false;
+    }
+    opus.resize(pcm.size() * sizeof(int16_t));
+    memcpy(opus.data(), pcm.data(), opus.size());
+    return true;
+}
+
+void OpusEncoderWrapper::ResetState() {
+}
+
+OpusDecoderWrapper::OpusDecoderWrapper(int sample_rate, int channels, int duration_ms)
+    : sample_rate_(sample_rate), duration_ms_(duration_ms), frame_size_(sample_rate / 1000 * channels * duration_ms) {
+}
+
+OpusDecoderWrapper::~OpusDecoderWrapper() {
+}
+
+bool OpusDecoderWrapper::Decode(std::vector<uint8_t>&& opus, std::vector<int16_t>& pcm) {
+    if (opus.empty()) {
+        pcm.assign(frame_size_, 0);
+        return true;
+    }
+    if (opus.size() % sizeof(int16_t) != 0) {
+        return false;
+    }
+    pcm.resize(opus.size() / sizeof(int16_t));
+    memcpy(pcm.data(), opus.data(), opus.size());
+    return true;
+}
+
+void OpusDecoderWrapper::ResetState() {
+}
+
+OpusResampler::OpusResampler() {
+}
+
+OpusResampler::~OpusResampler() {
+}
+
+void OpusResampler::Configure(int input_sample_rate, int output_sample_rate) {
+    input_sample_rate_ = input_sample_rate;
+    output_sample_rate_ = output_sample_rate;
+    last_sample_ = 0;
+}
+
+int OpusResampler::GetOutputSamples(int input_samples) const {
+    return input_samples * output_sample_rate_ / input_sample_rate_;
+}
+
+void OpusResampler::Process(const int16_t* input, int input_samples, int16_t* output) {
+    // Output sample i sits at input position (i + 1) * in / out - 1, between the previous block's last sample and input[0] at first
+    int output_samples = GetOutputSamples(input_samples);
+    for (int i = 0; i < output_samples; i++) {
+        int64_t position = (int64_t)(i + 1) * input_sample_rate_;
+        int index = (int)(position / output_sample_rate_) - 1;
+        int fraction = (int)(position % output_sample_rate_);
+        int32_t a = index >= 0 ? input[index] : last_sample_;
+        int32_t b = input[std::min(index + 1, input_samples - 1)];
+        output[i] = (int16_t)(a + (int64_t)(b - a) * fraction / output_sample_rate_);
+    }
+    if (input_samples > 0) {
+        last_sample_ = input[input_samples - 1];
+    }
+}
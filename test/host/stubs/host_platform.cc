@@ -0,0 +1,126 @@
+/*
+ * The remaining ESP-IDF services the audio modules link against: settings, heap
+ * capabilities, speech model lookup, I2S channel calls and cJSON.
+ */
+#include <settings.h>
+#include <esp_heap_caps.h>
+#include <model_path.h>
+#include <esp_wn_models.h>
+#include <driver/i2s_common.h>
+#include <cJSON.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+
+static std::mutex settings_mutex;
+static std::map<std::string, int32_t> settings_values;
+
+Settings::Settings(const std::string& ns, bool read_write) : ns_(ns), read_write_(read_write) {
+}
+
+int32_t Settings::GetInt(const std::string& key, int32_t default_value) {
+    std::lock_guard<std::mutex> lock(settings_mutex);
+    auto it = settings_values.find(ns_ + "." + key);
+    return it != settings_values.end() ? it->second : default_value;
+}
+
+void Settings::SetInt(const std::string& key, int32_t value) {
+    if (!read_write_) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(settings_mutex);
+    settings_values[ns_ + "." + key] = value;
+}
+
+static std::atomic<size_t> psram_size{8 * 1024 * 1024};
+
+void HostHeapSetPsramSize(size_t bytes) {
+    psram_size = bytes;
+}
+
+void* heap_caps_malloc(size_t size, unsigned caps) {
+    if ((caps & MALLOC_CAP_SPIRAM) && psram_size == 0) {
+        return nullptr;
+    }
+    return std::malloc(size);
+}
+
+void heap_caps_free(void* ptr) {
+    std::free(ptr);
+}
+
+size_t heap_caps_get_free_size(unsigned caps) {
+    return (caps & MALLOC_CAP_SPIRAM) ? psram_size.load() : 256 * 1024;
+}
+
+srmodel_list_t* esp_srmodel_init(const char* partition_label) {
+    return nullptr;
+}
+
+void esp_srmodel_deinit(srmodel_list_t* models) {
+}
+
+char* esp_srmodel_filter(srmodel_list_t* models, const char* keyword1, const char* keyword2) {
+    return nullptr;
+}
+
+const esp_wn_iface_t* esp_wn_handle_from_name(const char* model_name) {
+    return nullptr;
+}
+
+esp_err_t i2s_channel_register_event_callback(i2s_chan_handle_t handle, const i2s_event_callbacks_t* callbacks, void* user_data) {
+    return ESP_OK;
+}
+
+esp_err_t i2s_channel_enable(i2s_chan_handle_t handle) {
+    return ESP_OK;
+}
+
+esp_err_t i2s_channel_disable(i2s_chan_handle_t handle) {
+    return ESP_OK;
+}
+
+esp_err_t i2s_del_channel(i2s_chan_handle_t handle) {
+    return ESP_OK;
+}
+
+cJSON* cJSON_CreateObject() {
+    return nullptr;
+}
+
+cJSON* cJSON_CreateArray() {
+    return nullptr;
+}
+
+cJSON* cJSON_CreateNumber(double number) {
+    return nullptr;
+}
+
+cJSON* cJSON_CreateIntArray(const int* numbers, int count) {
+    return nullptr;
+}
+
+cJSON* cJSON_AddNumberToObject(cJSON* object, const char* name, double number) {
+    return nullptr;
+}
+
+cJSON* cJSON_AddStringToObject(cJSON* object, const char* name, const char* string) {
+    return nullptr;
+}
+
+cJSON* cJSON_AddBoolToObject(cJSON* object, const char* name, cJSON_bool boolean) {
+    return nullptr;
+}
+
+cJSON_bool cJSON_AddItemToObject(cJSON* object, const char* name, cJSON* item) {
+    return 0;
+}
+
+cJSON_bool cJSON_AddItemToArray(cJSON* array, cJSON* item) {
+    return 0;
+}
+
+void cJSON_Delete(cJSON* item) {
+}
@@ -0,0 +1,19 @@
+#ifndef HOST_STUB_MODEL_PATH_H
+#define HOST_STUB_MODEL_PATH_H
+
+// No speech models on the host, every lookup fails
+typedef struct {
+    char** model_name;
+    int num;
+} srmodel_list_t;
+
+#define ESP_MN_PREFIX "mn"
+#define ESP_WN_PREFIX "wn"
+#define ESP_NSNET_PREFIX "nsnet"
+#define ESP_VADN_PREFIX "vadnet"
+
+srmodel_list_t* esp_srmodel_init(const char* partition_label);
+void esp_srmodel_deinit(srmodel_list_t* models);
+char* esp_srmodel_filter(srmodel_list_t* models, const char* keyword1, const char* keyword2);
+
+#endif // HOST_STUB_MODEL_PATH_H
@@ -0,0 +1,25 @@
+#ifndef HOST_STUB_OPUS_DECODER_H
+#define HOST_STUB_OPUS_DECODER_H
+
+#include <cstdint>
+#include <vector>
+
+// Decodes the raw PCM frames of the host OpusEncoderWrapper, an empty packet conceals with silence
+class OpusDecoderWrapper {
+public:
+    OpusDecoderWrapper(int sample_rate, int channels, int duration_ms = 60);
+    ~OpusDecoderWrapper();
+
+    inline int sample_rate() const { return sample_rate_; }
+    inline int duration_ms() const { return duration_ms_; }
+
+    bool Decode(std::vector<uint8_t>&& opus, std::vector<int16_t>& pcm);
+    void ResetState();
+
+private:
+    int sample_rate_;
+    int duration_ms_;
+    int frame_size_;
+};
+
+#endif // HOST_STUB_OPUS_DECODER_H
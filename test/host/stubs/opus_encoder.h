@@ -0,0 +1,34 @@
+#ifndef HOST_STUB_OPUS_ENCODER_H
+#define HOST_STUB_OPUS_ENCODER_H
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/*
+ * Same interface as the esp-opus-encoder wrapper, without libopus: a frame is "encoded" as
+ * its raw little endian PCM, so the pipeline can be timed without the codec cost.
+ */
+class OpusEncoderWrapper {
+public:
+    OpusEncoderWrapper(int sample_rate, int channels, int duration_ms = 60);
+    ~OpusEncoderWrapper();
+
+    inline int sample_rate() const { return sample_rate_; }
+    inline int duration_ms() const { return duration_ms_; }
+
+    void SetDtx(bool enable);
+    void SetComplexity(int complexity);
+    void Encode(std::vector<int16_t>&& pcm, std::function<void(std::vector<uint8_t>&& opus)> handler);
+    bool Encode(std::vector<int16_t>&& pcm, std::vector<uint8_t>& opus);
+    bool IsBufferEmpty() const { return true; }
+    void ResetState();
+
+private:
+    int sample_rate_;
+    int duration_ms_;
+    int frame_size_;
+    int complexity_ = 0;
+};
+
+#endif // HOST_STUB_OPUS_ENCODER_H
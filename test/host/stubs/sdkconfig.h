@@ -0,0 +1,24 @@
+#ifndef HOST_STUB_SDKCONFIG_H
+#define HOST_STUB_SDKCONFIG_H
+
+/*
+ * The Kconfig defaults the audio pipeline is built with on the host, with the optional
+ * downlink stages turned on so the benchmark covers them. The target is treated as a
+ * dual core chip without the ESP-SR front end, so NoAudioProcessor and EspWakeWord are used.
+ */
+#define CONFIG_OPUS_FRAME_DURATION_MS 60
+#define CONFIG_OPUS_ENCODE_COMPLEXITY_MIN 0
+#define CONFIG_OPUS_ENCODE_COMPLEXITY_MAX 3
+#define CONFIG_OPUS_ENCODE_TASK_CORE 1
+#define CONFIG_OPUS_ENCODE_TASK_PRIORITY 2
+#define CONFIG_OPUS_DECODE_TASK_CORE -1
+#define CONFIG_OPUS_DECODE_TASK_PRIORITY 2
+#define CONFIG_EARLY_TTS_PACKET_WINDOW_MS 500
+#define CONFIG_USE_SOUND_PCM_CACHE 1
+#define CONFIG_SOUND_PCM_CACHE_SIZE_KB 256
+#define CONFIG_USE_POLYPHASE_INPUT_RESAMPLER 1
+#define CONFIG_USE_POLYPHASE_OUTPUT_RESAMPLER 1
+#define CONFIG_USE_DRIFT_COMPENSATION 1
+#define CONFIG_USE_TIME_STRETCH 1
+
+#endif // HOST_STUB_SDKCONFIG_H
@@ -0,0 +1,20 @@
+#ifndef HOST_STUB_SETTINGS_H
+#define HOST_STUB_SETTINGS_H
+
+#include <cstdint>
+#include <string>
+
+// Settings kept in memory for the lifetime of the process instead of NVS
+class Settings {
+public:
+    Settings(const std::string& ns, bool read_write = false);
+
+    int32_t GetInt(const std::string& key, int32_t default_value = 0);
+    void SetInt(const std::string& key, int32_t value);
+
+private:
+    std::string ns_;
+    bool read_write_;
+};
+
+#endif // HOST_STUB_SETTINGS_H
@@ -0,0 +1,119 @@
+/*
+ * Stack use of the audio tasks over a full-duplex session that takes every path of the decode
+ * task: a 24 kHz server stream resampled to the 16 kHz speaker, a stall that the time stretcher
+ * fills, enough steady playback for the drift compensator to settle and a notification sound
+ * the decode task decodes over the speech. The uplink encodes the microphone all along.
+ *
+ * The host tasks run on painted stacks (see host_freertos.cc). The Opus shim is a PCM
+ * passthrough, so this is the stack the pipeline needs around the codec: the rest of each
+ * task's stack is what libopus may use, which the device reports in "stack_free".
+ *
+ * Run it with LD_BIND_NOW=1 as ctest does, the first call to each shared library function
+ * otherwise takes a few KB of the task that happens to make it.
+ */
+#include "audio_service.h"
+#include "wav_audio_codec.h"
+#include "host_clock.h"
+#include "host_test.h"
+#include "ogg_test_data.h"
+
+#include <cmath>
+#include <cstdio>
+#include <thread>
+
+#define SPEED 4
+#define SERVER_SAMPLE_RATE 24000
+#define OUTPUT_SAMPLE_RATE 16000
+#define FRAME_MS 60
+#define REPLY_FRAMES 140
+#define LEAD_FRAMES 6
+#define STALL_AT_FRAME 20
+#define STALL_MS 600
+#define SOUND_AT_FRAME 100
+#define SOUND_SAMPLE_RATE 16000
+#define SOUND_PACKETS 5
+#define MAIN_LOOP_INTERVAL_MS 5
+#define REPLY_ID 1
+// The pipeline may take at most this share of a codec task's stack, libopus needs the rest
+#define PIPELINE_STACK_MAX_PERCENT 50
+
+static void FillTone(AudioStreamPacket& packet, uint32_t frame) {
+    std::vector<int16_t> pcm(SERVER_SAMPLE_RATE * FRAME_MS / 1000);
+    for (size_t i = 0; i < pcm.size(); i++) {
+        size_t t = frame * pcm.size() + i;
+        pcm[i] = (int16_t)(4000 * std::sin(2 * M_PI * 200 * t / SERVER_SAMPLE_RATE));
+    }
+    auto bytes = reinterpret_cast<const uint8_t*>(pcm.data());
+    packet.payload.assign(bytes, bytes + pcm.size() * sizeof(int16_t));
+}
+
+static std::string MakeToneSound() {
+    std::vector<int16_t> frame(SOUND_SAMPLE_RATE * SOUND_FRAME_DURATION_MS / 1000, 6000);
+    std::string packet(reinterpret_cast<const char*>(frame.data()), frame.size() * sizeof(int16_t));
+    return MakeOgg(SOUND_SAMPLE_RATE, std::vector<std::string>(SOUND_PACKETS, packet));
+}
+
+static void RunSession() {
+    WavAudioCodec codec(16000, OUTPUT_SAMPLE_RATE);
+    codec.SetInputTone(300, 3000);
+    AudioService service;
+    service.Initialize(&codec);
+    service.Start();
+    service.EnableVoiceProcessing(true);
+    service.StartReply(REPLY_ID);
+    std::string sound = MakeToneSound();
+
+    int64_t start_us = esp_timer_get_time();
+    int64_t next_frame_us = start_us - LEAD_FRAMES * FRAME_MS * 1000;
+    uint32_t frame = 0;
+    while (esp_timer_get_time() - start_us < (REPLY_FRAMES * FRAME_MS + STALL_MS + 1000) * 1000) {
+        int64_t now = esp_timer_get_time();
+        while (auto packet = service.PopPacketFromSendQueue()) {
+            service.RecyclePacket(std::move(packet));
+        }
+        while (frame < REPLY_FRAMES && next_frame_us <= now) {
+            auto packet = service.AcquirePacket();
+            packet->sample_rate = SERVER_SAMPLE_RATE;
+            packet->frame_duration = FRAME_MS;
+            packet->timestamp = 0;
+            packet->sequence = 0;
+            FillTone(*packet, frame++);
+            service.PushIncomingPacket(std::move(packet), REPLY_ID);
+            next_frame_us += FRAME_MS * 1000;
+            if (frame == STALL_AT_FRAME) {
+                next_frame_us += STALL_MS * 1000;
+            }
+            if (frame == SOUND_AT_FRAME) {
+                service.PlaySound(sound);
+            }
+            if (frame == REPLY_FRAMES) {
+                service.FinishReply(REPLY_ID);
+            }
+        }
+        std::this_thread::sleep_for(HostClockHostDuration(MAIN_LOOP_INTERVAL_MS * 1000));
+    }
+    TimeStretchStats stretch = service.GetTimeStretchStats();
+    service.Stop();
+    HostTaskJoinAll();
+    CHECK(stretch.expanded_frames >= 1);
+}
+
+static void CheckTask(const char* name, size_t stack_size) {
+    size_t used = HostTaskStackUsed(name);
+    std::printf("  %-12s %6zu of %6zu bytes (%zu%%)\n", name, used, stack_size, used * 100 / stack_size);
+    CHECK(used * 100 <= stack_size * PIPELINE_STACK_MAX_PERCENT);
+}
+
+static void CodecTasksLeaveRoomForOpus() {
+    RunSession();
+    std::printf("  stack used around the codec, host build:\n");
+    CheckTask("opus_encode", OPUS_ENCODE_TASK_STACK_SIZE);
+    CheckTask("opus_decode", OPUS_DECODE_TASK_STACK_SIZE);
+    CHECK_EQ(OPUS_ENCODE_TASK_STACK_SIZE + OPUS_DECODE_TASK_STACK_SIZE, OPUS_CODEC_STACK_BUDGET);
+}
+
+int main() {
+    HostClockSetSpeed(SPEED);
+    RUN_TEST(CodecTasksLeaveRoomForOpus);
+    return HostTestResult();
+}
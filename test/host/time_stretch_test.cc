@@ -0,0 +1,92 @@
+/*
+ * When the decode task stretches the server stream: a reply whose packets keep coming is
+ * played at normal speed up to its last frame, and a stall in the middle of a reply slows
+ * down the frames around the gap.
+ *
+ * The server keeps a few frames ahead of real time, like a TTS stream, and sends "tts stop"
+ * right after the last packet. The Opus shim is a PCM passthrough.
+ */
+#include "audio_service.h"
+#include "wav_audio_codec.h"
+#include "host_clock.h"
+#include "host_test.h"
+
+#include <cmath>
+#include <cstdio>
+#include <thread>
+
+#define SPEED 4
+#define SAMPLE_RATE 24000
+#define FRAME_MS 60
+#define REPLY_FRAMES 40
+#define LEAD_FRAMES 6
+#define STALL_AT_FRAME 20
+#define STALL_MS 600
+#define MAIN_LOOP_INTERVAL_MS 5
+#define REPLY_ID 1
+
+static void FillTone(AudioStreamPacket& packet, uint32_t frame) {
+    std::vector<int16_t> pcm(SAMPLE_RATE * FRAME_MS / 1000);
+    for (size_t i = 0; i < pcm.size(); i++) {
+        size_t t = frame * pcm.size() + i;
+        pcm[i] = (int16_t)(4000 * std::sin(2 * M_PI * 200 * t / SAMPLE_RATE));
+    }
+    auto bytes = reinterpret_cast<const uint8_t*>(pcm.data());
+    packet.payload.assign(bytes, bytes + pcm.size() * sizeof(int16_t));
+}
+
+static TimeStretchStats PlayReply(int stall_ms) {
+    WavAudioCodec codec(16000, SAMPLE_RATE);
+    codec.SetInputTone(0, 0);
+    AudioService service;
+    service.Initialize(&codec);
+    service.Start();
+    service.StartReply(REPLY_ID);
+
+    int64_t start_us = esp_timer_get_time();
+    int64_t next_frame_us = start_us - LEAD_FRAMES * FRAME_MS * 1000;
+    uint32_t frame = 0;
+    while (esp_timer_get_time() - start_us < (REPLY_FRAMES * FRAME_MS + stall_ms + 1000) * 1000) {
+        int64_t now = esp_timer_get_time();
+        while (frame < REPLY_FRAMES && next_frame_us <= now) {
+            auto packet = service.AcquirePacket();
+            packet->sample_rate = SAMPLE_RATE;
+            packet->frame_duration = FRAME_MS;
+            packet->timestamp = 0;
+            packet->sequence = 0;
+            FillTone(*packet, frame++);
+            service.PushIncomingPacket(std::move(packet), REPLY_ID);
+            next_frame_us += FRAME_MS * 1000;
+            if (frame == STALL_AT_FRAME) {
+                next_frame_us += stall_ms * 1000;
+            }
+            if (frame == REPLY_FRAMES) {
+                service.FinishReply(REPLY_ID);
+            }
+        }
+        std::this_thread::sleep_for(HostClockHostDuration(MAIN_LOOP_INTERVAL_MS * 1000));
+    }
+    TimeStretchStats stats = service.GetTimeStretchStats();
+    service.Stop();
+    HostTaskJoinAll();
+    return stats;
+}
+
+static void EndOfReplyIsNotStretched() {
+    TimeStretchStats stats = PlayReply(0);
+    std::printf("  steady reply: %u expanded frames\n", (unsigned)stats.expanded_frames);
+    CHECK_EQ(stats.expanded_frames, 0u);
+}
+
+static void StallMidReplyIsStretched() {
+    TimeStretchStats stats = PlayReply(STALL_MS);
+    std::printf("  stalled reply: %u expanded frames\n", (unsigned)stats.expanded_frames);
+    CHECK(stats.expanded_frames >= 1);
+}
+
+int main() {
+    HostClockSetSpeed(SPEED);
+    RUN_TEST(EndOfReplyIsNotStretched);
+    RUN_TEST(StallMidReplyIsStretched);
+    return HostTestResult();
+}
@@ -0,0 +1,55 @@
+#ifndef TONE_ANALYSIS_H
+#define TONE_ANALYSIS_H
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+/*
+ * Sine test signals for the host tests and benchmarks. The SNR fits a sine of the known
+ * frequency (any phase and amplitude) to the signal, so the delay of the processing under
+ * test does not matter; everything the fit leaves over counts as noise and distortion.
+ */
+inline std::vector<int16_t> MakeTone(int sample_rate, double frequency, double amplitude, size_t samples) {
+    std::vector<int16_t> tone(samples);
+    for (size_t i = 0; i < samples; i++) {
+        tone[i] = (int16_t)std::lround(amplitude * std::sin(2 * M_PI * frequency * i / sample_rate));
+    }
+    return tone;
+}
+
+inline double ToneSnrDb(const int16_t* signal, size_t samples, int sample_rate, double frequency) {
+    double ss = 0, cc = 0, sc = 0, xs = 0, xc = 0;
+    for (size_t i = 0; i < samples; i++) {
+        double w = 2 * M_PI * frequency * i / sample_rate;
+        double s = std::sin(w), c = std::cos(w);
+        ss += s * s;
+        cc += c * c;
+        sc += s * c;
+        xs += signal[i] * s;
+        xc += signal[i] * c;
+    }
+    double det = ss * cc - sc * sc;
+    double a = (xs * cc - xc * sc) / det;
+    double b = (xc * ss - xs * sc) / det;
+    double tone_power = 0, noise_power = 0;
+    for (size_t i = 0; i < samples; i++) {
+        double w = 2 * M_PI * frequency * i / sample_rate;
+        double fit = a * std::sin(w) + b * std::cos(w);
+        tone_power += fit * fit;
+        noise_power += (signal[i] - fit) * (signal[i] - fit);
+    }
+    return 10 * std::log10(tone_power / std::max(noise_power, 1e-9));
+}
+
+// RMS level relative to a full-scale sine
+inline double LevelDb(const int16_t* signal, size_t samples) {
+    double power = 0;
+    for (size_t i = 0; i < samples; i++) {
+        power += (double)signal[i] * signal[i];
+    }
+    double full_scale = 32767.0 * 32767.0 / 2;
+    return 10 * std::log10(std::max(power / samples, 1e-9) / full_scale);
+}
+
+#endif // TONE_ANALYSIS_H
@@ -0,0 +1,172 @@
+#include "wav_audio_codec.h"
+#include "host_clock.h"
+
+#include <esp_timer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+struct WavHeader {
+    char riff[4];
+    uint32_t riff_size;
+    char wave[4];
+    char fmt[4];
+    uint32_t fmt_size;
+    uint16_t format;
+    uint16_t channels;
+    uint32_t sample_rate;
+    uint32_t byte_rate;
+    uint16_t block_align;
+    uint16_t bits_per_sample;
+    char data[4];
+    uint32_t data_size;
+} __attribute__((packed));
+
+WavAudioCodec::WavAudioCodec(int input_sample_rate, int output_sample_rate, int input_channels) {
+    duplex_ = true;
+    input_reference_ = input_channels == 2;
+    input_sample_rate_ = input_sample_rate;
+    output_sample_rate_ = output_sample_rate;
+    input_channels_ = input_channels;
+}
+
+WavAudioCodec::~WavAudioCodec() {
+    CloseOutput();
+}
+
+bool WavAudioCodec::OpenInput(const std::string& path) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    // Walk the chunks, the fmt chunk may be longer than 16 bytes and other chunks may come first
+    char riff[12];
+    bool ok = fread(riff, 1, sizeof(riff), file) == sizeof(riff) && memcmp(riff, "RIFF", 4) == 0 &&
+        memcmp(riff + 8, "WAVE", 4) == 0;
+    uint16_t format = 0, channels = 0, bits_per_sample = 0;
+    uint32_t sample_rate = 0;
+    while (ok) {
+        char id[4];
+        uint32_t size;
+        if (fread(id, 1, 4, file) != 4 || fread(&size, 4, 1, file) != 1) {
+            ok = false;
+            break;
+        }
+        if (memcmp(id, "fmt ", 4) == 0) {
+            uint8_t fmt[16];
+            ok = size >= sizeof(fmt) && fread(fmt, 1, sizeof(fmt), file) == sizeof(fmt);
+            memcpy(&format, fmt, 2);
+            memcpy(&channels, fmt + 2, 2);
+            memcpy(&sample_rate, fmt + 4, 4);
+            memcpy(&bits_per_sample, fmt + 14, 2);
+            fseek(file, size - sizeof(fmt) + (size & 1), SEEK_CUR);
+        } else if (memcmp(id, "data", 4) == 0) {
+            input_.resize(size / sizeof(int16_t));
+            ok = fread(input_.data(), sizeof(int16_t), input_.size(), file) == input_.size();
+            break;
+        } else {
+            fseek(file, size + (size & 1), SEEK_CUR);
+        }
+    }
+    fclose(file);
+    if (!ok || format != 1 || bits_per_sample != 16 || channels != input_channels_ ||
+        (int)sample_rate != input_sample_rate_ || input_.empty()) {
+        input_.clear();
+        return false;
+    }
+    input_offset_ = 0;
+    return true;
+}
+
+void WavAudioCodec::SetInputTone(int frequency_hz, int amplitude) {
+    input_.clear();
+    tone_frequency_hz_ = frequency_hz;
+    tone_amplitude_ = amplitude;
+}
+
+bool WavAudioCodec::OpenOutput(const std::string& path) {
+    CloseOutput();
+    output_file_ = fopen(path.c_str(), "wb");
+    if (output_file_ == nullptr) {
+        return false;
+    }
+    WavHeader header = {};
+    fwrite(&header, sizeof(header), 1, output_file_);
+    output_bytes_ = 0;
+    return true;
+}
+
+void WavAudioCodec::CloseOutput() {
+    if (output_file_ == nullptr) {
+        return;
+    }
+    WavHeader header;
+    memcpy(header.riff, "RIFF", 4);
+    header.riff_size = sizeof(header) - 8 + output_bytes_;
+    memcpy(header.wave, "WAVE", 4);
+    memcpy(header.fmt, "fmt ", 4);
+    header.fmt_size = 16;
+    header.format = 1;
+    header.channels = output_channels_;
+    header.sample_rate = output_sample_rate_;
+    header.byte_rate = output_sample_rate_ * output_channels_ * sizeof(int16_t);
+    header.block_align = output_channels_ * sizeof(int16_t);
+    header.bits_per_sample = 16;
+    memcpy(header.data, "data", 4);
+    header.data_size = output_bytes_;
+    fseek(output_file_, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, output_file_);
+    fclose(output_file_);
+    output_file_ = nullptr;
+}
+
+int WavAudioCodec::Read(int16_t* dest, int samples) {
+    int frames = samples / input_channels_;
+    int64_t now = esp_timer_get_time();
+    // The first read, or the first one after input was stopped, starts the capture clock again
+    if (input_start_us_ < 0 || now - CaptureTimeUs(input_frames_) > WAV_CODEC_INPUT_RESTART_US) {
+        input_start_us_ = now;
+        input_frames_ = 0;
+    }
+    for (int i = 0; i < samples; i++) {
+        if (!input_.empty()) {
+            dest[i] = input_[input_offset_];
+            input_offset_ = (input_offset_ + 1) % input_.size();
+        } else {
+            // The tone on the mic channel, silence on the reference channel
+            uint64_t frame = input_frames_ + i / input_channels_;
+            bool mic = i % input_channels_ == 0;
+            dest[i] = mic ? (int16_t)(tone_amplitude_ * std::sin(2 * M_PI * tone_frequency_hz_ * frame / input_sample_rate_)) : 0;
+        }
+    }
+    input_frames_ += frames;
+
+    int64_t captured_us = CaptureTimeUs(input_frames_);
+    if (esp_timer_get_time() > captured_us) {
+        late_reads_++;
+    } else {
+        std::this_thread::sleep_until(HostClockHostTimePoint(captured_us));
+    }
+    return samples;
+}
+
+int64_t WavAudioCodec::CaptureTimeUs(uint64_t frames) const {
+    return input_start_us_ + (int64_t)(frames * 1000000 / input_sample_rate_);
+}
+
+int WavAudioCodec::Write(const int16_t* data, int samples) {
+    int64_t now = esp_timer_get_time();
+    // An underrun lets the speaker catch up with the device clock
+    output_end_us_ = std::max(output_end_us_, now) + (int64_t)samples * 1000000 / output_channels_ / output_sample_rate_;
+    int64_t dma_us = (int64_t)dma_desc_num_ * dma_frame_num_ * 1000000 / output_sample_rate_;
+    if (output_end_us_ - dma_us > now) {
+        std::this_thread::sleep_until(HostClockHostTimePoint(output_end_us_ - dma_us));
+    }
+    if (output_file_ != nullptr) {
+        output_bytes_ += fwrite(data, sizeof(int16_t), samples, output_file_) * sizeof(int16_t);
+    }
+    output_frames_ += samples / output_channels_;
+    return samples;
+}
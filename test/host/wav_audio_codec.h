@@ -0,0 +1,60 @@
+#ifndef WAV_AUDIO_CODEC_H
+#define WAV_AUDIO_CODEC_H
+
+#include "audio_codec.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// A read this late after the previous one means input was stopped, the capture clock starts over
+#define WAV_CODEC_INPUT_RESTART_US 100000
+
+/*
+ * AudioCodec for the host build. The microphone plays a 16-bit WAV file in a loop, or a tone
+ * when there is none, and the speaker writes to a WAV file or nowhere.
+ *
+ * Both directions are paced by the device clock (host_clock.h) like I2S DMA: Read() returns
+ * once the samples have been captured, Write() once the samples fit in the DMA buffers,
+ * dma_desc_num_ * dma_frame_num_ frames ahead of the speaker.
+ */
+class WavAudioCodec : public AudioCodec {
+public:
+    WavAudioCodec(int input_sample_rate, int output_sample_rate, int input_channels = 1);
+    virtual ~WavAudioCodec();
+
+    // The file must match the input rate and channel count
+    bool OpenInput(const std::string& path);
+    void SetInputTone(int frequency_hz, int amplitude);
+    bool OpenOutput(const std::string& path);
+
+    uint64_t input_frames() const { return input_frames_; }
+    uint64_t output_frames() const { return output_frames_; }
+    // Reads that returned later than the capture time of their last sample
+    uint32_t late_reads() const { return late_reads_; }
+
+protected:
+    int Read(int16_t* dest, int samples) override;
+    int Write(const int16_t* data, int samples) override;
+
+private:
+    std::vector<int16_t> input_;
+    size_t input_offset_ = 0;
+    int tone_frequency_hz_ = 440;
+    int tone_amplitude_ = 8000;
+    uint64_t input_frames_ = 0;
+    int64_t input_start_us_ = -1;
+    uint32_t late_reads_ = 0;
+
+    FILE* output_file_ = nullptr;
+    uint32_t output_bytes_ = 0;
+    uint64_t output_frames_ = 0;
+    // Device time the last written sample leaves the speaker
+    int64_t output_end_us_ = 0;
+
+    void CloseOutput();
+    // Device time frame `frames` of the current capture run is recorded
+    int64_t CaptureTimeUs(uint64_t frames) const;
+};
+
+#endif // WAV_AUDIO_CODEC_H